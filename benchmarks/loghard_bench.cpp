@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+  Benchmarks for LogHard. Results are written as JSON objects, one per line,
+  to stdout or to the file given with --output. Usage:
+
+      loghard_bench [--threads N] [--messages N] [--samples N]
+                    [--output FILE] [--tmpdir DIR]
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <sharemind/Concat.h>
+#include <sharemind/Uuid.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <syslog.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "../src/Backend.h"
+#include "../src/CFileAppender.h"
+#include "../src/ConcurrentFileAppender.h"
+#include "../src/EarlyAppender.h"
+#include "../src/FileAppender.h"
+#include "../src/Layout.h"
+#include "../src/Logger.h"
+#include "../src/StdAppender.h"
+#include "../src/SyslogSocketAppender.h"
+
+
+using LogHard::Priority;
+using sharemind::concat;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::size_t messages = 20000u;
+    std::size_t samples = 100000u;
+    std::string output;
+    std::string tmpdir = "/tmp";
+};
+
+struct NullAppender final: LogHard::Appender {
+    void doLog(::timeval, Priority, char const *) noexcept final override {}
+};
+
+/** A local datagram socket standing in for the syslog daemon. */
+class SyslogStandIn {
+
+public: /* Methods: */
+
+    SyslogStandIn(std::string path)
+        : m_path(std::move(path))
+        , m_fd(::socket(AF_UNIX, SOCK_DGRAM, 0))
+    {
+        if (m_fd == -1)
+            throw std::runtime_error("socket() failed!");
+        ::unlink(m_path.c_str());
+        ::sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, m_path.c_str(), sizeof(addr.sun_path) - 1u);
+        if (::bind(m_fd, reinterpret_cast<::sockaddr *>(&addr), sizeof(addr)))
+            throw std::runtime_error("bind() failed!");
+        ::timeval const timeout{0, 100000};
+        ::setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        m_drainer = std::thread([this]{
+            char buffer[16384u];
+            while (!m_stop.load(std::memory_order_relaxed))
+                if (::recv(m_fd, buffer, sizeof(buffer), 0) < 0
+                    && errno != EAGAIN && errno != EINTR)
+                    break;
+        });
+    }
+
+    ~SyslogStandIn() noexcept {
+        m_stop.store(true, std::memory_order_relaxed);
+        m_drainer.join();
+        ::close(m_fd);
+        ::unlink(m_path.c_str());
+    }
+
+    std::string const & path() const noexcept { return m_path; }
+
+private: /* Fields: */
+
+    std::string const m_path;
+    int const m_fd;
+    std::atomic<bool> m_stop{false};
+    std::thread m_drainer;
+
+};
+
+/** Redirects stdout and stderr to /dev/null for its lifetime. */
+class SilencedStdStreams {
+
+public: /* Methods: */
+
+    SilencedStdStreams()
+        : m_stdout(::dup(STDOUT_FILENO))
+        , m_stderr(::dup(STDERR_FILENO))
+    {
+        int const null = ::open("/dev/null", O_WRONLY);
+        ::dup2(null, STDOUT_FILENO);
+        ::dup2(null, STDERR_FILENO);
+        ::close(null);
+    }
+
+    ~SilencedStdStreams() noexcept {
+        ::dup2(m_stdout, STDOUT_FILENO);
+        ::dup2(m_stderr, STDERR_FILENO);
+        ::close(m_stdout);
+        ::close(m_stderr);
+    }
+
+private: /* Fields: */
+
+    int const m_stdout;
+    int const m_stderr;
+
+};
+
+std::uint64_t nanoseconds(Clock::duration const d) noexcept {
+    return static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    d).count());
+}
+
+void printLatency(std::FILE * const out,
+                  char const * const name,
+                  std::vector<std::uint64_t> & samples)
+{
+    std::sort(samples.begin(), samples.end());
+    std::uint64_t sum = 0u;
+    for (auto const s : samples)
+        sum += s;
+    auto const percentile = [&samples](double const p) {
+        auto const i = static_cast<std::size_t>(
+                static_cast<double>(samples.size() - 1u) * p);
+        return static_cast<unsigned long long>(samples[i]);
+    };
+    std::fprintf(out,
+                 "{\"benchmark\":\"latency\",\"case\":\"%s\","
+                 "\"samples\":%zu,\"mean_ns\":%.1f,\"p50_ns\":%llu,"
+                 "\"p99_ns\":%llu,\"p999_ns\":%llu}\n",
+                 name,
+                 samples.size(),
+                 static_cast<double>(sum) / static_cast<double>(samples.size()),
+                 percentile(0.5),
+                 percentile(0.99),
+                 percentile(0.999));
+}
+
+template <typename T>
+void measureLatency(std::FILE * const out,
+                    Options const & options,
+                    LogHard::Logger const & logger,
+                    char const * const name,
+                    T const & value)
+{
+    std::vector<std::uint64_t> samples;
+    samples.reserve(options.samples);
+    for (std::size_t i = 0u; i < options.samples; ++i) {
+        auto const start(Clock::now());
+        logger.debug() << value;
+        samples.emplace_back(nanoseconds(Clock::now() - start));
+    }
+    printLatency(out, name, samples);
+}
+
+void benchmarkLatency(std::FILE * const out, Options const & options) {
+    auto const backend(std::make_shared<LogHard::Backend>(Priority::FullDebug));
+    backend->addAppender(std::make_shared<NullAppender>());
+    LogHard::Logger const logger(backend, "[Benchmark]");
+
+    {
+        std::vector<std::uint64_t> samples;
+        samples.reserve(options.samples);
+        for (std::size_t i = 0u; i < options.samples; ++i) {
+            auto const start(Clock::now());
+            samples.emplace_back(nanoseconds(Clock::now() - start));
+        }
+        printLatency(out, "clock_overhead", samples);
+    }
+
+    using L = LogHard::Logger;
+    int const anchor = 42;
+    measureLatency(out, options, logger, "empty", "");
+    measureLatency(out, options, logger, "char", 'x');
+    measureLatency(out, options, logger, "bool", true);
+    measureLatency(out, options, logger, "signed_char",
+                   static_cast<signed char>(-42));
+    measureLatency(out, options, logger, "unsigned_char",
+                   static_cast<unsigned char>(42u));
+    measureLatency(out, options, logger, "short", static_cast<short>(-4242));
+    measureLatency(out, options, logger, "unsigned_short",
+                   static_cast<unsigned short>(4242u));
+    measureLatency(out, options, logger, "int", -424242);
+    measureLatency(out, options, logger, "unsigned_int", 424242u);
+    measureLatency(out, options, logger, "long", -42424242l);
+    measureLatency(out, options, logger, "unsigned_long", 42424242ul);
+    measureLatency(out, options, logger, "long_long", -4242424242424242ll);
+    measureLatency(out, options, logger, "unsigned_long_long",
+                   4242424242424242ull);
+    measureLatency(out, options, logger, "hex_unsigned_char",
+                   L::Hex<unsigned char>{0x42u});
+    measureLatency(out, options, logger, "hex_unsigned_short",
+                   L::Hex<unsigned short>{0x4242u});
+    measureLatency(out, options, logger, "hex_unsigned_int",
+                   L::Hex<unsigned int>{0x42424242u});
+    measureLatency(out, options, logger, "hex_unsigned_long",
+                   L::Hex<unsigned long>{0x42424242ul});
+    measureLatency(out, options, logger, "hex_unsigned_long_long",
+                   L::Hex<unsigned long long>{0x4242424242424242ull});
+    measureLatency(out, options, logger, "hex_byte", L::HexByte{0x42u});
+    measureLatency(out, options, logger, "double", 4242.4242);
+    measureLatency(out, options, logger, "long_double", 4242.4242l);
+    measureLatency(out, options, logger, "float", 4242.42f);
+    measureLatency(out, options, logger, "c_string",
+                   "The quick brown fox jumps over the lazy dog");
+    measureLatency(out, options, logger, "std_string",
+                   std::string("The quick brown fox jumps over the lazy dog"));
+    measureLatency(out, options, logger, "pointer",
+                   const_cast<void *>(static_cast<void const *>(&anchor)));
+    measureLatency(out, options, logger, "const_pointer",
+                   static_cast<void const *>(&anchor));
+    measureLatency(out, options, logger, "uuid", sharemind::Uuid());
+}
+
+void benchmarkFileLatency(std::FILE * const out, Options const & options) {
+    using FA = LogHard::FileAppender;
+    auto const filePath(concat(options.tmpdir, "/loghard_bench.", ::getpid()));
+    auto const run = [&](char const * const name,
+                         FA::Preallocation const & preallocation)
+    {
+        auto const backend(
+                std::make_shared<LogHard::Backend>(Priority::FullDebug));
+        backend->addAppender(std::make_shared<FA>(filePath,
+                                                  FA::OVERWRITE,
+                                                  preallocation));
+        LogHard::Logger const logger(backend, "[Benchmark]");
+        measureLatency(out, options, logger, name,
+                       "The quick brown fox jumps over the lazy dog, "
+                       "the quick brown fox jumps over the lazy dog");
+    };
+    run("FileAppender", FA::Preallocation{0u, 0u});
+    run("FileAppender_preallocated", FA::Preallocation{1024u * 1024u, 0u});
+    run("FileAppender_preallocated_dropcache",
+        FA::Preallocation{1024u * 1024u, 8u * 1024u * 1024u});
+    ::unlink(filePath.c_str());
+}
+
+void benchmarkLayoutLatency(std::FILE * const out, Options const & options) {
+    using FA = LogHard::FileAppender;
+    auto const run = [&](char const * const name,
+                         std::shared_ptr<LogHard::Appender> appender)
+    {
+        auto const backend(
+                std::make_shared<LogHard::Backend>(Priority::FullDebug));
+        backend->addAppender(std::move(appender));
+        LogHard::Logger const logger(backend, "[Benchmark]");
+        measureLatency(out, options, logger, name,
+                       "The quick brown fox jumps over the lazy dog");
+    };
+    // Formatting costs only, the writes to /dev/null are cheap:
+    run("devnull_fixed_format",
+        std::make_shared<FA>("/dev/null", FA::APPEND));
+    run("devnull_layout_default",
+        std::make_shared<FA>("/dev/null",
+                             FA::APPEND,
+                             LogHard::Layout("%d %-7p %m%n")));
+    run("devnull_layout_iso",
+        std::make_shared<FA>("/dev/null",
+                             FA::APPEND,
+                             LogHard::Layout("%i %-7p [%t] %m%n")));
+}
+
+void benchmarkDisabled(std::FILE * const out, Options const & options) {
+    auto const backend(std::make_shared<LogHard::Backend>(Priority::Normal));
+    backend->addAppender(std::make_shared<NullAppender>());
+    LogHard::Logger const logger(backend, "[Benchmark]");
+
+    // Disabled statements are too cheap to time one by one:
+    std::size_t const iterations = options.samples * 100u;
+    auto const run = [&](char const * const name,
+                         std::function<void (std::size_t)> const & f)
+    {
+        auto const start(Clock::now());
+        for (std::size_t i = 0u; i < iterations; ++i)
+            f(i);
+        auto const elapsed = nanoseconds(Clock::now() - start);
+        std::fprintf(out,
+                     "{\"benchmark\":\"disabled\",\"case\":\"%s\","
+                     "\"iterations\":%zu,\"mean_ns\":%.3f}\n",
+                     name,
+                     iterations,
+                     static_cast<double>(elapsed)
+                     / static_cast<double>(iterations));
+    };
+    run("loop_overhead", [](std::size_t) {});
+    run("debug", [&logger](std::size_t const i) { logger.debug() << i; });
+    run("LOGHARD_DEBUG",
+        [&logger](std::size_t const i) { LOGHARD_DEBUG(logger) << i; });
+}
+
+void benchmarkThroughput(
+        std::FILE * const out,
+        Options const & options,
+        char const * const name,
+        unsigned const threads,
+        std::function<std::shared_ptr<LogHard::Appender> (std::size_t)> const &
+                createAppender,
+        bool const backendPerThread = false)
+{
+    std::size_t const records = options.messages * threads;
+    auto const appender(createAppender(records));
+    auto const backend(std::make_shared<LogHard::Backend>(Priority::FullDebug));
+    backend->addAppender(appender);
+    LogHard::Logger const sharedLogger(backend, "[Benchmark]");
+
+    std::atomic<unsigned> ready{0u};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0u; t < threads; ++t) {
+        workers.emplace_back([&, t]{
+            // Separate Backends call the shared appender in parallel:
+            std::shared_ptr<LogHard::Backend> ownBackend;
+            std::unique_ptr<LogHard::Logger> ownLogger;
+            if (backendPerThread) {
+                ownBackend = std::make_shared<LogHard::Backend>(
+                                 Priority::FullDebug);
+                ownBackend->addAppender(appender);
+                ownLogger.reset(new LogHard::Logger(ownBackend, "[Benchmark]"));
+            }
+            auto const & logger = ownLogger ? *ownLogger : sharedLogger;
+            ready.fetch_add(1u);
+            while (!go.load())
+                std::this_thread::yield();
+            for (std::size_t i = 0u; i < options.messages; ++i)
+                logger.info() << "Benchmark message " << i << " from thread "
+                              << t << ", value " << 4242.4242;
+        });
+    }
+    while (ready.load() != threads)
+        std::this_thread::yield();
+    auto const start(Clock::now());
+    go.store(true);
+    for (auto & worker : workers)
+        worker.join();
+    auto const elapsed = nanoseconds(Clock::now() - start);
+    std::fprintf(out,
+                 "{\"benchmark\":\"throughput\",\"case\":\"%s\","
+                 "\"threads\":%u,\"backends\":%u,\"records\":%zu,"
+                 "\"elapsed_ns\":%llu,\"records_per_second\":%.0f}\n",
+                 name,
+                 threads,
+                 backendPerThread ? threads : 1u,
+                 records,
+                 static_cast<unsigned long long>(elapsed),
+                 static_cast<double>(records) * 1e9
+                 / static_cast<double>(elapsed));
+}
+
+void benchmarkAppenders(std::FILE * const out, Options const & options) {
+    std::vector<unsigned> threadCounts;
+    for (unsigned t = 1u; t < options.threads; t *= 2u)
+        threadCounts.emplace_back(t);
+    threadCounts.emplace_back(options.threads);
+
+    auto const filePath(concat(options.tmpdir, "/loghard_bench.", ::getpid()));
+    for (auto const threads : threadCounts) {
+        benchmarkThroughput(out, options, "null", threads, [](std::size_t) {
+            return std::make_shared<NullAppender>();
+        });
+        {
+            SilencedStdStreams const silenced;
+            benchmarkThroughput(out, options, "StdAppender", threads,
+                                [](std::size_t) {
+                return std::make_shared<LogHard::StdAppender>();
+            });
+        }
+        benchmarkThroughput(out, options, "FileAppender", threads,
+                            [&filePath](std::size_t) {
+            return std::make_shared<LogHard::FileAppender>(
+                        filePath,
+                        LogHard::FileAppender::OVERWRITE);
+        });
+        // Parallel writers to a single file, O_APPEND vs reserved offsets:
+        benchmarkThroughput(out, options, "FileAppender", threads,
+                            [&filePath](std::size_t) {
+            return std::make_shared<LogHard::FileAppender>(
+                        filePath,
+                        LogHard::FileAppender::OVERWRITE);
+        }, true);
+        benchmarkThroughput(out, options, "ConcurrentFileAppender", threads,
+                            [&filePath](std::size_t) {
+            return std::make_shared<LogHard::ConcurrentFileAppender>(
+                        filePath,
+                        LogHard::FileAppender::OVERWRITE);
+        }, true);
+        {
+            std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(
+                        std::fopen(filePath.c_str(), "w"),
+                        &std::fclose);
+            if (!file)
+                throw std::runtime_error("fopen() failed!");
+            benchmarkThroughput(out, options, "CFileAppender", threads,
+                                [&file](std::size_t) {
+                return std::make_shared<LogHard::CFileAppender>(file.get());
+            });
+        }
+        {
+            SyslogStandIn const syslog(concat(filePath, ".sock"));
+            benchmarkThroughput(out, options, "SyslogSocketAppender", threads,
+                                [&syslog](std::size_t) {
+                return std::make_shared<LogHard::SyslogSocketAppender>(
+                            "loghard_bench",
+                            LOG_USER,
+                            syslog.path());
+            });
+        }
+        benchmarkThroughput(out, options, "EarlyAppender", threads,
+                            [](std::size_t const records) {
+            return std::make_shared<LogHard::EarlyAppender>(
+                        records,
+                        1024u,
+                        LogHard::EarlyAppender::OverflowPolicy::KeepOldest,
+                        records * 128u);
+        });
+    }
+    ::unlink(filePath.c_str());
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg(argv[i]);
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Invalid argument: %s\n", arg.c_str());
+            return EXIT_FAILURE;
+        }
+        char const * const value = argv[++i];
+        if (arg == "--threads") {
+            options.threads =
+                    std::max(static_cast<unsigned>(std::atoi(value)), 1u);
+        } else if (arg == "--messages") {
+            options.messages = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--samples") {
+            options.samples =
+                    std::max<std::size_t>(std::strtoull(value, nullptr, 10),
+                                          1u);
+        } else if (arg == "--output") {
+            options.output = value;
+        } else if (arg == "--tmpdir") {
+            options.tmpdir = value;
+        } else {
+            std::fprintf(stderr, "Invalid argument: %s\n", arg.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Keep the results away from the redirected standard streams:
+    std::FILE * const out = options.output.empty()
+                            ? ::fdopen(::dup(STDOUT_FILENO), "w")
+                            : std::fopen(options.output.c_str(), "w");
+    if (!out) {
+        std::perror("Failed to open output");
+        return EXIT_FAILURE;
+    }
+    try {
+        benchmarkLatency(out, options);
+        benchmarkFileLatency(out, options);
+        benchmarkLayoutLatency(out, options);
+        benchmarkDisabled(out, options);
+        benchmarkAppenders(out, options);
+    } catch (std::exception const & e) {
+        std::fprintf(stderr, "Benchmark failed: %s\n", e.what());
+        std::fclose(out);
+        return EXIT_FAILURE;
+    }
+    std::fclose(out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+  Replays the traffic recorded by a TrafficCaptureAppender to a Backend with
+  the given appenders, and writes the results as a JSON object to stdout or
+  to the file given with --output. Usage:
+
+      loghard_replay --capture FILE [--speed X] [--appender SPEC]...
+                     [--priority PRIORITY_SPEC] [--output FILE]
+
+  The speed is relative to the capture, with 0 meaning as fast as possible.
+  Appender specifications are "null", "std" or TYPE:PATH where TYPE is one of
+  file, concurrentfile, compressedfile, uringfile or uringfile-nosync. The
+  appenders can be named by their specifications in PRIORITY_SPEC, see
+  LogHard::PrioritySpec. Without --priority, all records are logged.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "../src/Backend.h"
+#include "../src/CompressedFileAppender.h"
+#include "../src/ConcurrentFileAppender.h"
+#include "../src/FileAppender.h"
+#include "../src/PrioritySpec.h"
+#include "../src/StdAppender.h"
+#include "../src/TrafficReplay.h"
+#include "../src/UringFileAppender.h"
+
+
+using LogHard::FileAppender;
+using LogHard::Priority;
+
+namespace {
+
+struct Options {
+    std::string capture;
+    double speed = 1.0;
+    std::vector<std::string> appenders;
+    std::string priority;
+    std::string output;
+};
+
+struct NullAppender final: LogHard::Appender {
+    void doLog(::timeval, Priority, char const *) noexcept final override {}
+};
+
+std::shared_ptr<LogHard::Appender> createAppender(std::string const & spec) {
+    if (spec == "null")
+        return std::make_shared<NullAppender>();
+    if (spec == "std")
+        return std::make_shared<LogHard::StdAppender>();
+    auto const colon = spec.find(':');
+    if (colon == std::string::npos)
+        throw std::runtime_error("Invalid appender: " + spec);
+    auto const type(spec.substr(0u, colon));
+    auto const path(spec.substr(colon + 1u));
+    if (type == "file")
+        return std::make_shared<FileAppender>(path, FileAppender::OVERWRITE);
+    if (type == "concurrentfile")
+        return std::make_shared<LogHard::ConcurrentFileAppender>(
+                    path,
+                    FileAppender::OVERWRITE);
+    if (type == "compressedfile")
+        return std::make_shared<LogHard::CompressedFileAppender>(
+                    path,
+                    FileAppender::OVERWRITE);
+    if (type == "uringfile")
+        return std::make_shared<LogHard::UringFileAppender>(
+                    path,
+                    FileAppender::OVERWRITE);
+    if (type == "uringfile-nosync")
+        return std::make_shared<LogHard::UringFileAppender>(
+                    path,
+                    FileAppender::OVERWRITE,
+                    LogHard::UringFileAppender::NO_SYNC);
+    throw std::runtime_error("Invalid appender: " + spec);
+}
+
+void printResult(std::FILE * const out,
+                 LogHard::TrafficReplay const & replay,
+                 Options const & options,
+                 LogHard::TrafficReplay::Result const & result)
+{
+    auto const mean = [](LogHard::Histogram::Snapshot const & s) {
+        return s.count
+               ? static_cast<double>(s.sum) / static_cast<double>(s.count)
+               : 0.0;
+    };
+    auto const ull = [](std::uint64_t const v)
+    { return static_cast<unsigned long long>(v); };
+    auto const & lag = result.lag;
+    auto const & latency = result.latency;
+    std::fprintf(out,
+                 "{\"capture\":\"%s\",\"speed\":%g,\"threads\":%zu,"
+                 "\"records\":%zu,\"elapsed_ns\":%llu,"
+                 "\"lag_mean_ns\":%.1f,\"lag_p99_ns\":%llu,"
+                 "\"lag_max_ns\":%llu,"
+                 "\"latency_mean_ns\":%.1f,\"latency_p50_ns\":%llu,"
+                 "\"latency_p99_ns\":%llu,\"latency_p999_ns\":%llu,"
+                 "\"latency_max_ns\":%llu}\n",
+                 options.capture.c_str(),
+                 options.speed,
+                 replay.threads(),
+                 result.records,
+                 ull(static_cast<std::uint64_t>(result.elapsed.count())),
+                 mean(lag),
+                 ull(lag.percentile(0.99)),
+                 ull(lag.max()),
+                 mean(latency),
+                 ull(latency.percentile(0.5)),
+                 ull(latency.percentile(0.99)),
+                 ull(latency.percentile(0.999)),
+                 ull(latency.max()));
+}
+
+} // anonymous namespace
+
+int main(int argc, char * argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg(argv[i]);
+        if (i + 1 >= argc) {
+            std::fprintf(stderr, "Invalid argument: %s\n", arg.c_str());
+            return EXIT_FAILURE;
+        }
+        char const * const value = argv[++i];
+        if (arg == "--capture") {
+            options.capture = value;
+        } else if (arg == "--speed") {
+            options.speed = std::max(std::strtod(value, nullptr), 0.0);
+        } else if (arg == "--appender") {
+            options.appenders.emplace_back(value);
+        } else if (arg == "--priority") {
+            options.priority = value;
+        } else if (arg == "--output") {
+            options.output = value;
+        } else {
+            std::fprintf(stderr, "Invalid argument: %s\n", arg.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.capture.empty()) {
+        std::fprintf(stderr, "No --capture given!\n");
+        return EXIT_FAILURE;
+    }
+
+    // Keep the results away from StdAppender:
+    std::FILE * const out = options.output.empty()
+                            ? ::fdopen(::dup(STDOUT_FILENO), "w")
+                            : std::fopen(options.output.c_str(), "w");
+    if (!out) {
+        std::perror("Failed to open output");
+        return EXIT_FAILURE;
+    }
+    try {
+        LogHard::TrafficReplay const replay(options.capture);
+        auto const backend(
+                std::make_shared<LogHard::Backend>(Priority::FullDebug));
+        LogHard::PrioritySpec::Appenders appenders;
+        for (auto const & spec : options.appenders) {
+            auto appender(createAppender(spec));
+            backend->addAppender(appender);
+            appenders.emplace(spec, std::move(appender));
+        }
+        if (appenders.empty())
+            backend->addAppender(std::make_shared<NullAppender>());
+        LogHard::PrioritySpec(options.priority).apply(*backend, appenders);
+        auto const result(replay.replay(backend, options.speed));
+        printResult(out, replay, options, result);
+    } catch (std::exception const & e) {
+        std::fprintf(stderr, "Replay failed: %s\n", e.what());
+        std::fclose(out);
+        return EXIT_FAILURE;
+    }
+    std::fclose(out);
+    return EXIT_SUCCESS;
+}
@@ -19,13 +19,22 @@
 
 #include "Appender.h"
 
+#include <chrono>
+#include <cstring>
+#include "LogContext.h"
+
 
 namespace LogHard {
 
-Appender::Appender() noexcept {}
+std::atomic<std::uint64_t> Appender::s_dispatchChanges{0u};
+
+Appender::Appender() noexcept
+    : m_counters(newCounters<AppenderCounters>())
+{}
 
 Appender::Appender(Priority const priority) noexcept
     : m_priority(priority)
+    , m_counters(newCounters<AppenderCounters>())
 {}
 
 Appender::~Appender() noexcept {}
@@ -33,9 +42,98 @@ Appender::~Appender() noexcept {}
 void Appender::log(::timeval time,
                    Priority priority,
                    char const * message) noexcept
+{ log(time, priority, message, std::strlen(message)); }
+
+void Appender::log(::timeval time,
+                   Priority priority,
+                   char const * message,
+                   std::size_t size) noexcept
 {
-    if (priority <= m_priority.load(std::memory_order_relaxed))
+    if (priority <= m_priority.load(std::memory_order_relaxed)
+        || LogContext::elevates(priority))
+    {
+        #ifndef LOGHARD_NO_STATISTICS
+        if (m_counters) {
+            m_counters->recordLogged(1u, size);
+            if (AppenderCounters::sampleLatency()) {
+                auto const start(std::chrono::steady_clock::now());
+                doLog(time, priority, message);
+                m_counters->latency.record(
+                            durationNanoseconds(
+                                std::chrono::steady_clock::now() - start));
+                return;
+            }
+        }
+        #else
+        (void) size;
+        #endif
         doLog(time, priority, message);
+    } else {
+        LOGHARD_STATISTICS_ONLY(
+            if (m_counters)
+                m_counters->filtered.fetch_add(1u, std::memory_order_relaxed);)
+    }
+}
+
+void Appender::logBatch(LogRecord const * records,
+                        std::size_t size,
+                        Priority priority) noexcept
+{
+    {
+        auto const p = m_priority.load(std::memory_order_relaxed);
+        if (p < priority)
+            priority = p;
+    }
+    // Hand over runs of consecutive records which pass the filter:
+    LogRecord const * const end = records + size;
+    LOGHARD_STATISTICS_ONLY(std::uint64_t filtered = 0u;)
+    while (records != end) {
+        if (records->priority > priority) {
+            LOGHARD_STATISTICS_ONLY(++filtered;)
+            ++records;
+            continue;
+        }
+        LogRecord const * runEnd = records + 1;
+        while (runEnd != end && runEnd->priority <= priority)
+            ++runEnd;
+        auto const runSize = static_cast<std::size_t>(runEnd - records);
+        #ifndef LOGHARD_NO_STATISTICS
+        if (m_counters) {
+            std::size_t bytes = 0u;
+            for (auto r = records; r != runEnd; ++r)
+                bytes += std::strlen(r->message);
+            m_counters->recordLogged(runSize, bytes);
+            if (AppenderCounters::sampleLatency()) {
+                auto const start(std::chrono::steady_clock::now());
+                doLogBatch(records, runSize);
+                m_counters->latency.record(
+                            durationNanoseconds(
+                                std::chrono::steady_clock::now() - start));
+                records = runEnd;
+                continue;
+            }
+        }
+        #endif
+        doLogBatch(records, runSize);
+        records = runEnd;
+    }
+    LOGHARD_STATISTICS_ONLY(
+        if (m_counters)
+            m_counters->filtered.fetch_add(filtered,
+                                           std::memory_order_relaxed);)
+}
+
+AppenderStatistics Appender::statistics() const noexcept {
+    if (m_counters)
+        return m_counters->snapshot();
+    return AppenderStatistics{};
+}
+
+void Appender::doLogBatch(LogRecord const * records, std::size_t size)
+        noexcept
+{
+    for (; size; ++records, --size)
+        doLog(records->time, records->priority, records->message);
 }
 
 char const * Appender::priorityString(Priority const priority) noexcept
@@ -21,14 +21,26 @@
 #define LOGHARD_APPENDER_H
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <sys/time.h>
 #include "Priority.h"
+#include "Statistics.h"
 
 
 namespace LogHard {
 
 class Appender {
 
+public: /* Types: */
+
+    struct LogRecord {
+        ::timeval time;
+        Priority priority;
+        char const * message;
+    };
+
 protected: /* Methods: */
 
     Appender() noexcept;
@@ -38,13 +50,47 @@ public: /* Methods: */
 
     virtual ~Appender() noexcept;
 
-    void setPriority(Priority const priority) noexcept
-    { m_priority.store(priority, std::memory_order_relaxed);  }
+    void setPriority(Priority const priority) noexcept {
+        m_priority.store(priority, std::memory_order_relaxed);
+        noteDispatchChange();
+    }
+
+    Priority priority() const noexcept
+    { return m_priority.load(std::memory_order_relaxed); }
+
+    /**
+      \returns a counter which is incremented by every change which may affect
+               the dispatch tables of Backends, e.g. whenever the priority of
+               any appender is changed.
+    */
+    static std::uint64_t dispatchChanges() noexcept
+    { return s_dispatchChanges.load(std::memory_order_acquire); }
+
+    /** \brief Increments the counter returned by dispatchChanges(). */
+    static void noteDispatchChange() noexcept
+    { s_dispatchChanges.fetch_add(1u, std::memory_order_release); }
 
     void log(::timeval time,
              Priority priority,
              char const * message) noexcept;
 
+    /** \param[in] size The length of the message, as by std::strlen(). */
+    void log(::timeval time,
+             Priority priority,
+             char const * message,
+             std::size_t size) noexcept;
+
+    /**
+      \brief Logs a batch of records.
+      \param[in] priority Additional filter for the records in the batch.
+    */
+    void logBatch(LogRecord const * records,
+                  std::size_t size,
+                  Priority priority = Priority::FullDebug) noexcept;
+
+    /** \returns the statistics, all zero if statistics are disabled. */
+    AppenderStatistics statistics() const noexcept;
+
     static char const * priorityString(Priority const priority) noexcept;
 
     static char const * priorityStringRightPadded(Priority const priority)
@@ -56,10 +102,20 @@ private: /* Methods: */
                        Priority priority,
                        char const * message) noexcept = 0;
 
+    /** \note The default implementation calls doLog() for every record. */
+    virtual void doLogBatch(LogRecord const * records,
+                            std::size_t size) noexcept;
+
 protected: /* Fields: */
 
     std::atomic<Priority> m_priority{Priority::FullDebug};
 
+private: /* Fields: */
+
+    std::unique_ptr<AppenderCounters> const m_counters;
+
+    static std::atomic<std::uint64_t> s_dispatchChanges;
+
 }; /* class Appender { */
 
 } /* namespace LogHard { */
@@ -19,8 +19,13 @@
 
 #include "Backend.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
 #include <type_traits>
+#include "LogContext.h"
 
 
 namespace LogHard {
@@ -36,10 +41,27 @@ static_assert(
         std::is_nothrow_default_constructible<MockAppender>::value,
         "Invalid exception specification for Backend::Appender constructor!");
 
+/** Serializes changes to the graph of Backends, see addAppender(). */
+std::mutex graphMutex;
+
+std::chrono::microseconds elapsed(::timeval const & from,
+                                  ::timeval const & to) noexcept
+{
+    return std::chrono::seconds(to.tv_sec - from.tv_sec)
+           + std::chrono::microseconds(to.tv_usec - from.tv_usec);
+}
+
 } // anonymous namespace
 
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception, Backend::, Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        Backend::Exception,
+        Backend::,
+        LoopException,
+        "Adding the appender would create a loop of Backends!");
+
 Backend::Appender::Appender(std::shared_ptr<Backend> backend) noexcept
-    : LogHard::Appender(backend->m_priority)
+    : LogHard::Appender(backend->m_filter.root().priority())
     , m_backend(std::move(backend))
 {}
 
@@ -54,37 +76,515 @@ void Backend::Appender::doLog(::timeval time,
                               char const * message) noexcept
 { m_backend->doLog(time, priority, message); }
 
-Backend::Backend() noexcept {}
+Backend::Backend() noexcept
+    : m_counters(newCounters<BackendCounters>())
+{}
 
 Backend::Backend(Priority const priority) noexcept
-    : m_priority(priority)
+    : m_filter(priority)
+    , m_counters(newCounters<BackendCounters>())
 {}
 
-void Backend::setPriority(Priority const priority) noexcept {
-    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
-    m_priority = priority;
-}
+Backend::~Backend() noexcept { flushDuplicatesLocked(); }
+
+void Backend::setPriority(Priority const priority) noexcept
+{ m_filter.setPriority(m_filter.root(), priority); }
 
 void Backend::addAppender(std::shared_ptr<LogHard::Appender> appenderPtr) {
     assert(appenderPtr);
-    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
-    m_appenders.insert(appenderPtr);
+    auto const * const backendAppender =
+            dynamic_cast<Backend::Appender const *>(appenderPtr.get());
+    if (backendAppender) {
+        std::lock_guard<std::mutex> const graphGuard(graphMutex);
+        if (backendAppender->m_backend->reaches(*this))
+            throw LoopException();
+        m_targets.emplace_back(backendAppender->m_backend.get());
+    }
+    try {
+        std::lock_guard<std::recursive_mutex> const guard(m_mutex);
+        if (m_appenders.insert(appenderPtr).second) {
+            // Backends which have flattened this one need to notice too:
+            m_dispatchTablesStale = true;
+            LogHard::Appender::noteDispatchChange();
+            return;
+        }
+    } catch (...) {
+        if (backendAppender)
+            removeTarget(*backendAppender->m_backend);
+        throw;
+    }
+    // The appender was already added:
+    if (backendAppender)
+        removeTarget(*backendAppender->m_backend);
 }
 
 void Backend::removeAppender(std::shared_ptr<LogHard::Appender> appenderPtr) noexcept
 {
+    {
+        std::lock_guard<std::recursive_mutex> const guard(m_mutex);
+        if (!m_appenders.erase(appenderPtr))
+            return;
+        m_dispatchTablesStale = true;
+        LogHard::Appender::noteDispatchChange();
+    }
+    if (auto const * const backendAppender =
+                dynamic_cast<Backend::Appender const *>(appenderPtr.get()))
+        removeTarget(*backendAppender->m_backend);
+}
+
+void Backend::removeTarget(Backend const & target) noexcept {
+    std::lock_guard<std::mutex> const graphGuard(graphMutex);
+    auto const it = std::find(m_targets.begin(), m_targets.end(), &target);
+    assert(it != m_targets.end());
+    m_targets.erase(it);
+}
+
+void Backend::setDuplicateWindow(std::chrono::microseconds const window)
+        noexcept
+{
+    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
+    flushDuplicatesLocked();
+    m_duplicates.haveLast = false;
+    m_duplicates.window = window;
+    LogHard::Appender::noteDispatchChange();
+}
+
+void Backend::flushDuplicates() noexcept {
     std::lock_guard<std::recursive_mutex> const guard(m_mutex);
-    m_appenders.erase(appenderPtr);
+    flushDuplicatesLocked();
+}
+
+void Backend::setOverloadPolicy(OverloadPolicy const & policy) noexcept {
+    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
+    auto & o = m_overload;
+    o.enabled = (policy.maxBytesPerSecond || policy.maxLatency.count() > 0)
+                && policy.interval.count() > 0;
+    o.policy = policy;
+    o.intervalStart = std::chrono::steady_clock::now();
+    o.bytes = 0u;
+    o.records = 0u;
+    o.latency = std::chrono::steady_clock::duration::zero();
+    o.calmIntervals = 0u;
+    if (!o.enabled)
+        setOverloadPriorityLocked(Priority::FullDebug, "disabled");
+    LogHard::Appender::noteDispatchChange();
+}
+
+void Backend::setOverloadPriority(Priority const priority) noexcept {
+    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
+    m_overload.calmIntervals = 0u;
+    setOverloadPriorityLocked(priority, "overridden");
+}
+
+Backend::OverloadStatus Backend::overloadStatus() noexcept {
+    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
+    return OverloadStatus{m_overloadPriority.load(std::memory_order_relaxed),
+                          m_overload.bytesPerSecond,
+                          m_overload.meanLatency};
+}
+
+BackendStatistics Backend::statistics() {
+    BackendStatistics r{};
+    if (m_counters)
+        r = m_counters->snapshot();
+    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
+    r.appenders.reserve(m_appenders.size());
+    for (auto const & a : m_appenders)
+        r.appenders.emplace_back(a->statistics());
+    return r;
+}
+
+std::vector<PrefixFilter::Volume> Backend::topTalkers(std::size_t const count)
+        const
+{
+    auto r(m_filter.volumes());
+    std::sort(r.begin(),
+              r.end(),
+              [](PrefixFilter::Volume const & lhs,
+                 PrefixFilter::Volume const & rhs)
+              { return lhs.counts.totalBytes() > rhs.counts.totalBytes(); });
+    if (r.size() > count)
+        r.erase(r.begin() + static_cast<std::ptrdiff_t>(count), r.end());
+    return r;
+}
+
+void Backend::setTopTalkersReport(std::chrono::seconds const interval,
+                                  std::size_t const count) noexcept
+{
+    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
+    auto & t = m_topTalkers;
+    t.interval = interval;
+    t.count = count;
+    t.last.clear();
+    LogHard::Appender::noteDispatchChange();
+    if (interval.count() <= 0)
+        return;
+    ::timeval now;
+    ::gettimeofday(&now, nullptr);
+    t.next = now.tv_sec + interval.count();
+    try {
+        for (auto const & v : m_filter.volumes())
+            t.last.emplace(v.path,
+                           std::make_pair(v.counts.totalBytes(),
+                                          v.counts.totalMessages()));
+    } catch (...) {
+        t.last.clear();
+    }
 }
 
 void Backend::doLog(::timeval const time,
                     Priority const priority,
                     char const * const message) noexcept
 {
-    std::lock_guard<std::recursive_mutex> const guard(m_mutex);
-    if (priority <= m_priority)
-        for (auto const & a : m_appenders)
-            a->log(time, priority, message);
+    if (!m_filter.root().enabled(priority)
+        && !LogContext::elevates(priority))
+    {
+        LOGHARD_STATISTICS_ONLY(
+            if (m_counters)
+                BackendCounters::increment(m_counters->filtered);)
+    } else if (!overloadAllows(priority)) {
+        LOGHARD_STATISTICS_ONLY(
+            if (m_counters)
+                BackendCounters::increment(m_counters->dropped);)
+    } else {
+        dispatch(time, priority, message, std::strlen(message));
+    }
+}
+
+void Backend::dispatch(::timeval const time,
+                       Priority const priority,
+                       char const * const message,
+                       std::size_t const size) noexcept
+{
+    Lock lock(m_mutex, std::try_to_lock);
+    #ifndef LOGHARD_NO_STATISTICS
+    if (auto * const counters = m_counters.get()) {
+        std::uint64_t wait = 0u;
+        if (!lock.owns_lock()) {
+            auto const start(std::chrono::steady_clock::now());
+            lock.lock();
+            wait = durationNanoseconds(
+                       std::chrono::steady_clock::now() - start);
+        }
+        counters->lockWait.recordSerialized(wait);
+        BackendCounters::incrementLocked(counters->bytesFormatted, size);
+    }
+    #endif
+    if (!lock.owns_lock())
+        lock.lock();
+    if (m_duplicates.window.count() > 0
+        && suppressDuplicate(time, priority, message, size))
+    {
+        LOGHARD_STATISTICS_ONLY(
+            if (m_counters)
+                BackendCounters::increment(m_counters->suppressed);)
+        return;
+    }
+    if (m_topTalkers.interval.count() > 0
+        && time.tv_sec >= m_topTalkers.next)
+        reportTopTalkersLocked(time);
+    if (!m_overload.enabled)
+        return deliver(time, priority, message, size);
+    auto const start(std::chrono::steady_clock::now());
+    deliver(time, priority, message, size);
+    measureOverload(start, std::chrono::steady_clock::now(), size);
+}
+
+bool Backend::suppressDuplicate(::timeval const time,
+                                Priority const priority,
+                                char const * const message,
+                                std::size_t const size) noexcept
+{
+    auto & d = m_duplicates;
+    if (d.haveLast
+        && priority == d.priority
+        && size == d.message.size()
+        && std::memcmp(message, d.message.data(), size) == 0)
+    {
+        if (elapsed(d.firstTime, time) < d.window) {
+            ++d.repeats;
+            d.lastTime = time;
+            return true;
+        }
+        flushDuplicatesLocked();
+        d.firstTime = time;
+        return false;
+    }
+
+    flushDuplicatesLocked();
+    try {
+        d.message.assign(message, size);
+    } catch (...) {
+        d.haveLast = false;
+        return false;
+    }
+    d.haveLast = true;
+    d.firstTime = time;
+    d.priority = priority;
+    return false;
+}
+
+void Backend::flushDuplicatesLocked() noexcept {
+    auto & d = m_duplicates;
+    if (!d.repeats)
+        return;
+    char summary[64u];
+    auto const size = std::snprintf(summary,
+                                    sizeof(summary),
+                                    "Last message repeated %" PRIu64
+                                    " times.",
+                                    d.repeats);
+    assert(size > 0 && static_cast<std::size_t>(size) < sizeof(summary));
+    d.repeats = 0u;
+    deliver(d.lastTime,
+            d.priority,
+            summary,
+            static_cast<std::size_t>(size));
+}
+
+void Backend::reportTopTalkersLocked(::timeval const time) noexcept {
+    auto & t = m_topTalkers;
+    auto const elapsed = t.interval.count() + (time.tv_sec - t.next);
+    t.next = time.tv_sec + t.interval.count();
+    try {
+        struct Delta {
+            std::uint64_t bytes;
+            std::uint64_t messages;
+            std::string const * path;
+        };
+        auto const volumes(m_filter.volumes());
+        std::vector<Delta> deltas;
+        // Only keep the nodes which still exist, as nodes may be removed:
+        decltype(t.last) next;
+        for (auto const & v : volumes) {
+            auto const bytes = v.counts.totalBytes();
+            auto const messages = v.counts.totalMessages();
+            auto last(std::make_pair(std::uint64_t(0u), std::uint64_t(0u)));
+            auto const it(t.last.find(v.path));
+            // Counts below the last ones are from a node created anew:
+            if ((it != t.last.end()) && (it->second.first <= bytes))
+                last = it->second;
+            if (bytes != last.first)
+                deltas.emplace_back(Delta{bytes - last.first,
+                                          messages - last.second,
+                                          &v.path});
+            next.emplace(v.path, std::make_pair(bytes, messages));
+        }
+        t.last.swap(next);
+        std::sort(deltas.begin(),
+                  deltas.end(),
+                  [](Delta const & lhs, Delta const & rhs)
+                  { return lhs.bytes > rhs.bytes; });
+        if (deltas.size() > t.count)
+            deltas.resize(t.count);
+
+        std::string report("Top talkers in the last ");
+        report.append(std::to_string(elapsed)).append(" s:");
+        for (auto const & d : deltas) {
+            report.append(" ")
+                  .append(d.path->empty() ? "(no prefix)" : *d.path)
+                  .append(" ")
+                  .append(std::to_string(d.bytes))
+                  .append(" bytes in ")
+                  .append(std::to_string(d.messages))
+                  .append(" records;");
+        }
+        if (deltas.empty())
+            report.append(" none;");
+        report.back() = '.';
+        deliver(time, Priority::Normal, report.c_str(), report.size());
+    } catch (...) {}
+}
+
+void Backend::deliver(::timeval const time,
+                      Priority const priority,
+                      char const * const message,
+                      std::size_t const size) noexcept
+{
+    LOGHARD_STATISTICS_ONLY(
+        if (m_counters) {
+            BackendCounters::incrementLocked(
+                        m_counters->records[static_cast<unsigned>(priority)]);
+            BackendCounters::incrementLocked(m_counters->bytesDelivered,
+                                             size);
+        })
+    auto const dispatchChanges = LogHard::Appender::dispatchChanges();
+    if ((!m_dispatchTablesStale
+         && (dispatchChanges == m_dispatchTablesChanges))
+        || updateDispatchTablesLocked(dispatchChanges))
+    {
+        auto const & table =
+                m_dispatchTables[static_cast<std::size_t>(priority)];
+        /* Elevated records may pass appenders regardless of their priority,
+           unless all appenders accept them anyway: */
+        if (!LogContext::elevates(priority)
+            || (table.size() == m_dispatchTables[0u].size()))
+        {
+            Backend * locked = this;
+            Lock ownerLock;
+            for (auto const & t : table) {
+                auto * const owner = t.owner ? t.owner.get() : this;
+                if (owner != locked) {
+                    if (owner != this) {
+                        ownerLock = Lock(owner->m_mutex);
+                        LOGHARD_STATISTICS_ONLY(
+                            if (auto * const counters = owner->counters()) {
+                                BackendCounters::incrementLocked(
+                                        counters->records[
+                                            static_cast<unsigned>(priority)]);
+                                BackendCounters::incrementLocked(
+                                        counters->bytesDelivered,
+                                        size);
+                            })
+                    } else {
+                        ownerLock = Lock();
+                    }
+                    locked = owner;
+                }
+                t.appender->log(time, priority, message, size);
+            }
+            return;
+        }
+    }
+    for (auto const & a : m_appenders)
+        a->log(time, priority, message, size);
+}
+
+bool Backend::updateDispatchTablesLocked(std::uint64_t const dispatchChanges)
+        noexcept
+{
+    m_dispatchTablesStale = true;
+    for (auto & table : m_dispatchTables)
+        table.clear();
+    try {
+        flattenLocked(nullptr, Priority::FullDebug, m_dispatchTables);
+    } catch (...) {
+        for (auto & table : m_dispatchTables)
+            table.clear();
+        return false;
+    }
+    m_dispatchTablesStale = false;
+    m_dispatchTablesChanges = dispatchChanges;
+    return true;
+}
+
+bool Backend::flattenableLocked() const noexcept {
+    return (m_duplicates.window.count() <= 0)
+           && !m_overload.enabled
+           && (m_topTalkers.interval.count() <= 0)
+           && (m_overloadPriority.load(std::memory_order_relaxed)
+               == Priority::FullDebug);
+}
+
+void Backend::flattenLocked(std::shared_ptr<Backend> const & self,
+                            Priority const maxPriority,
+                            DispatchTables & tables)
+{
+    for (auto const & a : m_appenders) {
+        auto const last = std::min(maxPriority, a->priority());
+        if (auto const * const backendAppender =
+                    dynamic_cast<Backend::Appender const *>(a.get()))
+        {
+            auto const & target = backendAppender->m_backend;
+            Lock const lock(target->m_mutex);
+            if (target->flattenableLocked()) {
+                target->flattenLocked(
+                            target,
+                            std::min(last, target->m_filter.root().priority()),
+                            tables);
+                continue;
+            }
+        }
+        for (std::size_t p = 0u; p <= static_cast<std::size_t>(last); ++p)
+            tables[p].emplace_back(DispatchTarget{a, self});
+    }
+}
+
+bool Backend::reaches(Backend const & backend) const noexcept {
+    if (this == &backend)
+        return true;
+    for (auto const * const target : m_targets)
+        if (target->reaches(backend))
+            return true;
+    return false;
+}
+
+void Backend::measureOverload(
+        std::chrono::steady_clock::time_point const start,
+        std::chrono::steady_clock::time_point const end,
+        std::size_t const bytes) noexcept
+{
+    using namespace std::chrono;
+    auto & o = m_overload;
+    o.bytes += bytes;
+    ++o.records;
+    o.latency += end - start;
+    auto const elapsed = duration_cast<microseconds>(end - o.intervalStart);
+    if (elapsed < o.policy.interval)
+        return;
+
+    o.bytesPerSecond = static_cast<std::uint64_t>(
+            static_cast<double>(o.bytes) * 1e6
+            / static_cast<double>(elapsed.count()));
+    o.meanLatency = duration_cast<microseconds>(o.latency / o.records);
+    o.intervalStart = end;
+    o.bytes = 0u;
+    o.records = 0u;
+    o.latency = steady_clock::duration::zero();
+
+    auto const & p = o.policy;
+    bool const overloaded =
+            (p.maxBytesPerSecond && o.bytesPerSecond > p.maxBytesPerSecond)
+            || (p.maxLatency.count() > 0 && o.meanLatency > p.maxLatency);
+    bool const calm =
+            (!p.maxBytesPerSecond
+             || o.bytesPerSecond <= p.maxBytesPerSecond / 2u)
+            && (p.maxLatency.count() <= 0
+                || o.meanLatency <= p.maxLatency / 2);
+    auto const current =
+            static_cast<unsigned>(
+                m_overloadPriority.load(std::memory_order_relaxed));
+    if (overloaded) {
+        o.calmIntervals = 0u;
+        if (current > static_cast<unsigned>(p.floor))
+            setOverloadPriorityLocked(static_cast<Priority>(current - 1u),
+                                      "overloaded");
+    } else if (!calm) {
+        o.calmIntervals = 0u;
+    } else if (current < static_cast<unsigned>(Priority::FullDebug)) {
+        // Idle time without dispatched records counts as calm as well:
+        auto const intervals = static_cast<unsigned>(
+                std::min<decltype(elapsed.count())>(
+                    elapsed / p.interval,
+                    p.recoveryIntervals));
+        o.calmIntervals += intervals;
+        if (o.calmIntervals >= p.recoveryIntervals) {
+            o.calmIntervals = 0u;
+            setOverloadPriorityLocked(static_cast<Priority>(current + 1u),
+                                      "recovered");
+        }
+    }
+}
+
+void Backend::setOverloadPriorityLocked(Priority const priority,
+                                        char const * const reason) noexcept
+{
+    if (m_overloadPriority.exchange(priority, std::memory_order_relaxed)
+        == priority)
+        return;
+    LogHard::Appender::noteDispatchChange();
+    char marker[160u];
+    std::snprintf(marker,
+                  sizeof(marker),
+                  "Overload protection %s, logging priorities up to %s "
+                  "(%" PRIu64 " bytes/s, %lld us mean appender latency).",
+                  reason,
+                  LogHard::Appender::priorityString(priority),
+                  m_overload.bytesPerSecond,
+                  static_cast<long long>(m_overload.meanLatency.count()));
+    ::timeval now;
+    ::gettimeofday(&now, nullptr);
+    deliver(now, Priority::Warning, marker, std::strlen(marker));
 }
 
 } /* namespace LogHard { */
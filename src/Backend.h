@@ -20,12 +20,23 @@
 #ifndef LOGHARD_BACKEND_H
 #define LOGHARD_BACKEND_H
 
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
 #include <utility>
+#include <vector>
 #include "Appender.h"
+#include "Exception.h"
+#include "PrefixFilter.h"
 #include "Priority.h"
+#include "Statistics.h"
 
 
 namespace LogHard {
@@ -40,16 +51,26 @@ public: /* Types: */
 
     using Lock = std::unique_lock<std::recursive_mutex>;
 
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception, LoopException);
+
+    /**
+      \brief An appender forwarding records to another Backend.
+
+      When no duplicate window, overload protection or top talkers report is
+      configured for the target Backend, the Backends it is added to dispatch
+      records directly to the appenders of the target, see addAppender().
+    */
     class Appender: public LogHard::Appender {
 
+        friend class Backend;
+
     public: /* Methods: */
 
         Appender(std::shared_ptr<Backend> backend) noexcept;
         Appender(std::shared_ptr<Backend> backend,
                  Priority const priority) noexcept;
 
-        /// \todo Check for backend loops.
-
         void doLog(::timeval time,
                    Priority const priority,
                    char const * message) noexcept override;
@@ -60,31 +81,243 @@ public: /* Types: */
 
     }; /* class Appender */
 
+    /**
+      \brief Thresholds for the overload protection, see setOverloadPolicy().
+
+      A threshold of zero is ignored. The load is overloaded when any
+      threshold is exceeded over an interval, and calm when all measures are
+      at most half of their thresholds.
+    */
+    struct OverloadPolicy {
+        /** Bytes of messages dispatched per second. */
+        std::uint64_t maxBytesPerSecond = 0u;
+        /** Mean time spent in the appenders per record. */
+        std::chrono::microseconds maxLatency{0};
+        std::chrono::milliseconds interval{100};
+        /** Calm intervals required before restoring a priority level. */
+        unsigned recoveryIntervals = 10u;
+        /** The minimum priority is never raised above this. */
+        Priority floor = Priority::Normal;
+    };
+
+    struct OverloadStatus {
+        Priority priority;
+        std::uint64_t bytesPerSecond;
+        std::chrono::microseconds meanLatency;
+    };
+
 public: /* Methods: */
 
     Backend() noexcept;
     Backend(Priority const priority) noexcept;
+    ~Backend() noexcept;
 
+    /** \brief Sets the priority of the root node of filter(). */
     void setPriority(Priority const priority) noexcept;
 
+    PrefixFilter & filter() noexcept { return m_filter; }
+    PrefixFilter const & filter() const noexcept { return m_filter; }
+
+    /**
+      \brief Adds an appender.
+
+      Backends added as Backend::Appender are flattened into the dispatch
+      tables of this Backend, i.e. records are passed directly to their
+      appenders which accept the record, as limited by the priorities of the
+      Backend::Appender and of the root of the filter() of the target. The
+      target Backend is locked only while calling its appenders, and its
+      statistics count these records as delivered.
+
+      \throws LoopException if the appender is a Backend::Appender whose
+              Backend forwards records to this Backend.
+    */
     void addAppender(std::shared_ptr<LogHard::Appender> appenderPtr);
 
     void removeAppender(std::shared_ptr<LogHard::Appender> appenderPtr)
             noexcept;
 
+    /**
+      \brief Collapses exact repeats of a record (same priority and message,
+             including the prefix) logged within the given window after its
+             first occurrence into a single "Last message repeated N times."
+             record.
+      \param[in] window The window, or zero to disable the suppression.
+    */
+    void setDuplicateWindow(std::chrono::microseconds const window) noexcept;
+
+    /** \brief Logs the pending summary of suppressed duplicates, if any. */
+    void flushDuplicates() noexcept;
+
+    /**
+      \brief Enables adaptive overload protection, which temporarily drops
+             the least severe records when the thresholds of the policy are
+             exceeded. A policy without thresholds disables it.
+      \note The load is only measured when records are dispatched.
+    */
+    void setOverloadPolicy(OverloadPolicy const & policy) noexcept;
+
+    /**
+      \brief Overrides the priority currently imposed by the overload
+             protection. The protection adjusts it further from this level.
+    */
+    void setOverloadPriority(Priority const priority) noexcept;
+
+    bool overloadAllows(Priority const priority) const noexcept
+    { return priority <= m_overloadPriority.load(std::memory_order_relaxed); }
+
+    OverloadStatus overloadStatus() noexcept;
+
+    /**
+      \returns the statistics of the Backend and of its appenders, all zero
+                if statistics are disabled.
+    */
+    BackendStatistics statistics();
+
+    /**
+      \returns the volumes of at most count Logger prefixes which have logged
+               the most bytes, in descending order.
+    */
+    std::vector<PrefixFilter::Volume> topTalkers(std::size_t const count)
+            const;
+
+    /**
+      \brief Enables a periodic "top talkers" report record listing at most
+             count Logger prefixes which have logged the most bytes during the
+             interval. A zero interval disables the report.
+      \note The report is logged before the first record dispatched after the
+            interval has passed.
+    */
+    void setTopTalkersReport(std::chrono::seconds const interval,
+                             std::size_t const count) noexcept;
+
+private: /* Types: */
+
+    struct DispatchTarget {
+        std::shared_ptr<LogHard::Appender> appender;
+        /** The Backend to lock for the appender, or null for this one. */
+        std::shared_ptr<Backend> owner;
+    };
+
+    using DispatchTables =
+            std::array<std::vector<DispatchTarget>,
+                       static_cast<std::size_t>(Priority::FullDebug) + 1u>;
+
 private: /* Methods: */
 
     Lock retrieveLock() noexcept { return Lock(m_mutex); }
 
+    BackendCounters * counters() noexcept { return m_counters.get(); }
+
     void doLog(::timeval const time,
                Priority const priority,
                char const * const message) noexcept;
 
+    /** \brief Like doLog(), but for records which have passed filter(). */
+    void dispatch(::timeval const time,
+                  Priority const priority,
+                  char const * const message,
+                  std::size_t const size) noexcept;
+
+    /** \returns whether the record was suppressed as a duplicate. */
+    bool suppressDuplicate(::timeval const time,
+                           Priority const priority,
+                           char const * const message,
+                           std::size_t const size) noexcept;
+
+    void flushDuplicatesLocked() noexcept;
+
+    void deliver(::timeval const time,
+                 Priority const priority,
+                 char const * const message,
+                 std::size_t const size) noexcept;
+
+    /** \returns whether the dispatch tables could be built. */
+    bool updateDispatchTablesLocked(std::uint64_t const dispatchChanges)
+            noexcept;
+
+    /** \returns whether records can bypass doLog() of this Backend. */
+    bool flattenableLocked() const noexcept;
+
+    /**
+      \brief Adds the appenders of this Backend accepting priorities up to
+             maxPriority to the dispatch tables, flattening nested Backends.
+    */
+    void flattenLocked(std::shared_ptr<Backend> const & self,
+                       Priority const maxPriority,
+                       DispatchTables & tables);
+
+    /**
+      \returns whether this Backend forwards records to the given one.
+      \pre The caller holds the lock guarding m_targets.
+    */
+    bool reaches(Backend const & backend) const noexcept;
+
+    void removeTarget(Backend const & target) noexcept;
+
+    void measureOverload(std::chrono::steady_clock::time_point const start,
+                         std::chrono::steady_clock::time_point const end,
+                         std::size_t const bytes) noexcept;
+
+    void setOverloadPriorityLocked(Priority const priority,
+                                   char const * const reason) noexcept;
+
+    void reportTopTalkersLocked(::timeval const time) noexcept;
+
+private: /* Types: */
+
+    struct Duplicates {
+        std::chrono::microseconds window{0};
+        bool haveLast = false;
+        ::timeval firstTime;
+        ::timeval lastTime;
+        Priority priority;
+        std::string message;
+        std::uint64_t repeats = 0u;
+    };
+
+    struct Overload {
+        bool enabled = false;
+        OverloadPolicy policy;
+        std::chrono::steady_clock::time_point intervalStart;
+        std::uint64_t bytes = 0u;
+        std::uint64_t records = 0u;
+        std::chrono::steady_clock::duration latency{0};
+        unsigned calmIntervals = 0u;
+        std::uint64_t bytesPerSecond = 0u;
+        std::chrono::microseconds meanLatency{0};
+    };
+
+    struct TopTalkers {
+        std::chrono::seconds interval{0};
+        std::size_t count = 0u;
+        ::time_t next = 0;
+        /** Bytes and messages of each prefix at the previous report. */
+        std::map<std::string, std::pair<std::uint64_t, std::uint64_t> > last;
+    };
+
 private: /* Fields: */
 
     std::recursive_mutex m_mutex;
     std::set<std::shared_ptr<LogHard::Appender> > m_appenders;
-    Priority m_priority = Priority::Normal;
+    /**
+      The Backends of the Backend::Appenders in m_appenders, guarded by a
+      global lock instead of m_mutex for detecting loops.
+    */
+    std::vector<Backend const *> m_targets;
+    /**
+      The appenders accepting each priority, rebuilt on the next delivery
+      after any change counted by Appender::dispatchChanges() or after
+      appenders are added or removed.
+    */
+    DispatchTables m_dispatchTables;
+    bool m_dispatchTablesStale = true;
+    std::uint64_t m_dispatchTablesChanges = 0u;
+    PrefixFilter m_filter;
+    Duplicates m_duplicates;
+    Overload m_overload;
+    TopTalkers m_topTalkers;
+    std::atomic<Priority> m_overloadPriority{Priority::FullDebug};
+    std::unique_ptr<BackendCounters> const m_counters;
 
 }; /* class Backend { */
 
@@ -23,9 +23,25 @@
 #include "CAPI.h"
 #include "CFileAppender.h"
 #include "FileAppender.h"
+#include "PrioritySpec.h"
 #include "StdAppender.h"
 
 
+namespace {
+
+void summarize(LogHard::Histogram::Snapshot const & histogram,
+               LogHardHistogramSummary & summary) noexcept
+{
+    summary.count = histogram.count;
+    summary.sumNs = histogram.sum;
+    summary.p50Ns = histogram.percentile(0.5);
+    summary.p99Ns = histogram.percentile(0.99);
+    summary.p999Ns = histogram.percentile(0.999);
+    summary.maxNs = histogram.max();
+}
+
+} // anonymous namespace
+
 extern "C" {
 
 LOGHARD_LASTERROR_FUNCTIONS_DEFINE(LogHardBackend)
@@ -112,4 +128,56 @@ void LogHardBackend_setPriority(LogHardBackend * backend,
     LOGHARD_NOEXCEPT_END("LHB setPriority")
 }
 
+bool LogHardBackend_applyPrioritySpec(LogHardBackend * backend,
+                                      const char * spec)
+{
+    assert(backend);
+    assert(spec);
+    LOGHARD_EXCEPTIONS_TO_C_BEGIN
+    LogHard::PrioritySpec parsed;
+    try {
+        parsed = LogHard::PrioritySpec(spec);
+    } catch (LogHard::PrioritySpec::ParseException const &) {
+        LogHardBackend_setErrorInval(backend);
+        return false;
+    }
+    parsed.apply(*backend->inner);
+    return true;
+    LOGHARD_EXCEPTIONS_TO_C_END(LogHardBackend,backend, false)
+}
+
+bool LogHardBackend_statistics(LogHardBackend * backend,
+                               LogHardBackendStatistics * statistics)
+{
+    assert(backend);
+    assert(statistics);
+    LOGHARD_EXCEPTIONS_TO_C_BEGIN
+    auto const s(backend->inner->statistics());
+    static_assert(sizeof(statistics->records) / sizeof(std::uint64_t)
+                  == std::tuple_size<decltype(s.records)>::value,
+                  "Priority count mismatch!");
+    for (std::size_t i = 0u; i < s.records.size(); ++i)
+        statistics->records[i] = s.records[i];
+    statistics->bytesFormatted = s.bytesFormatted;
+    statistics->bytesDelivered = s.bytesDelivered;
+    statistics->filtered = s.filtered;
+    statistics->elided = s.elided;
+    statistics->dropped = s.dropped;
+    statistics->suppressed = s.suppressed;
+    summarize(s.lockWait, statistics->lockWait);
+    statistics->appenderRecords = 0u;
+    statistics->appenderBytes = 0u;
+    statistics->appenderFiltered = 0u;
+    LogHard::Histogram::Snapshot latency{};
+    for (auto const & a : s.appenders) {
+        statistics->appenderRecords += a.records;
+        statistics->appenderBytes += a.bytes;
+        statistics->appenderFiltered += a.filtered;
+        latency.merge(a.latency);
+    }
+    summarize(latency, statistics->appenderLatency);
+    return true;
+    LOGHARD_EXCEPTIONS_TO_C_END(LogHardBackend,backend, false)
+}
+
 } // extern "C" {
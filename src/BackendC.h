@@ -24,6 +24,7 @@
 #include <sharemind/extern_c.h>
 #include <sharemind/lasterror.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include "ErrorC.h"
 #include "PriorityC.h"
@@ -34,6 +35,32 @@ SHAREMIND_EXTERN_C_BEGIN
 struct LogHardLogger;
 struct LogHardBackend;
 
+/** Summary of a histogram of durations, percentiles are bucket bounds. */
+typedef struct LogHardHistogramSummary_ {
+    uint64_t count;
+    uint64_t sumNs;
+    uint64_t p50Ns;
+    uint64_t p99Ns;
+    uint64_t p999Ns;
+    uint64_t maxNs;
+} LogHardHistogramSummary;
+
+/** See LogHard::BackendStatistics, appender statistics are summed up. */
+typedef struct LogHardBackendStatistics_ {
+    uint64_t records[LOGHARD_PRIORITY_FULLDEBUG + 1];
+    uint64_t bytesFormatted;
+    uint64_t bytesDelivered;
+    uint64_t filtered;
+    uint64_t elided;
+    uint64_t dropped;
+    uint64_t suppressed;
+    LogHardHistogramSummary lockWait;
+    uint64_t appenderRecords;
+    uint64_t appenderBytes;
+    uint64_t appenderFiltered;
+    LogHardHistogramSummary appenderLatency;
+} LogHardBackendStatistics;
+
 LogHardBackend * LogHardBackend_new(LogHardError * error,
                                     const char ** errorStr)
         __attribute__ ((warn_unused_result));
@@ -66,6 +93,20 @@ void LogHardBackend_setPriority(LogHardBackend * backend,
                                 const LogHardPriority priority)
          SHAREMIND_NDEBUG_ONLY(__attribute__ ((nonnull(1))));
 
+/**
+  Applies a priority specification like "*=warn,Network=debug" to the backend.
+  On failure, false is returned and nothing is changed. LOGHARD_INVALID_ARGUMENT
+  is set as the last error if the specification could not be parsed.
+*/
+bool LogHardBackend_applyPrioritySpec(LogHardBackend * backend,
+                                      const char * spec)
+         SHAREMIND_NDEBUG_ONLY(__attribute__ ((nonnull(1, 2))));
+
+/** Stores the statistics of the backend, all zero if they are disabled. */
+bool LogHardBackend_statistics(LogHardBackend * backend,
+                               LogHardBackendStatistics * statistics)
+         SHAREMIND_NDEBUG_ONLY(__attribute__ ((nonnull(1, 2))));
+
 LogHardLogger * LogHardBackend_newLogger(LogHardBackend * backend,
                                          const char * prefix)
          __attribute__ ((SHAREMIND_NDEBUG_ONLY(nonnull(1, 2),)
@@ -57,6 +57,10 @@
     SHAREMIND_LASTERROR_PRIVATE_SHORTCUT_DECLARE( \
             ClassName, \
             Unknown,, \
+            SHAREMIND_COMMA visibility("internal")) \
+    SHAREMIND_LASTERROR_PRIVATE_SHORTCUT_DECLARE( \
+            ClassName, \
+            Inval,, \
             SHAREMIND_COMMA visibility("internal"))
 
 #define LOGHARD_LASTERROR_FUNCTIONS_DEFINE(ClassName) \
@@ -87,7 +91,12 @@
             ClassName, \
             Unknown,, \
             LOGHARD_UNKNOWN_ERROR, \
-            "Unknown error!")
+            "Unknown error!") \
+    SHAREMIND_LASTERROR_PRIVATE_SHORTCUT_DEFINE( \
+            ClassName, \
+            Inval,, \
+            LOGHARD_INVALID_ARGUMENT, \
+            "Invalid argument!")
 
 
 struct LogHardBackend {
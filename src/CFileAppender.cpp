@@ -19,59 +19,53 @@
 
 #include "CFileAppender.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstring>
 #include <ctime>
 #include <exception>
+#include <new>
 #include <sharemind/DebugOnly.h>
 #include <sys/uio.h>
+#include <type_traits>
 #include <unistd.h>
+#include <utility>
 
 
 namespace LogHard {
 
 namespace {
 
+/**
+  The timestamp of the previous record of the thread. All appenders of a
+  record and all records logged within the same second share it.
+*/
+thread_local bool tl_timeStampCached = false;
+thread_local ::time_t tl_timeStampSecond;
+thread_local char tl_timeStamp[CFileAppender::timeStampSize];
+
 void logToFile_(int const fd,
-                ::timeval time,
-                Priority const priority,
-                char const * const message) noexcept
+                CFileAppender::FormattedLine const & line) noexcept
 {
     assert(fd != -1);
-    assert(message);
-    constexpr std::size_t bufSize = sizeof("YYYY.MM.DD HH:MM:SS");
-    char timeStampBuf[bufSize];
-    {
-        std::tm eventTimeTm;
-        {
-            SHAREMIND_DEBUG_ONLY(auto const r =)
-                    ::localtime_r(&time.tv_sec, &eventTimeTm);
-            assert(r);
-        }
-        {
-            SHAREMIND_DEBUG_ONLY(auto const r =)
-                    std::strftime(timeStampBuf,
-                                  bufSize,
-                                  "%Y.%m.%d %H:%M:%S",
-                                  &eventTimeTm);
-            assert(r == bufSize - 1u);
-        }
-    }
-    iovec const iov[] = {
-        { const_cast<char *>(timeStampBuf), bufSize - 1u },
-        { const_cast<char *>(" "), 1u },
-        { const_cast<char *>(Appender::priorityStringRightPadded(priority)),
-          7u },
-        { const_cast<char *>(" "), 1u },
-        { const_cast<char *>(message), std::strlen(message) },
-        { const_cast<char *>("\n"), 1u }
-    };
     #ifdef __GNUC__
     #pragma GCC diagnostic push
     #pragma GCC diagnostic ignored "-Wunused-result"
     #endif
-    (void) writev(fd, iov, sizeof(iov) / sizeof(iovec));
+    (void) writev(fd, line.iov(), CFileAppender::FormattedLine::iovCount);
+    #ifdef __GNUC__
+    #pragma GCC diagnostic pop
+    #endif
+}
+
+void logToFile_(int const fd, Layout::FormattedLine const & line) noexcept {
+    assert(fd != -1);
+    #ifdef __GNUC__
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wunused-result"
+    #endif
+    (void) writev(fd, line.iov(), line.iovCount());
     #ifdef __GNUC__
     #pragma GCC diagnostic pop
     #endif
@@ -79,6 +73,37 @@ void logToFile_(int const fd,
 
 } // anonymous namespace
 
+constexpr std::size_t CFileAppender::timeStampSize;
+constexpr int CFileAppender::FormattedLine::iovCount;
+
+CFileAppender::FormattedLine::FormattedLine(::timeval time,
+                                            Priority const priority,
+                                            char const * const message)
+        noexcept
+    : m_iov{
+        { m_timeStamp, CFileAppender::timeStampSize },
+        { const_cast<char *>(" "), 1u },
+        { const_cast<char *>(Appender::priorityStringRightPadded(priority)),
+          7u },
+        { const_cast<char *>(" "), 1u },
+        { const_cast<char *>((assert(message), message)),
+          std::strlen(message) },
+        { const_cast<char *>("\n"), 1u }
+      }
+{ CFileAppender::formatTimeStamp(m_timeStamp, time); }
+
+std::size_t CFileAppender::FormattedLine::size() const noexcept {
+    return timeStampSize + 1u + 7u + 1u + m_iov[4u].iov_len + 1u;
+}
+
+char * CFileAppender::FormattedLine::copyTo(char * dest) const noexcept {
+    for (::iovec const & v : m_iov) {
+        std::memcpy(dest, v.iov_base, v.iov_len);
+        dest += v.iov_len;
+    }
+    return dest;
+}
+
 SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
                                     CFileAppender::,
                                     Exception);
@@ -99,20 +124,140 @@ CFileAppender::CFileAppender(std::FILE * const file)
     }
 }
 
+CFileAppender::CFileAppender(std::FILE * const file, Layout layout)
+    : CFileAppender(file)
+{ m_layout.reset(new Layout(std::move(layout))); }
+
 CFileAppender::~CFileAppender() noexcept {}
 
+void CFileAppender::formatTimeStamp(char * const buffer, ::timeval time)
+        noexcept
+{
+    assert(buffer);
+    if (!tl_timeStampCached || (tl_timeStampSecond != time.tv_sec)) {
+        std::tm eventTimeTm;
+        {
+            SHAREMIND_DEBUG_ONLY(auto const r =)
+                    ::localtime_r(&time.tv_sec, &eventTimeTm);
+            assert(r);
+        }
+        {
+            SHAREMIND_DEBUG_ONLY(auto const r =)
+                    std::strftime(buffer,
+                                  timeStampSize + 1u,
+                                  "%Y.%m.%d %H:%M:%S",
+                                  &eventTimeTm);
+            assert(r == timeStampSize);
+        }
+        std::memcpy(tl_timeStamp, buffer, timeStampSize);
+        tl_timeStampSecond = time.tv_sec;
+        tl_timeStampCached = true;
+        return;
+    }
+    std::memcpy(buffer, tl_timeStamp, timeStampSize);
+    buffer[timeStampSize] = '\0';
+}
+
+void CFileAppender::logToFile(int const fd, FormattedLine const & line)
+        noexcept
+{ logToFile_(fd, line); }
+
+void CFileAppender::logToFile(int const fd, Layout::FormattedLine const & line)
+        noexcept
+{ logToFile_(fd, line); }
+
+std::size_t CFileAppender::logToFile(int const fd,
+                                     LogRecord const * records,
+                                     std::size_t size) noexcept
+{
+    assert(fd != -1);
+    // Up to linesPerWrite records are written by a single writev() call:
+    constexpr std::size_t linesPerWrite = 64u;
+    using LineStorage =
+            std::aligned_storage<sizeof(FormattedLine),
+                                 alignof(FormattedLine)>::type;
+    LineStorage lines[linesPerWrite];
+    ::iovec iov[linesPerWrite * FormattedLine::iovCount];
+    std::size_t written = 0u;
+    while (size) {
+        std::size_t const n = std::min(size, linesPerWrite);
+        ::iovec * out = iov;
+        for (std::size_t i = 0u; i < n; ++i) {
+            FormattedLine const * const line =
+                    new (&lines[i]) FormattedLine(records[i].time,
+                                                  records[i].priority,
+                                                  records[i].message);
+            static_assert(std::is_trivially_destructible<FormattedLine>::value,
+                          "");
+            out = std::copy(line->iov(), line->iov() + FormattedLine::iovCount,
+                            out);
+            written += line->size();
+        }
+        #ifdef __GNUC__
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wunused-result"
+        #endif
+        (void) writev(fd, iov, static_cast<int>(out - iov));
+        #ifdef __GNUC__
+        #pragma GCC diagnostic pop
+        #endif
+        records += n;
+        size -= n;
+    }
+    return written;
+}
+
+std::size_t CFileAppender::logToFile(int const fd,
+                                     Layout const & layout,
+                                     LogRecord const * records,
+                                     std::size_t size) noexcept
+{
+    using Line = Layout::FormattedLine;
+    assert(fd != -1);
+    // Laid out lines are larger, so fewer of them are written at once:
+    constexpr std::size_t linesPerWrite = 16u;
+    using LineStorage = std::aligned_storage<sizeof(Line), alignof(Line)>::type;
+    LineStorage lines[linesPerWrite];
+    ::iovec iov[linesPerWrite * Line::maxIovCount];
+    std::size_t written = 0u;
+    while (size) {
+        std::size_t const n = std::min(size, linesPerWrite);
+        ::iovec * out = iov;
+        for (std::size_t i = 0u; i < n; ++i) {
+            Line const * const line = new (&lines[i]) Line(layout,
+                                                           records[i].time,
+                                                           records[i].priority,
+                                                           records[i].message);
+            static_assert(std::is_trivially_destructible<Line>::value, "");
+            out = std::copy(line->iov(), line->iov() + line->iovCount(), out);
+            written += line->size();
+        }
+        #ifdef __GNUC__
+        #pragma GCC diagnostic push
+        #pragma GCC diagnostic ignored "-Wunused-result"
+        #endif
+        (void) writev(fd, iov, static_cast<int>(out - iov));
+        #ifdef __GNUC__
+        #pragma GCC diagnostic pop
+        #endif
+        records += n;
+        size -= n;
+    }
+    return written;
+}
+
 void CFileAppender::logToFile(int const fd,
                               ::timeval time,
                               Priority const priority,
                               char const * const message) noexcept
-{ logToFile_(fd, time, priority, message); }
+{ logToFile_(fd, FormattedLine(time, priority, message)); }
 
 void CFileAppender::logToFileSync(int const fd,
                                   ::timeval time,
                                   Priority const priority,
                                   char const * const message) noexcept
 {
-    logToFile_(fd, time, priority, message);
+    logToFile_(fd, FormattedLine(time, priority, message));
     ::fsync(fd);
 }
 
@@ -139,6 +284,22 @@ void CFileAppender::logToFileSync(std::FILE * file,
 void CFileAppender::doLog(::timeval time,
                           Priority const priority,
                           char const * message) noexcept
-{ logToFileSync(m_fd, time, priority, message); }
+{
+    if (!m_layout)
+        return logToFileSync(m_fd, time, priority, message);
+    logToFile_(m_fd, Layout::FormattedLine(*m_layout, time, priority, message));
+    ::fsync(m_fd);
+}
+
+void CFileAppender::doLogBatch(LogRecord const * records, std::size_t size)
+        noexcept
+{
+    if (m_layout) {
+        logToFile(m_fd, *m_layout, records, size);
+    } else {
+        logToFile(m_fd, records, size);
+    }
+    ::fsync(m_fd);
+}
 
 } /* namespace LogHard { */
@@ -22,9 +22,13 @@
 
 #include "Appender.h"
 
+#include <cstddef>
 #include <cstdio>
+#include <memory>
 #include <sharemind/ExceptionMacros.h>
+#include <sys/uio.h>
 #include "Exception.h"
+#include "Layout.h"
 
 
 namespace LogHard {
@@ -37,11 +41,67 @@ public: /* Types: */
     SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
                                                    InvalidFileException);
 
+public: /* Constants: */
+
+    /// Length of "YYYY.MM.DD HH:MM:SS" timestamps, excluding the terminator.
+    constexpr static std::size_t timeStampSize =
+            sizeof("YYYY.MM.DD HH:MM:SS") - 1u;
+
+    /** A log line laid out as an I/O vector for writev() and friends. */
+    class FormattedLine {
+
+    public: /* Constants: */
+
+        constexpr static int iovCount = 6;
+
+    public: /* Methods: */
+
+        FormattedLine(::timeval time,
+                      Priority const priority,
+                      char const * const message) noexcept;
+
+        FormattedLine(FormattedLine const &) = delete;
+        FormattedLine & operator=(FormattedLine const &) = delete;
+
+        ::iovec const * iov() const noexcept { return m_iov; }
+
+        std::size_t size() const noexcept;
+
+        /** \returns a pointer past the last character written. */
+        char * copyTo(char * dest) const noexcept;
+
+    private: /* Fields: */
+
+        char m_timeStamp[timeStampSize + 1u];
+        ::iovec const m_iov[iovCount];
+
+    }; /* class FormattedLine { */
+
 public: /* Methods: */
 
     CFileAppender(std::FILE * const file);
+    CFileAppender(std::FILE * const file, Layout layout);
     ~CFileAppender() noexcept override;
 
+    /// \param[out] buffer Space for at least timeStampSize + 1 characters.
+    static void formatTimeStamp(char * const buffer, ::timeval time) noexcept;
+
+    static void logToFile(int const fd, FormattedLine const & line) noexcept;
+
+    static void logToFile(int const fd,
+                          Layout::FormattedLine const & line) noexcept;
+
+    /** \returns the number of bytes the records were formatted to. */
+    static std::size_t logToFile(int const fd,
+                                 LogRecord const * records,
+                                 std::size_t size) noexcept;
+
+    /** \returns the number of bytes the records were formatted to. */
+    static std::size_t logToFile(int const fd,
+                                 Layout const & layout,
+                                 LogRecord const * records,
+                                 std::size_t size) noexcept;
+
     static void logToFile(int const fd,
                           ::timeval time,
                           Priority const priority,
@@ -68,9 +128,14 @@ private: /* Methods: */
                Priority const priority,
                char const * message) noexcept override;
 
+    void doLogBatch(LogRecord const * records,
+                    std::size_t size) noexcept override;
+
 private: /* Fields: */
 
     int const m_fd;
+    /** If null, lines are laid out by FormattedLine. */
+    std::unique_ptr<Layout const> m_layout;
 
 }; /* class CFileAppender { */
 
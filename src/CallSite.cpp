@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "CallSite.h"
+
+#include <cassert>
+#include <cstring>
+
+
+namespace LogHard {
+
+namespace {
+
+std::atomic<CallSite *> registeredSites{nullptr};
+
+} // anonymous namespace
+
+constexpr unsigned char CallSite::REGISTERED;
+
+void CallSite::setMode(Mode const mode) noexcept {
+    auto state = m_state.load(std::memory_order_relaxed);
+    unsigned char newState;
+    do {
+        newState = static_cast<unsigned char>(
+                       (state & REGISTERED) | static_cast<unsigned char>(mode));
+    } while (!m_state.compare_exchange_weak(state,
+                                            newState,
+                                            std::memory_order_relaxed));
+}
+
+CallSite * CallSite::first() noexcept
+{ return registeredSites.load(std::memory_order_acquire); }
+
+std::size_t CallSite::setMode(char const * const file,
+                              unsigned const line,
+                              Mode const mode) noexcept
+{
+    assert(file);
+    std::size_t const fileSize = std::strlen(file);
+    std::size_t r = 0u;
+    for (CallSite * site = first(); site; site = site->next()) {
+        if (line && site->m_line != line)
+            continue;
+        std::size_t const siteFileSize = std::strlen(site->m_file);
+        if (siteFileSize < fileSize
+            || std::strcmp(site->m_file + (siteFileSize - fileSize), file) != 0)
+            continue;
+        site->setMode(mode);
+        ++r;
+    }
+    return r;
+}
+
+void CallSite::registerSite() noexcept {
+    // Only the first thread to set the flag links the call site in:
+    if (m_state.fetch_or(REGISTERED, std::memory_order_relaxed) & REGISTERED)
+        return;
+    CallSite * head = registeredSites.load(std::memory_order_relaxed);
+    do {
+        m_next = head;
+    } while (!registeredSites.compare_exchange_weak(
+                 head,
+                 this,
+                 std::memory_order_release,
+                 std::memory_order_relaxed));
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_CALLSITE_H
+#define LOGHARD_CALLSITE_H
+
+#include <atomic>
+#include <cstddef>
+#include "Priority.h"
+
+
+namespace LogHard {
+
+/**
+  \brief A static descriptor of a logging statement, see LOGHARD_LOG.
+
+  Call sites register themselves in a global list when they are executed for
+  the first time. Each call site can be switched individually to always log
+  regardless of the priority filters, or to never log.
+
+  \warning Call sites of unloaded shared objects are not removed from the list.
+*/
+class CallSite {
+
+public: /* Types: */
+
+    enum class Mode : unsigned char {
+        /** Log if the priority passes the Logger filter. */
+        Default = 0u,
+        /** Always log. */
+        Enabled = 2u,
+        /** Never log. */
+        Disabled = 4u
+    };
+
+public: /* Methods: */
+
+    constexpr CallSite(char const * const file,
+                       unsigned const line,
+                       char const * const function,
+                       Priority const priority) noexcept
+        : m_file(file)
+        , m_line(line)
+        , m_function(function)
+        , m_priority(priority)
+    {}
+
+    CallSite(CallSite const &) = delete;
+    CallSite & operator=(CallSite const &) = delete;
+
+    /** \returns the mode of the call site, registering it if needed. */
+    Mode mode() noexcept {
+        auto const state = m_state.load(std::memory_order_relaxed);
+        if (!(state & REGISTERED))
+            registerSite();
+        return static_cast<Mode>(state & ~REGISTERED);
+    }
+
+    void setMode(Mode const mode) noexcept;
+
+    char const * file() const noexcept { return m_file; }
+    unsigned line() const noexcept { return m_line; }
+    char const * function() const noexcept { return m_function; }
+    Priority priority() const noexcept { return m_priority; }
+
+    /** \returns the most recently registered call site. */
+    static CallSite * first() noexcept;
+
+    /** \returns the call site registered before this one. */
+    CallSite * next() const noexcept { return m_next; }
+
+    /**
+      \brief Sets the mode of all registered call sites in files whose path
+             ends with the given file name, on the given line (or on all lines
+             if the line is 0).
+      \returns the number of call sites changed.
+    */
+    static std::size_t setMode(char const * const file,
+                               unsigned const line,
+                               Mode const mode) noexcept;
+
+private: /* Methods: */
+
+    void registerSite() noexcept;
+
+private: /* Constants: */
+
+    constexpr static unsigned char REGISTERED = 1u;
+
+private: /* Fields: */
+
+    char const * const m_file;
+    unsigned const m_line;
+    char const * const m_function;
+    Priority const m_priority;
+    std::atomic<unsigned char> m_state{0u};
+    CallSite * m_next = nullptr;
+
+}; /* class CallSite { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_CALLSITE_H */
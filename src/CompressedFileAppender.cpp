@@ -0,0 +1,525 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "CompressedFileAppender.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sharemind/Concat.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "CFileAppender.h"
+
+#ifdef LOGHARD_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+
+namespace LogHard {
+
+namespace {
+
+constexpr std::size_t QUEUE_BLOCKS = 4u;
+constexpr char const FRAME_MAGIC[4u] = { 'L', 'H', 'C', 'F' };
+
+void storeU32(unsigned char * const out, std::uint32_t const v) noexcept {
+    out[0u] = static_cast<unsigned char>(v);
+    out[1u] = static_cast<unsigned char>(v >> 8u);
+    out[2u] = static_cast<unsigned char>(v >> 16u);
+    out[3u] = static_cast<unsigned char>(v >> 24u);
+}
+
+std::uint32_t loadU32(unsigned char const * const in) noexcept {
+    return static_cast<std::uint32_t>(in[0u])
+           | (static_cast<std::uint32_t>(in[1u]) << 8u)
+           | (static_cast<std::uint32_t>(in[2u]) << 16u)
+           | (static_cast<std::uint32_t>(in[3u]) << 24u);
+}
+
+std::size_t compressBound_(CompressedFileAppender::Codec const codec,
+                           std::size_t const size) noexcept
+{
+    #ifdef LOGHARD_HAVE_ZSTD
+    if (codec == CompressedFileAppender::Codec::Zstd)
+        return ::ZSTD_compressBound(size);
+    #else
+    (void) codec;
+    #endif
+    return ::compressBound(static_cast<::uLong>(size));
+}
+
+/** \returns the compressed size, or 0 on failure. */
+std::size_t compress_(CompressedFileAppender::Codec const codec,
+                      char const * const in,
+                      std::size_t const inSize,
+                      unsigned char * const out,
+                      std::size_t const outSize) noexcept
+{
+    #ifdef LOGHARD_HAVE_ZSTD
+    if (codec == CompressedFileAppender::Codec::Zstd) {
+        auto const r = ::ZSTD_compress(out, outSize, in, inSize, 3);
+        return ::ZSTD_isError(r) ? 0u : r;
+    }
+    #else
+    (void) codec;
+    #endif
+    ::uLongf destSize = static_cast<::uLongf>(outSize);
+    if (::compress2(out,
+                    &destSize,
+                    reinterpret_cast<::Bytef const *>(in),
+                    static_cast<::uLong>(inSize),
+                    Z_DEFAULT_COMPRESSION) != Z_OK)
+        return 0u;
+    return destSize;
+}
+
+bool decompress_(CompressedFileAppender::Codec const codec,
+                 unsigned char const * const in,
+                 std::size_t const inSize,
+                 char * const out,
+                 std::size_t const outSize) noexcept
+{
+    #ifdef LOGHARD_HAVE_ZSTD
+    if (codec == CompressedFileAppender::Codec::Zstd) {
+        auto const r = ::ZSTD_decompress(out, outSize, in, inSize);
+        return !::ZSTD_isError(r) && (r == outSize);
+    }
+    #endif
+    if (codec != CompressedFileAppender::Codec::Zlib)
+        return false;
+    ::uLongf destSize = static_cast<::uLongf>(outSize);
+    return (::uncompress(reinterpret_cast<::Bytef *>(out),
+                         &destSize,
+                         in,
+                         static_cast<::uLong>(inSize)) == Z_OK)
+           && (destSize == outSize);
+}
+
+void writevAll(int const fd, ::iovec * iov, int iovCount) noexcept {
+    while (iovCount > 0) {
+        auto r = ::writev(fd, iov, iovCount);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        while ((iovCount > 0) && (static_cast<std::size_t>(r) >= iov->iov_len))
+        {
+            r -= static_cast<decltype(r)>(iov->iov_len);
+            ++iov;
+            --iovCount;
+        }
+        if (iovCount > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + r;
+            iov->iov_len -= static_cast<std::size_t>(r);
+        }
+    }
+}
+
+/** \returns the number of bytes read, less than size only on EOF. */
+std::size_t readAll(int const fd, void * const buffer, std::size_t const size)
+{
+    std::size_t done = 0u;
+    while (done < size) {
+        auto const r = ::read(fd, static_cast<char *>(buffer) + done,
+                              size - done);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            throw CompressedFileReader::ReadException();
+        }
+        if (r == 0)
+            break;
+        done += static_cast<std::size_t>(r);
+    }
+    return done;
+}
+
+} // anonymous namespace
+
+constexpr std::size_t CompressedFileAppender::frameHeaderSize;
+constexpr std::size_t CompressedFileAppender::maxBlockSize;
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    CompressedFileAppender::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        CompressedFileAppender::Exception,
+        CompressedFileAppender::,
+        FileOpenException);
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        CompressedFileAppender::Exception,
+        CompressedFileAppender::,
+        UnsupportedCodecException,
+        "Compression codec not supported by this build!");
+
+CompressedFileAppender::CompressedFileAppender(
+        std::string const & path,
+        FileAppender::OpenMode const openMode,
+        Codec const codec,
+        std::size_t const blockSize,
+        std::chrono::milliseconds const flushInterval,
+        ::mode_t const flags)
+    : CompressedFileAppender(path.c_str(),
+                             openMode,
+                             codec,
+                             blockSize,
+                             flushInterval,
+                             flags)
+{}
+
+CompressedFileAppender::CompressedFileAppender(
+        char const * const path,
+        FileAppender::OpenMode const openMode,
+        Codec const codec,
+        std::size_t const blockSize,
+        std::chrono::milliseconds const flushInterval,
+        ::mode_t const flags)
+    : m_codec(codecSupported(codec)
+              ? codec
+              : throw UnsupportedCodecException())
+    , m_fd(::open(path,
+                  O_WRONLY | O_CREAT | O_APPEND | O_NOCTTY
+                  | ((openMode == FileAppender::OVERWRITE) ? O_TRUNC : 0u),
+                  flags))
+    , m_blockSize(std::min<std::size_t>(std::max<std::size_t>(blockSize, 1u),
+                                        maxBlockSize))
+    , m_flushInterval(flushInterval)
+{
+    try {
+        if (m_fd == -1)
+            throw sharemind::ErrnoException(errno);
+    } catch (...) {
+        std::throw_with_nested(
+                    CompressedFileAppender::FileOpenException(
+                        sharemind::concat(
+                            "Failed to open file \"",
+                            path,
+                            "\" for logging!")));
+    }
+    try {
+        m_blocks.resize(QUEUE_BLOCKS);
+        for (auto & block : m_blocks)
+            block.reserve(m_blockSize);
+        m_thread = std::thread(&CompressedFileAppender::compressorThread,
+                               this);
+    } catch (...) {
+        ::close(m_fd);
+        throw;
+    }
+}
+
+CompressedFileAppender::~CompressedFileAppender() noexcept {
+    flush();
+    {
+        std::lock_guard<std::mutex> const guard(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+    ::close(m_fd);
+}
+
+CompressedFileAppender::Codec CompressedFileAppender::defaultCodec() noexcept {
+    #ifdef LOGHARD_HAVE_ZSTD
+    return Codec::Zstd;
+    #else
+    return Codec::Zlib;
+    #endif
+}
+
+bool CompressedFileAppender::codecSupported(Codec const codec) noexcept {
+    #ifdef LOGHARD_HAVE_ZSTD
+    if (codec == Codec::Zstd)
+        return true;
+    #endif
+    return codec == Codec::Zlib;
+}
+
+void CompressedFileAppender::flush() noexcept {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!currentBlock().empty())
+        submitBlock(lock);
+    m_cond.wait(lock, [this]() noexcept { return m_completed == m_submitted; });
+}
+
+void CompressedFileAppender::submitBlock(std::unique_lock<std::mutex> & lock)
+        noexcept
+{
+    assert(lock.owns_lock());
+    ++m_submitted;
+    m_cond.notify_all();
+    // Wait for the next block to be freed by the compressor:
+    m_cond.wait(lock,
+                [this]() noexcept
+                { return m_submitted - m_completed < m_blocks.size(); });
+    assert(currentBlock().empty());
+}
+
+void CompressedFileAppender::doLog(::timeval time,
+                                   Priority const priority,
+                                   char const * message) noexcept
+{
+    using Line = CFileAppender::FormattedLine;
+    Line const line(time, priority, message);
+    auto const size = std::min(line.size(), maxBlockSize);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (currentBlock().size() + size > m_blockSize
+        && !currentBlock().empty())
+        submitBlock(lock);
+    auto & block = currentBlock();
+    auto const oldSize = block.size();
+    try {
+        // Only allocates for records larger than the block size:
+        block.resize(oldSize + size);
+    } catch (...) {
+        return;
+    }
+    if (size == line.size()) {
+        line.copyTo(&block[oldSize]);
+        return;
+    }
+    // Truncate the record to maxBlockSize, keeping the newline:
+    char * out = &block[oldSize];
+    std::size_t left = size - 1u;
+    for (std::size_t i = 0u; left && (i < Line::iovCount); ++i) {
+        auto const n = std::min(line.iov()[i].iov_len, left);
+        std::memcpy(out, line.iov()[i].iov_base, n);
+        out += n;
+        left -= n;
+    }
+    *out = '\n';
+}
+
+void CompressedFileAppender::compressorThread() noexcept {
+    std::vector<unsigned char> out;
+    try {
+        out.resize(frameHeaderSize + compressBound_(m_codec, m_blockSize));
+    } catch (...) {
+        out.resize(frameHeaderSize); // Will try to grow for every block.
+    }
+    auto const pending = [this]() noexcept
+                         { return m_stop || (m_completed != m_submitted); };
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        if (m_flushInterval.count() <= 0) {
+            m_cond.wait(lock, pending);
+        } else if (!m_cond.wait_for(lock, m_flushInterval, pending)) {
+            /* Idle for the interval, hence the next block is free and the
+               partial block can be submitted: */
+            if (currentBlock().empty())
+                continue;
+            ++m_submitted;
+        }
+        if (m_completed == m_submitted) {
+            assert(m_stop);
+            return;
+        }
+        auto & block = m_blocks[m_completed % m_blocks.size()];
+        lock.unlock();
+
+        assert(!block.empty());
+        auto const bound = compressBound_(m_codec, block.size());
+        if (block.size() <= UINT32_MAX) {
+            try {
+                if (out.size() < frameHeaderSize + bound)
+                    out.resize(frameHeaderSize + bound);
+            } catch (...) {}
+        }
+        std::size_t compressedSize = 0u;
+        if (out.size() >= frameHeaderSize + bound)
+            compressedSize = compress_(m_codec,
+                                       block.data(),
+                                       block.size(),
+                                       out.data() + frameHeaderSize,
+                                       bound);
+        if (compressedSize) {
+            unsigned char * const h = out.data();
+            std::memcpy(h, FRAME_MAGIC, 4u);
+            h[4u] = static_cast<unsigned char>(m_codec);
+            h[5u] = h[6u] = h[7u] = 0u;
+            storeU32(h + 8u, static_cast<std::uint32_t>(block.size()));
+            storeU32(h + 12u, static_cast<std::uint32_t>(compressedSize));
+            storeU32(h + 16u,
+                     static_cast<std::uint32_t>(
+                         ::crc32(0u,
+                                 h + frameHeaderSize,
+                                 static_cast<::uInt>(compressedSize))));
+            ::iovec iov = { h, frameHeaderSize + compressedSize };
+            writevAll(m_fd, &iov, 1);
+        } // else the block is lost, but there's nowhere to report this.
+        block.clear();
+
+        lock.lock();
+        ++m_completed;
+        m_cond.notify_all();
+    }
+}
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    CompressedFileReader::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        CompressedFileReader::Exception,
+        CompressedFileReader::,
+        FileOpenException);
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        CompressedFileReader::Exception,
+        CompressedFileReader::,
+        ReadException,
+        "Failed to read compressed log file!");
+SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
+        CompressedFileReader::Exception,
+        CompressedFileReader::,
+        CorruptFrameException,
+        "Corrupt frame in compressed log file!");
+
+CompressedFileReader::CompressedFileReader(std::string const & path,
+                                           unsigned const threads)
+    : CompressedFileReader(path.c_str(), threads)
+{}
+
+CompressedFileReader::CompressedFileReader(char const * const path,
+                                           unsigned const threads)
+    : m_fd(::open(path, O_RDONLY | O_NOCTTY))
+    , m_threads(threads
+                ? threads
+                : std::max(std::thread::hardware_concurrency(), 1u))
+{
+    try {
+        if (m_fd == -1)
+            throw sharemind::ErrnoException(errno);
+    } catch (...) {
+        std::throw_with_nested(
+                    CompressedFileReader::FileOpenException(
+                        sharemind::concat(
+                            "Failed to open compressed log file \"",
+                            path,
+                            "\"!")));
+    }
+}
+
+CompressedFileReader::~CompressedFileReader() noexcept { ::close(m_fd); }
+
+std::size_t CompressedFileReader::decompressTo(std::ostream & out) {
+    using Codec = CompressedFileAppender::Codec;
+    constexpr auto headerSize = CompressedFileAppender::frameHeaderSize;
+    struct Frame {
+        Codec codec;
+        std::vector<unsigned char> compressed;
+        std::vector<char> data;
+        bool ok;
+    };
+    std::vector<Frame> frames(m_threads);
+    std::size_t total = 0u;
+    m_truncated = false;
+    struct ::stat st;
+    if (::fstat(m_fd, &st) != 0)
+        throw ReadException();
+    auto const offset = ::lseek(m_fd, 0, SEEK_CUR);
+    if (offset < 0)
+        throw ReadException();
+    auto left = static_cast<std::uint64_t>(std::max(st.st_size - offset,
+                                                    static_cast<::off_t>(0)));
+    while (!m_truncated) {
+        // Read up to m_threads complete frames:
+        std::size_t n = 0u;
+        for (; n < frames.size(); ++n) {
+            unsigned char h[headerSize];
+            auto const headerRead = readAll(m_fd, h, sizeof(h));
+            left -= std::min<std::uint64_t>(headerRead, left);
+            if (headerRead < sizeof(h)) {
+                m_truncated = (headerRead > 0u);
+                break;
+            }
+            auto & frame = frames[n];
+            frame.codec = static_cast<Codec>(h[4u]);
+            auto const dataSize = loadU32(h + 8u);
+            auto const compressedSize = loadU32(h + 12u);
+            if ((std::memcmp(h, FRAME_MAGIC, 4u) != 0)
+                || (dataSize > CompressedFileAppender::maxBlockSize)
+                || (compressedSize
+                    > compressBound_(frame.codec,
+                                     CompressedFileAppender::maxBlockSize)))
+                throw CorruptFrameException();
+            // Do not allocate for data which is not there:
+            if (compressedSize > left) {
+                m_truncated = true;
+                break;
+            }
+            frame.data.resize(dataSize);
+            frame.compressed.resize(compressedSize);
+            auto const dataRead = readAll(m_fd,
+                                          frame.compressed.data(),
+                                          frame.compressed.size());
+            left -= std::min<std::uint64_t>(dataRead, left);
+            if (dataRead < frame.compressed.size()) {
+                m_truncated = true;
+                break;
+            }
+            if (::crc32(0u,
+                        frame.compressed.data(),
+                        static_cast<::uInt>(frame.compressed.size()))
+                != loadU32(h + 16u))
+            {
+                // A partially written last frame:
+                if (!left) {
+                    m_truncated = true;
+                    break;
+                }
+                throw CorruptFrameException();
+            }
+        }
+        if (!n)
+            break;
+
+        // Decompress them in parallel:
+        auto const decompressFrame =
+                [](Frame & frame) noexcept {
+                    frame.ok = decompress_(frame.codec,
+                                           frame.compressed.data(),
+                                           frame.compressed.size(),
+                                           frame.data.data(),
+                                           frame.data.size());
+                };
+        std::vector<std::thread> workers;
+        workers.reserve(n - 1u);
+        for (std::size_t i = 1u; i < n; ++i)
+            workers.emplace_back(decompressFrame, std::ref(frames[i]));
+        decompressFrame(frames[0u]);
+        for (auto & worker : workers)
+            worker.join();
+
+        for (std::size_t i = 0u; i < n; ++i) {
+            if (!frames[i].ok)
+                throw CorruptFrameException();
+            out.write(frames[i].data.data(),
+                      static_cast<std::streamsize>(frames[i].data.size()));
+        }
+        total += n;
+    }
+    return total;
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_COMPRESSEDFILEAPPENDER_H
+#define LOGHARD_COMPRESSEDFILEAPPENDER_H
+
+#include "Appender.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+#include "Exception.h"
+#include "FileAppender.h"
+
+
+namespace LogHard {
+
+/**
+  \brief A file appender which writes independently compressed blocks.
+
+  Records are accumulated into blocks which are compressed and written by a
+  background thread. Every block is written as a self-delimiting frame:
+
+      "LHCF" | codec (1 byte) | 3 reserved bytes | uncompressed size (u32 LE)
+             | compressed size (u32 LE) | CRC-32 of compressed data (u32 LE)
+             | compressed data
+
+  hence a file truncated by a crash can be read up to its last full frame, and
+  frames can be decompressed in parallel, see CompressedFileReader. Partial
+  blocks are written after the compressor has been idle for flushInterval, so
+  a crash loses at most the records of that interval. Blocks never exceed
+  maxBlockSize, records which would not fit are truncated.
+*/
+class CompressedFileAppender: public Appender {
+
+public: /* Types: */
+
+    enum class Codec : std::uint8_t { Zlib = 1u, Zstd = 2u };
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         FileOpenException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
+                                                   UnsupportedCodecException);
+
+public: /* Constants: */
+
+    constexpr static std::size_t frameHeaderSize = 20u;
+
+    /** The largest uncompressed size of a frame written or read. */
+    constexpr static std::size_t maxBlockSize = 64u * 1024u * 1024u;
+
+public: /* Methods: */
+
+    CompressedFileAppender(std::string const & path,
+                           FileAppender::OpenMode const openMode,
+                           Codec const codec = defaultCodec(),
+                           std::size_t const blockSize = 1024u * 1024u,
+                           std::chrono::milliseconds const flushInterval =
+                                std::chrono::seconds(1),
+                           ::mode_t const flags = 0644);
+
+    CompressedFileAppender(char const * const path,
+                           FileAppender::OpenMode const openMode,
+                           Codec const codec = defaultCodec(),
+                           std::size_t const blockSize = 1024u * 1024u,
+                           std::chrono::milliseconds const flushInterval =
+                                std::chrono::seconds(1),
+                           ::mode_t const flags = 0644);
+
+    ~CompressedFileAppender() noexcept override;
+
+    /** \returns Codec::Zstd if built with zstd support, else Codec::Zlib. */
+    static Codec defaultCodec() noexcept;
+
+    static bool codecSupported(Codec const codec) noexcept;
+
+    /** Compresses and writes the current partial block, if any. */
+    void flush() noexcept;
+
+private: /* Methods: */
+
+    void doLog(::timeval time,
+               Priority const priority,
+               char const * message) noexcept override;
+
+    std::vector<char> & currentBlock() noexcept
+    { return m_blocks[m_submitted % m_blocks.size()]; }
+
+    void submitBlock(std::unique_lock<std::mutex> & lock) noexcept;
+
+    void compressorThread() noexcept;
+
+private: /* Fields: */
+
+    Codec const m_codec;
+    int const m_fd;
+    std::size_t const m_blockSize;
+    /** If zero, partial blocks are only written by flush(). */
+    std::chrono::milliseconds const m_flushInterval;
+
+    /* Blocks are filled and compressed in round-robin order. The logging side
+       fills block m_submitted % size, the compressor handles the blocks from
+       m_completed up to m_submitted. */
+    std::vector<std::vector<char> > m_blocks;
+    std::size_t m_submitted = 0u;
+    std::size_t m_completed = 0u;
+    bool m_stop = false;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+
+    std::thread m_thread;
+
+}; /* class CompressedFileAppender */
+
+/** Reads files written by CompressedFileAppender. */
+class CompressedFileReader {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         FileOpenException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
+                                                   ReadException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
+                                                   CorruptFrameException);
+
+public: /* Methods: */
+
+    CompressedFileReader(std::string const & path,
+                         unsigned const threads = 0u);
+
+    CompressedFileReader(char const * const path,
+                         unsigned const threads = 0u);
+
+    ~CompressedFileReader() noexcept;
+
+    /**
+      \brief Decompresses the file to the given stream, stopping at the first
+             incomplete frame (e.g. one cut short by a crash). A last frame
+             failing its checksum is considered incomplete as well.
+      \returns the number of frames decompressed.
+    */
+    std::size_t decompressTo(std::ostream & out);
+
+    /** \returns whether decompressTo() stopped at an incomplete frame. */
+    bool truncated() const noexcept { return m_truncated; }
+
+private: /* Fields: */
+
+    int const m_fd;
+    unsigned const m_threads;
+    bool m_truncated = false;
+
+}; /* class CompressedFileReader */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_COMPRESSEDFILEAPPENDER_H */
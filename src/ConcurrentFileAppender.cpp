@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "ConcurrentFileAppender.h"
+
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <sharemind/Concat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "CFileAppender.h"
+
+
+namespace LogHard {
+
+namespace {
+
+void pwriteAll(int const fd,
+               ::iovec * iov,
+               int iovCount,
+               ::off_t offset) noexcept
+{
+    while (iovCount > 0) {
+        auto r = ::pwritev(fd, iov, iovCount, offset);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        offset += r;
+        // Skip fully written buffers and adjust a partially written one:
+        while ((iovCount > 0) && (static_cast<std::size_t>(r) >= iov->iov_len))
+        {
+            r -= static_cast<decltype(r)>(iov->iov_len);
+            ++iov;
+            --iovCount;
+        }
+        if (iovCount > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + r;
+            iov->iov_len -= static_cast<std::size_t>(r);
+        }
+    }
+}
+
+} // anonymous namespace
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    ConcurrentFileAppender::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        ConcurrentFileAppender::Exception,
+        ConcurrentFileAppender::,
+        FileOpenException);
+
+ConcurrentFileAppender::ConcurrentFileAppender(
+        std::string const & path,
+        FileAppender::OpenMode const openMode,
+        std::size_t const extentSize,
+        ::mode_t const flags)
+    : ConcurrentFileAppender(path.c_str(), openMode, extentSize, flags)
+{}
+
+ConcurrentFileAppender::ConcurrentFileAppender(
+        char const * const path,
+        FileAppender::OpenMode const openMode,
+        std::size_t const extentSize,
+        ::mode_t const flags)
+    : m_fd(::open(path,
+                  // No O_APPEND, since offsets are reserved by us:
+                  O_WRONLY | O_CREAT | O_NOCTTY
+                  | ((openMode == FileAppender::OVERWRITE) ? O_TRUNC : 0u),
+                  flags))
+    , m_extentSize(static_cast< ::off_t>(extentSize ? extentSize : 1u))
+{
+    try {
+        if (m_fd == -1)
+            throw sharemind::ErrnoException(errno);
+        auto const end = ::lseek(m_fd, 0, SEEK_END);
+        if (end == -1) {
+            auto const e = errno;
+            ::close(m_fd);
+            throw sharemind::ErrnoException(e);
+        }
+        m_writeOffset.store(end, std::memory_order_relaxed);
+        m_reservedEnd.store(end, std::memory_order_relaxed);
+    } catch (...) {
+        std::throw_with_nested(
+                    ConcurrentFileAppender::FileOpenException(
+                        sharemind::concat(
+                            "Failed to open file \"",
+                            path,
+                            "\" for logging!")));
+    }
+}
+
+ConcurrentFileAppender::~ConcurrentFileAppender() noexcept {
+    fixFileSize();
+    ::close(m_fd);
+}
+
+void ConcurrentFileAppender::fixFileSize() noexcept {
+    std::lock_guard<std::mutex> const guard(m_reserveMutex);
+    auto const size = m_writeOffset.load(std::memory_order_acquire);
+    /* Truncating to the current size releases the blocks reserved past the
+       end of the file on both ext4 and XFS: */
+    if (::ftruncate(m_fd, size) == 0)
+        m_reservedEnd.store(size, std::memory_order_release);
+}
+
+void ConcurrentFileAppender::reserveTo(::off_t const end) noexcept {
+    std::lock_guard<std::mutex> const guard(m_reserveMutex);
+    auto const reserved = m_reservedEnd.load(std::memory_order_relaxed);
+    if (end <= reserved)
+        return;
+    auto const newEnd = (end / m_extentSize + 1) * m_extentSize;
+    #ifdef __linux__
+    /* Keep the size, so the file only grows by what is written. Failures
+       are ignored, e.g. without filesystem support writes just allocate: */
+    (void) ::fallocate(m_fd, FALLOC_FL_KEEP_SIZE, reserved, newEnd - reserved);
+    #endif
+    m_reservedEnd.store(newEnd, std::memory_order_release);
+}
+
+void ConcurrentFileAppender::doLog(::timeval time,
+                                   Priority const priority,
+                                   char const * message) noexcept
+{
+    CFileAppender::FormattedLine const line(time, priority, message);
+    auto const size = static_cast< ::off_t>(line.size());
+    auto const offset = m_writeOffset.fetch_add(size,
+                                                std::memory_order_relaxed);
+    if (offset + size > m_reservedEnd.load(std::memory_order_acquire))
+        reserveTo(offset + size);
+
+    ::iovec iov[CFileAppender::FormattedLine::iovCount];
+    for (int i = 0; i < CFileAppender::FormattedLine::iovCount; ++i)
+        iov[i] = line.iov()[i];
+    pwriteAll(m_fd, iov, CFileAppender::FormattedLine::iovCount, offset);
+}
+
+} /* namespace LogHard { */
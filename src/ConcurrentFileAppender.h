@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_CONCURRENTFILEAPPENDER_H
+#define LOGHARD_CONCURRENTFILEAPPENDER_H
+
+#include "Appender.h"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "Exception.h"
+#include "FileAppender.h"
+
+
+namespace LogHard {
+
+/**
+  \brief A file appender which supports parallel writers to a single file.
+
+  Instead of relying on O_APPEND (which serializes writers on the inode lock),
+  every record reserves its byte range by atomically advancing a write offset
+  and is then written with pwritev() independently of other writers. Disk
+  space is reserved ahead of the write offset in extents of the given size
+  without changing the size of the file, hence after a crash the file only
+  ends in NUL bytes where records were still being written. The reserved
+  space past the end of the file is released by fixFileSize() and on
+  destruction.
+
+  Note that the Backend serializes calls to its appenders, so records are only
+  written in parallel when an instance is shared by several Backends.
+
+  \warning The write offset is private to the instance, so the file must not
+            be written by anyone else while it is open, e.g. by a FileAppender
+            or another ConcurrentFileAppender, otherwise records overwrite each
+            other. Use FileAppender for files shared between writers.
+*/
+class ConcurrentFileAppender: public Appender {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         FileOpenException);
+
+public: /* Methods: */
+
+    ConcurrentFileAppender(std::string const & path,
+                           FileAppender::OpenMode const openMode,
+                           std::size_t const extentSize = 16u * 1024u * 1024u,
+                           ::mode_t const flags = 0644);
+
+    ConcurrentFileAppender(char const * const path,
+                           FileAppender::OpenMode const openMode,
+                           std::size_t const extentSize = 16u * 1024u * 1024u,
+                           ::mode_t const flags = 0644);
+
+    ~ConcurrentFileAppender() noexcept override;
+
+    /**
+      \brief Releases the space reserved past the end of the file, e.g.
+             before rotation.
+      \warning Must not be called concurrently with logging.
+    */
+    void fixFileSize() noexcept;
+
+private: /* Methods: */
+
+    void doLog(::timeval time,
+               Priority const priority,
+               char const * message) noexcept override;
+
+    void reserveTo(::off_t const end) noexcept;
+
+private: /* Fields: */
+
+    int const m_fd;
+    ::off_t const m_extentSize;
+    std::atomic< ::off_t> m_writeOffset;
+    std::atomic< ::off_t> m_reservedEnd;
+    std::mutex m_reserveMutex;
+
+}; /* class ConcurrentFileAppender */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_CONCURRENTFILEAPPENDER_H */
@@ -21,6 +21,11 @@
 #include "EarlyAppender.h"
 
 #include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <type_traits>
 
 
 namespace LogHard {
@@ -34,82 +39,386 @@ SHAREMIND_DEFINE_EXCEPTION_CONST_MSG_NOINLINE(
         TooManyEntriesException,
         "Maximum log entry reservation size exceeded!");
 
+namespace {
+
+constexpr std::uint64_t noData = ~static_cast<std::uint64_t>(0u);
+constexpr std::size_t noticeSize = 96u;
+constexpr char elisionMarker[] = "[...]";
+constexpr std::size_t elisionMarkerSize = sizeof(elisionMarker) - 1u;
+
+/* Record slots are stamped with the sequence number of the record they hold,
+   the lowest bit marking whether the record has been committed: */
+constexpr std::uint64_t reservedState(std::uint64_t const seq) noexcept
+{ return (seq + 1u) << 1u; }
+
+constexpr std::uint64_t committedState(std::uint64_t const seq) noexcept
+{ return reservedState(seq) | 1u; }
+
+std::size_t checkedDataSize(std::size_t const maxMessageSize,
+                            std::size_t const arenaSize)
+{
+    if (maxMessageSize >= arenaSize)
+        return maxMessageSize + 1u;
+    return arenaSize;
+}
+
+std::size_t checkedArenaSize(std::size_t const recordSize,
+                             std::size_t const maxEntries,
+                             std::size_t const dataSize)
+{
+    if (maxEntries > (SIZE_MAX - dataSize) / recordSize)
+        throw EarlyAppender::TooManyEntriesException();
+    return maxEntries * recordSize + dataSize;
+}
+
+} // anonymous namespace
+
 EarlyAppender::EarlyAppender(std::size_t const reserveEntries,
-                             std::size_t const maxMessageSize)
-    : m_oomMessage("Early log buffer full, messages skipped!")
-    , m_maxMessageSize((static_cast<void>(assert(maxMessageSize >= 5u)),
-                        maxMessageSize))
+                             std::size_t const maxMessageSize,
+                             OverflowPolicy const overflowPolicy,
+                             std::size_t const arenaSize)
+    : m_maxEntries(reserveEntries)
+    , m_maxMessageSize(maxMessageSize)
+    , m_dataSize(checkedDataSize(maxMessageSize, arenaSize))
+    , m_overflowPolicy(overflowPolicy)
+    , m_arena(new char[checkedArenaSize(sizeof(Record),
+                                        reserveEntries,
+                                        m_dataSize)])
+    , m_records(reinterpret_cast<Record *>(m_arena.get()))
+    , m_data(m_arena.get() + reserveEntries * sizeof(Record))
 {
-    std::size_t const size = reserveEntries + 1u;
-    if (size < reserveEntries)
-        throw TooManyEntriesException();
-    m_entries.reserve(size);
-    m_freeMessages.resize(reserveEntries);
-    for (std::string & msg : m_freeMessages)
-        msg.reserve(maxMessageSize);
+    static_assert(std::is_trivially_destructible<Record>::value, "");
+    for (std::size_t i = 0u; i < m_maxEntries; ++i)
+        new (&m_records[i]) Record{{0u},
+                                   {0},
+                                   {0},
+                                   {Priority::Fatal},
+                                   {0u},
+                                   {0u}};
 }
 
 EarlyAppender::~EarlyAppender() noexcept {}
 
+template <typename F>
+std::uint64_t EarlyAppender::forEachRecord(F && f, std::uint64_t const since)
+        const
+{
+    std::uint64_t const next = m_nextSeq.load(std::memory_order_acquire);
+    std::uint64_t first = 0u;
+    std::uint64_t last = next;
+    if (m_overflowPolicy == OverflowPolicy::KeepOldest) {
+        if (last > m_maxEntries)
+            last = m_maxEntries;
+    } else if (next > m_maxEntries) {
+        first = next - m_maxEntries;
+    }
+    if (first < since)
+        first = since;
+
+    Snapshot s;
+    s.lostBefore = static_cast<std::size_t>(first - since);
+    for (std::uint64_t seq = first; seq < last; ++seq) {
+        Record const & r = m_records[seq % m_maxEntries];
+        s.state = r.state.load(std::memory_order_acquire);
+        if (s.state != committedState(seq)) {
+            // Overwritten or given up on by doLog(), unless still in flight:
+            if (s.state != reservedState(seq))
+                ++s.lostBefore;
+            continue;
+        }
+        s.begin = r.begin.load(std::memory_order_relaxed);
+        if (s.begin == noData) // Already counted in m_dropped
+            continue;
+        s.length = r.length.load(std::memory_order_relaxed);
+        std::size_t const offset = s.begin % m_dataSize;
+        if (s.length >= m_dataSize - offset) { // Torn by a concurrent writer
+            ++s.lostBefore;
+            continue;
+        }
+        s.record.time.tv_sec = r.timeSec.load(std::memory_order_relaxed);
+        s.record.time.tv_usec = r.timeUsec.load(std::memory_order_relaxed);
+        s.record.priority = r.priority.load(std::memory_order_relaxed);
+        s.record.message = m_data + offset;
+        s.source = &r;
+        if (f(static_cast<Snapshot const &>(s))) {
+            s.lostBefore = 0u;
+        } else {
+            ++s.lostBefore;
+        }
+    }
+    return last < since ? since : last;
+}
+
+bool EarlyAppender::intact(Snapshot const & snapshot) const noexcept {
+    /* Checks whether the record was neither reused nor had its message
+       overwritten while it was being read: */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return snapshot.source->state.load(std::memory_order_relaxed)
+                == snapshot.state
+           && m_dataEnd.load(std::memory_order_relaxed)
+                <= snapshot.begin + m_dataSize;
+}
+
+EarlyAppender::LogEntries EarlyAppender::entries() const {
+    LogEntries r;
+    forEachRecord(
+                [this, &r](Snapshot const & s) {
+                    r.emplace_back(
+                            LogEntry{s.record.time,
+                                     s.record.priority,
+                                     std::string(s.record.message, s.length)});
+                    if (!intact(s)) {
+                        r.pop_back();
+                        return false;
+                    }
+                    return true;
+                });
+    return r;
+}
+
+EarlyAppender::LogRecords EarlyAppender::records() const {
+    LogRecords r;
+    forEachRecord(
+                [this, &r](Snapshot const & s) {
+                    if (!intact(s))
+                        return false;
+                    r.emplace_back(s.record);
+                    return true;
+                });
+    return r;
+}
+
+std::size_t EarlyAppender::size() const noexcept {
+    std::size_t r = 0u;
+    forEachRecord(
+                [this, &r](Snapshot const & s) noexcept {
+                    if (!intact(s))
+                        return false;
+                    ++r;
+                    return true;
+                });
+    return r;
+}
+
+std::size_t EarlyAppender::dropped() const noexcept {
+    std::size_t r = m_dropped.load(std::memory_order_relaxed);
+    if (m_overflowPolicy == OverflowPolicy::KeepNewest)
+        forEachRecord(
+                    [this, &r](Snapshot const & s) noexcept {
+                        if (!intact(s))
+                            return false;
+                        r += s.lostBefore;
+                        return true;
+                    });
+    return r;
+}
+
 void EarlyAppender::logToAppender(Appender & appender) const noexcept {
-    for (LogEntry const & entry : m_entries)
-        appender.log(entry.time, entry.priority, entry.message.c_str());
+    ReplayTarget const target{&appender, Priority::FullDebug};
+    logToAppenders(&target, 1u);
 }
 
 void EarlyAppender::logToAppender(Appender & appender,
                                   Priority const priority) const noexcept
 {
-    for (LogEntry const & entry : m_entries)
-        if (entry.priority <= priority)
-            appender.log(entry.time, entry.priority, entry.message.c_str());
+    ReplayTarget const target{&appender, priority};
+    logToAppenders(&target, 1u);
+}
+
+void EarlyAppender::logToAppenders(ReplayTarget const * const targets,
+                                   std::size_t const numTargets)
+        const noexcept
+{ replay(targets, numTargets, 0u, true); }
+
+void EarlyAppender::logToAppenders(ReplayTarget const * const targets,
+                                   std::size_t const numTargets,
+                                   std::uint64_t & position) const noexcept
+{ position = replay(targets, numTargets, position, false); }
+
+std::uint64_t EarlyAppender::replay(ReplayTarget const * const targets,
+                                    std::size_t const numTargets,
+                                    std::uint64_t const since,
+                                    bool const notices) const noexcept
+{
+    assert(targets || !numTargets);
+    constexpr std::size_t batchSize = 64u;
+    constexpr std::size_t scratchSize = 16u * 1024u;
+    LogRecord batch[batchSize];
+    char scratch[scratchSize];
+    std::size_t n = 0u;
+    char * out = scratch;
+
+    auto const flush =
+            [targets, numTargets, &batch, &n, &out, &scratch]() noexcept {
+                for (std::size_t i = 0u; i < numTargets; ++i)
+                    targets[i].appender->logBatch(batch,
+                                                  n,
+                                                  targets[i].priority);
+                n = 0u;
+                out = scratch;
+            };
+
+    /* In KeepNewest mode concurrent writers may overwrite messages, hence
+       these are copied out and validated before being handed over: */
+    bool const copy = (m_overflowPolicy == OverflowPolicy::KeepNewest);
+    bool const gapNotices = copy && notices;
+    std::uint64_t const next = forEachRecord(
+            [this, copy, gapNotices, &batch, &n, &out, &scratch, &flush](
+                    Snapshot const & s) noexcept
+            {
+                std::size_t length = s.length;
+                bool elide = false;
+                if (copy && length >= scratchSize - noticeSize) {
+                    length = scratchSize - noticeSize - 1u;
+                    elide = true;
+                }
+                if (n + 2u > batchSize
+                    || (copy
+                        && static_cast<std::size_t>(scratch + scratchSize - out)
+                           < noticeSize + length + 1u))
+                    flush();
+
+                LogRecord record(s.record);
+                if (copy) {
+                    std::memcpy(out, record.message, length);
+                    if (elide)
+                        std::memcpy(out + length - elisionMarkerSize,
+                                    elisionMarker,
+                                    elisionMarkerSize);
+                    out[length] = '\0';
+                    if (!intact(s))
+                        return false;
+                    record.message = out;
+                    out += length + 1u;
+                } else if (!intact(s)) {
+                    return false;
+                }
+
+                if (gapNotices && s.lostBefore) {
+                    int const r = std::snprintf(
+                            out,
+                            noticeSize,
+                            "Early log buffer full, %zu oldest messages "
+                            "overwritten!",
+                            s.lostBefore);
+                    assert(r > 0 && static_cast<std::size_t>(r) < noticeSize);
+                    batch[n++] = LogRecord{record.time, Priority::Error, out};
+                    out += r + 1;
+                }
+                batch[n++] = record;
+                return true;
+            },
+            since);
+    if (n)
+        flush();
+
+    if (!notices)
+        return next;
+    if (std::size_t const dropped = m_dropped.load(std::memory_order_relaxed))
+    {
+        char message[noticeSize];
+        std::snprintf(message,
+                      sizeof(message),
+                      "Early log buffer full, %zu messages skipped!",
+                      dropped);
+        ::timeval time;
+        time.tv_sec = m_firstDropSec.load(std::memory_order_relaxed);
+        time.tv_usec = m_firstDropUsec.load(std::memory_order_relaxed);
+        LogRecord const notice{time, Priority::Error, message};
+        for (std::size_t i = 0u; i < numTargets; ++i)
+            targets[i].appender->logBatch(&notice, 1u, targets[i].priority);
+    }
+    return next;
 }
 
 void EarlyAppender::clear() noexcept {
-    if (m_oom)
-        m_oomMessage = std::move(m_entries.back().message);
-    m_entries.pop_back();
-    for (LogEntry & entry : m_entries)
-        m_freeMessages.emplace_back(std::move(entry.message));
-    m_entries.clear();
+    for (std::size_t i = 0u; i < m_maxEntries; ++i)
+        m_records[i].state.store(0u, std::memory_order_relaxed);
+    m_nextSeq.store(0u, std::memory_order_relaxed);
+    m_dataEnd.store(0u, std::memory_order_relaxed);
+    m_dropped.store(0u, std::memory_order_relaxed);
+}
+
+void EarlyAppender::drop(::timeval time) noexcept {
+    if (!m_dropped.fetch_add(1u, std::memory_order_relaxed)) {
+        m_firstDropSec.store(time.tv_sec, std::memory_order_relaxed);
+        m_firstDropUsec.store(time.tv_usec, std::memory_order_relaxed);
+    }
+}
+
+std::uint64_t EarlyAppender::reserveData(std::size_t const size) noexcept {
+    std::uint64_t end = m_dataEnd.load(std::memory_order_relaxed);
+    for (;;) {
+        // Messages never wrap around the end of the arena:
+        std::uint64_t begin = end;
+        std::size_t const offset = begin % m_dataSize;
+        if (m_dataSize - offset < size)
+            begin += m_dataSize - offset;
+        if (m_overflowPolicy == OverflowPolicy::KeepOldest
+            && begin + size > m_dataSize)
+            return noData;
+        if (m_dataEnd.compare_exchange_weak(end,
+                                            begin + size,
+                                            std::memory_order_relaxed))
+            return begin;
+    }
 }
 
 void EarlyAppender::doLog(::timeval time,
                           Priority const priority,
                           char const * message) noexcept
 {
-    if (m_freeMessages.empty()) {
-        if (!m_oom) {
-            assert(m_entries.size() < m_entries.capacity());
-            m_entries.emplace_back(LogEntry{time,
-                                            Priority::Error,
-                                            std::move(m_oomMessage)});
-            m_oom = true;
-        }
+    assert(message);
+    std::size_t length = ::strnlen(message, m_maxMessageSize + 1u);
+    bool elide = false;
+    if (length > m_maxMessageSize) {
+        length = m_maxMessageSize;
+        // Limits shorter than the marker just cut messages short:
+        elide = (length >= elisionMarkerSize);
+    }
+
+    if (!m_maxEntries)
+        return drop(time);
+    std::uint64_t const seq = m_nextSeq.fetch_add(1u,
+                                                  std::memory_order_relaxed);
+    if (m_overflowPolicy == OverflowPolicy::KeepOldest && seq >= m_maxEntries)
+        return drop(time);
+
+    /* Claim the slot, unless it is still being written by a stalled writer
+       or has already been taken by a newer record. This only happens in
+       KeepNewest mode, where forEachRecord() counts the missing record as
+       overwritten, hence it is not counted in m_dropped: */
+    Record & record = m_records[seq % m_maxEntries];
+    std::uint64_t state = record.state.load(std::memory_order_relaxed);
+    do {
+        if (state && (!(state & 1u) || (state >> 1u) > seq))
+            return;
+    } while (!record.state.compare_exchange_weak(state,
+                                                 reservedState(seq),
+                                                 std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::uint64_t const begin = reserveData(length + 1u);
+    if (begin != noData) {
+        /* Readers must see the advanced m_dataEnd before any overwritten
+           bytes, as intact() relies on it: */
+        std::atomic_thread_fence(std::memory_order_release);
+        char * const data = m_data + begin % m_dataSize;
+        std::memcpy(data, message, length);
+        if (elide)
+            std::memcpy(data + length - elisionMarkerSize,
+                        elisionMarker,
+                        elisionMarkerSize);
+        data[length] = '\0';
     } else {
-        assert(m_entries.size() < m_entries.capacity());
-        std::string & s = m_freeMessages.back();
-        assert(s.empty());
-        assert(s.capacity() >= m_maxMessageSize);
-        try {
-            try {
-                s.assign(message);
-            } catch (...) {
-                assert(message);
-                assert(s.empty());
-                assert(s.capacity() >= m_maxMessageSize);
-                do {
-                    s.append(message, 1u);
-                } while (*++message);
-            }
-        } catch (...) {
-            std::size_t const size = s.size();
-            assert(size > m_maxMessageSize);
-            static char const elide[] = "[...]";
-            s.replace(size - 5u, 5u, elide, 5u);
-        }
-        m_entries.emplace_back(LogEntry{time, priority, std::move(s)});
-        m_freeMessages.pop_back();
+        drop(time);
     }
+    record.timeSec.store(time.tv_sec, std::memory_order_relaxed);
+    record.timeUsec.store(time.tv_usec, std::memory_order_relaxed);
+    record.priority.store(priority, std::memory_order_relaxed);
+    record.begin.store(begin, std::memory_order_relaxed);
+    record.length.store(length, std::memory_order_relaxed);
+    record.state.store(committedState(seq), std::memory_order_release);
 }
 
 } /* namespace LogHard { */
@@ -22,8 +22,12 @@
 
 #include "Appender.h"
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <initializer_list>
+#include <memory>
 #include <sharemind/ExceptionMacros.h>
 #include <string>
 #include <vector>
@@ -32,10 +36,28 @@
 
 namespace LogHard {
 
+/**
+  \brief An appender which buffers records in memory for later replay.
+
+  Records are stored in a single preallocated arena as variable-length
+  records, holding at most reserveEntries records and arenaSize bytes of
+  message text (including terminators). Messages longer than maxMessageSize
+  are elided, ending with "[...]" unless maxMessageSize is shorter than
+  that. When the arena is full, either newer records are dropped
+  (OverflowPolicy::KeepOldest) or the oldest records are overwritten
+  (OverflowPolicy::KeepNewest). The number of lost records is reported by
+  additional error records during replay.
+
+  Logging is lock-free and may happen from several threads at once, also
+  concurrently with replay. Records are replayed in batches through
+  Appender::logBatch().
+*/
 class EarlyAppender: public Appender {
 
 public: /* Types: */
 
+    enum class OverflowPolicy { KeepOldest, KeepNewest };
+
     SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
     SHAREMIND_DECLARE_EXCEPTION_CONST_MSG_NOINLINE(Exception,
                                                    TooManyEntriesException);
@@ -47,33 +69,120 @@ public: /* Types: */
     };
     using LogEntries = std::vector<LogEntry>;
 
+    using LogRecords = std::vector<LogRecord>;
+
+    struct ReplayTarget {
+        Appender * appender;
+        Priority priority;
+    };
+
 public: /* Methods: */
 
     EarlyAppender(std::size_t const reserveEntries = 1024u,
-                  std::size_t const maxMessageSize = 1024u);
+                  std::size_t const maxMessageSize = 1024u,
+                  OverflowPolicy const overflowPolicy =
+                          OverflowPolicy::KeepOldest,
+                  std::size_t const arenaSize = 256u * 1024u);
     ~EarlyAppender() noexcept override;
 
-    LogEntries const & entries() const noexcept { return m_entries; }
+    /** \returns copies of the buffered records. */
+    LogEntries entries() const;
+
+    /**
+      \returns the buffered records without copying their messages.
+      \warning The messages point into the buffer of this appender. They are
+               only valid until the next call to clear(), and in KeepNewest
+               mode only until later records overwrite them, which may also
+               happen concurrently. Use entries() or replay to other
+               appenders where this is not acceptable.
+    */
+    LogRecords records() const;
+
+    std::size_t size() const noexcept;
+    std::size_t dropped() const noexcept;
 
     void logToAppender(Appender & appender) const noexcept;
     void logToAppender(Appender & appender,
                        Priority const priority) const noexcept;
 
+    /** \brief Replays the records into all the given appenders at once. */
+    void logToAppenders(ReplayTarget const * targets,
+                        std::size_t numTargets) const noexcept;
+
+    void logToAppenders(std::initializer_list<ReplayTarget> targets)
+            const noexcept
+    { logToAppenders(targets.begin(), targets.size()); }
+
+    /**
+      \brief Replays the records logged at or after the given position,
+             without notices about lost records.
+      \param[in,out] position Set to the position following the last record
+                              considered. Initially 0.
+    */
+    void logToAppenders(ReplayTarget const * targets,
+                        std::size_t numTargets,
+                        std::uint64_t & position) const noexcept;
+
+    /** \warning Must not be called concurrently with logging or replay. */
     void clear() noexcept;
 
+private: /* Types: */
+
+    struct Record {
+        std::atomic<std::uint64_t> state;
+        std::atomic< ::time_t> timeSec;
+        std::atomic< ::suseconds_t> timeUsec;
+        std::atomic<Priority> priority;
+        std::atomic<std::uint64_t> begin;
+        std::atomic<std::size_t> length;
+    };
+
+    struct Snapshot {
+        LogRecord record;
+        std::size_t length;
+        std::size_t lostBefore;
+        Record const * source;
+        std::uint64_t state;
+        std::uint64_t begin;
+    };
+
 private: /* Methods: */
 
     void doLog(::timeval time,
                Priority const priority,
                char const * message) noexcept override;
 
+    std::uint64_t reserveData(std::size_t const size) noexcept;
+
+    void drop(::timeval time) noexcept;
+
+    /** \returns the position following the last record considered. */
+    template <typename F>
+    std::uint64_t forEachRecord(F && f, std::uint64_t const since = 0u)
+            const;
+
+    std::uint64_t replay(ReplayTarget const * targets,
+                         std::size_t numTargets,
+                         std::uint64_t const since,
+                         bool const notices) const noexcept;
+
+    bool intact(Snapshot const & snapshot) const noexcept;
+
 private: /* Fields: */
 
-    LogEntries m_entries;
-    std::vector<std::string> m_freeMessages;
-    std::string m_oomMessage;
-    bool m_oom = false;
+    std::size_t const m_maxEntries;
     std::size_t const m_maxMessageSize;
+    std::size_t const m_dataSize;
+    OverflowPolicy const m_overflowPolicy;
+    std::unique_ptr<char[]> m_arena;
+    Record * const m_records;
+    char * const m_data;
+
+    std::atomic<std::uint64_t> m_nextSeq{0u};
+    std::atomic<std::uint64_t> m_dataEnd{0u};
+    std::atomic<std::size_t> m_dropped{0u};
+    std::atomic< ::time_t> m_firstDropSec{0};
+    std::atomic< ::suseconds_t> m_firstDropUsec{0};
 
 }; /* class EarlyAppender */
 
@@ -32,6 +32,7 @@ SHAREMIND_EXTERN_C_BEGIN
     ((LOGHARD_IMPLEMENTATION_LIMITS_REACHED,)) \
     ((LOGHARD_MUTEX_ERROR,)) \
     ((LOGHARD_UNKNOWN_ERROR,)) \
+    ((LOGHARD_INVALID_ARGUMENT,)) \
     ((LOGHARD_ERROR_COUNT,))
 SHAREMIND_ENUM_CUSTOM_DEFINE(LogHardError, LOGHARD_ERROR_ENUM);
 SHAREMIND_ENUM_DECLARE_TOSTRING(LogHardError);
@@ -19,7 +19,9 @@
 
 #include "FileAppender.h"
 
+#include <cerrno>
 #include <sharemind/Concat.h>
+#include <utility>
 #include "CFileAppender.h"
 
 
@@ -44,15 +46,43 @@ FileAppender::FileAppender(std::string const & path,
 FileAppender::FileAppender(char const * const path,
                            OpenMode const openMode,
                            ::mode_t const flags)
+    : FileAppender(path, openMode, Preallocation{0u, 0u}, flags)
+{}
+
+FileAppender::FileAppender(std::string const & path,
+                           OpenMode const openMode,
+                           Preallocation const & preallocation,
+                           ::mode_t const flags)
+    : FileAppender(path.c_str(),
+                   openMode,
+                   preallocation,
+                   flags)
+{}
+
+FileAppender::FileAppender(char const * const path,
+                           OpenMode const openMode,
+                           Preallocation const & preallocation,
+                           ::mode_t const flags)
     : m_fd(::open(path,
                   // No O_SYNC since it would hurt performance badly
                   O_WRONLY | O_CREAT | O_APPEND | O_NOCTTY
                   | ((openMode == OVERWRITE) ? O_TRUNC : 0u),
                   flags))
+    , m_preallocation(preallocation)
 {
     try {
         if (m_fd == -1)
             throw sharemind::ErrnoException(errno);
+        if (preallocation.chunkSize || preallocation.dropCacheSize) {
+            auto const end = ::lseek(m_fd, 0, SEEK_END);
+            if (end == -1) {
+                auto const e = errno;
+                ::close(m_fd);
+                throw sharemind::ErrnoException(e);
+            }
+            m_writeEnd = m_preallocatedEnd = m_writebackEnd = m_droppedEnd =
+                    end;
+        }
     } catch (...) {
         std::throw_with_nested(
                     FileAppender::FileOpenException(
@@ -63,11 +93,113 @@ FileAppender::FileAppender(char const * const path,
     }
 }
 
-FileAppender::~FileAppender() noexcept { ::close(m_fd); }
+FileAppender::FileAppender(std::string const & path,
+                           OpenMode const openMode,
+                           Layout layout,
+                           Preallocation const & preallocation,
+                           ::mode_t const flags)
+    : FileAppender(path.c_str(),
+                   openMode,
+                   std::move(layout),
+                   preallocation,
+                   flags)
+{}
+
+FileAppender::FileAppender(char const * const path,
+                           OpenMode const openMode,
+                           Layout layout,
+                           Preallocation const & preallocation,
+                           ::mode_t const flags)
+    : FileAppender(path, openMode, preallocation, flags)
+{ m_layout.reset(new Layout(std::move(layout))); }
+
+FileAppender::~FileAppender() noexcept {
+    #ifdef __linux__
+    /* Release the blocks preallocated past the end of the file. Other writers
+       may share the file, hence this must not change its size. Note that some
+       filesystems, e.g. ext4, ignore holes punched past the end of file: */
+    if (m_preallocatedEnd > m_writeEnd) {
+        auto const end = ::lseek(m_fd, 0, SEEK_END);
+        if ((end >= 0) && (end < m_preallocatedEnd))
+            ::fallocate(m_fd,
+                        FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                        end,
+                        m_preallocatedEnd - end);
+    }
+    #endif
+    ::close(m_fd);
+}
 
 void FileAppender::doLog(::timeval time,
                          Priority const priority,
                          char const * message) noexcept
-{ CFileAppender::logToFile(m_fd, time, priority, message); }
+{
+    if (m_layout) {
+        Layout::FormattedLine const line(*m_layout, time, priority, message);
+        CFileAppender::logToFile(m_fd, line);
+        if (m_preallocation.chunkSize || m_preallocation.dropCacheSize)
+            manageExtents(line.size());
+        return;
+    }
+    if (!m_preallocation.chunkSize && !m_preallocation.dropCacheSize)
+        return CFileAppender::logToFile(m_fd, time, priority, message);
+    CFileAppender::FormattedLine const line(time, priority, message);
+    CFileAppender::logToFile(m_fd, line);
+    manageExtents(line.size());
+}
+
+void FileAppender::doLogBatch(LogRecord const * records, std::size_t size)
+        noexcept
+{
+    std::size_t const written =
+            m_layout
+            ? CFileAppender::logToFile(m_fd, *m_layout, records, size)
+            : CFileAppender::logToFile(m_fd, records, size);
+    if (m_preallocation.chunkSize || m_preallocation.dropCacheSize)
+        manageExtents(written);
+}
+
+void FileAppender::manageExtents(std::size_t const written) noexcept {
+    #ifdef __linux__
+    m_writeEnd += static_cast< ::off_t>(written);
+
+    auto const chunkSize = static_cast< ::off_t>(m_preallocation.chunkSize);
+    if (chunkSize && m_canPreallocate && (m_writeEnd >= m_preallocatedEnd)) {
+        /* Other writers may share the file, so find the real end of file.
+           Because of O_APPEND, this is where our last write ended: */
+        auto const end = ::lseek(m_fd, 0, SEEK_CUR);
+        if (end >= 0)
+            m_writeEnd = end;
+        if (::fallocate(m_fd, FALLOC_FL_KEEP_SIZE, m_writeEnd, chunkSize) == 0)
+        {
+            m_preallocatedEnd = m_writeEnd + chunkSize;
+        } else if ((errno == EOPNOTSUPP) || (errno == ENOSYS)) {
+            m_canPreallocate = false;
+        } else {
+            // Disable further attempts until the next chunk is written:
+            m_preallocatedEnd = m_writeEnd + chunkSize;
+        }
+    }
+
+    auto const dropSize = static_cast< ::off_t>(m_preallocation.dropCacheSize);
+    if (dropSize && (m_writeEnd - m_writebackEnd >= dropSize)) {
+        /* Dirty pages can not be dropped, so start writeback of the latest
+           range now and drop the range written back during the last round: */
+        ::sync_file_range(m_fd,
+                          m_writebackEnd,
+                          m_writeEnd - m_writebackEnd,
+                          SYNC_FILE_RANGE_WRITE);
+        if (m_writebackEnd > m_droppedEnd)
+            ::posix_fadvise(m_fd,
+                            m_droppedEnd,
+                            m_writebackEnd - m_droppedEnd,
+                            POSIX_FADV_DONTNEED);
+        m_droppedEnd = m_writebackEnd;
+        m_writebackEnd = m_writeEnd;
+    }
+    #else
+    (void) written;
+    #endif
+}
 
 } /* namespace LogHard { */
@@ -22,14 +22,17 @@
 
 #include "Appender.h"
 
+#include <cstddef>
 #include <exception>
 #include <fcntl.h>
+#include <memory>
 #include <sharemind/ExceptionMacros.h>
 #include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include "Exception.h"
+#include "Layout.h"
 
 
 namespace LogHard {
@@ -40,6 +43,25 @@ public: /* Types: */
 
     enum OpenMode { APPEND, OVERWRITE };
 
+    struct Preallocation {
+
+        /**
+          If non-zero, disk space is reserved in chunks of this size ahead of
+          the write position using fallocate(FALLOC_FL_KEEP_SIZE). The unused
+          reservation is released on destruction by punching a hole past the
+          end of the file, which some filesystems (e.g. ext4) ignore.
+        */
+        std::size_t chunkSize;
+
+        /**
+          If non-zero, after every this many bytes written the preceding range
+          is scheduled for writeback and the one before it is dropped from the
+          page cache using posix_fadvise(POSIX_FADV_DONTNEED).
+        */
+        std::size_t dropCacheSize;
+
+    };
+
     SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
     SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
                                                          FileOpenException);
@@ -54,6 +76,28 @@ public: /* Methods: */
                  OpenMode const openMode,
                  ::mode_t const flags = 0644);
 
+    FileAppender(std::string const & path,
+                 OpenMode const openMode,
+                 Preallocation const & preallocation,
+                 ::mode_t const flags = 0644);
+
+    FileAppender(char const * const path,
+                 OpenMode const openMode,
+                 Preallocation const & preallocation,
+                 ::mode_t const flags = 0644);
+
+    FileAppender(std::string const & path,
+                 OpenMode const openMode,
+                 Layout layout,
+                 Preallocation const & preallocation = Preallocation{0u, 0u},
+                 ::mode_t const flags = 0644);
+
+    FileAppender(char const * const path,
+                 OpenMode const openMode,
+                 Layout layout,
+                 Preallocation const & preallocation = Preallocation{0u, 0u},
+                 ::mode_t const flags = 0644);
+
     ~FileAppender() noexcept override;
 
 private: /* Methods: */
@@ -62,9 +106,23 @@ private: /* Methods: */
                Priority const priority,
                char const * message) noexcept override;
 
+    void doLogBatch(LogRecord const * records,
+                    std::size_t size) noexcept override;
+
+    void manageExtents(std::size_t const written) noexcept;
+
 private: /* Fields: */
 
     int const m_fd;
+    Preallocation const m_preallocation;
+    ::off_t m_writeEnd = 0;
+    ::off_t m_preallocatedEnd = 0;
+    ::off_t m_writebackEnd = 0;
+    ::off_t m_droppedEnd = 0;
+    /** Cleared if the filesystem does not support preallocation. */
+    bool m_canPreallocate = true;
+    /** If null, lines are laid out by CFileAppender::FormattedLine. */
+    std::unique_ptr<Layout const> m_layout;
 
 }; /* class FileAppender */
 
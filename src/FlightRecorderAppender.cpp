@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "FlightRecorderAppender.h"
+
+#include <cassert>
+#include <utility>
+
+
+namespace LogHard {
+
+FlightRecorderAppender::FlightRecorderAppender(
+        std::shared_ptr<Appender> target,
+        Priority const triggerPriority,
+        std::size_t const maxRecords,
+        std::size_t const maxMessageSize,
+        std::size_t const arenaSize)
+    : m_target((assert(target), std::move(target)))
+    , m_triggerPriority(triggerPriority)
+    , m_recorder(maxRecords,
+                 maxMessageSize,
+                 EarlyAppender::OverflowPolicy::KeepNewest,
+                 arenaSize)
+{}
+
+FlightRecorderAppender::~FlightRecorderAppender() noexcept {}
+
+void FlightRecorderAppender::dump() noexcept {
+    std::lock_guard<std::mutex> const guard(m_dumpMutex);
+    dumpLocked();
+}
+
+void FlightRecorderAppender::dumpLocked() noexcept {
+    EarlyAppender::ReplayTarget const target{m_target.get(),
+                                             Priority::FullDebug};
+    m_recorder.logToAppenders(&target, 1u, m_dumpPosition);
+}
+
+void FlightRecorderAppender::doLog(::timeval time,
+                                   Priority const priority,
+                                   char const * message) noexcept
+{
+    if (priority > m_triggerPriority)
+        return m_recorder.log(time, priority, message);
+    std::lock_guard<std::mutex> const guard(m_dumpMutex);
+    dumpLocked();
+    m_target->log(time, priority, message);
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_FLIGHTRECORDERAPPENDER_H
+#define LOGHARD_FLIGHTRECORDERAPPENDER_H
+
+#include "Appender.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "EarlyAppender.h"
+
+
+namespace LogHard {
+
+/**
+  \brief An appender which keeps the most recent records in memory and passes
+         them on to a target appender only when a record at or above a
+         trigger priority arrives.
+
+  Recording is lock-free and uses an EarlyAppender in KeepNewest mode. On a
+  trigger, the records recorded since the previous dump are replayed to the
+  target, followed by the triggering record itself. Records below the
+  priority of this appender are neither recorded nor dumped.
+*/
+class FlightRecorderAppender: public Appender {
+
+public: /* Methods: */
+
+    FlightRecorderAppender(std::shared_ptr<Appender> target,
+                           Priority const triggerPriority = Priority::Error,
+                           std::size_t const maxRecords = 1024u,
+                           std::size_t const maxMessageSize = 1024u,
+                           std::size_t const arenaSize = 256u * 1024u);
+    ~FlightRecorderAppender() noexcept override;
+
+    /** \brief Passes the records recorded since the last dump to the target. */
+    void dump() noexcept;
+
+private: /* Methods: */
+
+    void doLog(::timeval time,
+               Priority const priority,
+               char const * message) noexcept override;
+
+    void dumpLocked() noexcept;
+
+private: /* Fields: */
+
+    std::shared_ptr<Appender> const m_target;
+    Priority const m_triggerPriority;
+    EarlyAppender m_recorder;
+
+    std::mutex m_dumpMutex;
+    std::uint64_t m_dumpPosition = 0u;
+
+}; /* class FlightRecorderAppender */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_FLIGHTRECORDERAPPENDER_H */
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "JournaldAppender.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sharemind/Concat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <syslog.h>
+#include <unistd.h>
+#include "Logger.h"
+
+
+namespace LogHard {
+
+namespace {
+
+// The prefix field is last, so it can be left out by sending fewer vectors:
+enum : unsigned {
+    IOV_IDENTIFIER = 0u,
+    IOV_PRIORITY,
+    IOV_MESSAGE_KEY,
+    IOV_MESSAGE_SIZE,
+    IOV_MESSAGE,
+    IOV_MESSAGE_END,
+    IOV_PREFIX_KEY,
+    IOV_PREFIX_SIZE,
+    IOV_PREFIX,
+    IOV_PREFIX_END,
+    IOV_COUNT
+};
+
+} // anonymous namespace
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    JournaldAppender::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        JournaldAppender::Exception,
+        JournaldAppender::,
+        ConnectException);
+
+JournaldAppender::JournaldAppender(std::string const & ident,
+                                   std::string socketPath)
+    : m_socketPath(std::move(socketPath))
+    #ifdef SOCK_CLOEXEC
+    , m_socket(::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0))
+    #else
+    , m_socket(::socket(AF_UNIX, SOCK_DGRAM, 0))
+    #endif
+    , m_identifierField(sharemind::concat("SYSLOG_IDENTIFIER=", ident, '\n'))
+{
+    try {
+        ::sockaddr_un addr;
+        if (m_socketPath.size() >= sizeof(addr.sun_path))
+            throw sharemind::ErrnoException(ENAMETOOLONG);
+        if (m_socket == -1)
+            throw sharemind::ErrnoException(errno);
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, m_socketPath.c_str(), m_socketPath.size());
+        if (::connect(m_socket,
+                      reinterpret_cast<::sockaddr *>(&addr),
+                      sizeof(addr)) != 0)
+            throw sharemind::ErrnoException(errno);
+    } catch (...) {
+        if (m_socket != -1)
+            ::close(m_socket);
+        std::throw_with_nested(
+                ConnectException(
+                    sharemind::concat("Failed to connect to journal socket \"",
+                                      m_socketPath,
+                                      "\"!")));
+    }
+
+    // Like sd-journal, try to allow for larger datagrams:
+    int const sendBufferSize = 8 * 1024 * 1024;
+    ::setsockopt(m_socket,
+                 SOL_SOCKET,
+                 SO_SNDBUF,
+                 &sendBufferSize,
+                 sizeof(sendBufferSize));
+
+    constexpr static int priorities[] =
+        { LOG_EMERG, LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG, LOG_DEBUG };
+    for (unsigned p = 0u; p < 6u; ++p)
+        m_priorityFields[p] =
+                sharemind::concat("PRIORITY=",
+                                  priorities[p],
+                                  "\nLOGHARD_PRIORITY=",
+                                  priorityString(static_cast<Priority>(p)),
+                                  '\n');
+
+    auto const setIov = [this](unsigned const i, void const * p, std::size_t s)
+    {
+        m_iov[i].iov_base = const_cast<void *>(p);
+        m_iov[i].iov_len = s;
+    };
+    // Use the binary-safe format for the values which may contain newlines:
+    setIov(IOV_IDENTIFIER,
+           m_identifierField.c_str(),
+           m_identifierField.size());
+    setIov(IOV_PREFIX_KEY, "LOGHARD_PREFIX\n", 15u);
+    setIov(IOV_PREFIX_SIZE, &m_prefixSize, sizeof(m_prefixSize));
+    setIov(IOV_PREFIX_END, "\n", 1u);
+    setIov(IOV_MESSAGE_KEY, "MESSAGE\n", 8u);
+    setIov(IOV_MESSAGE_SIZE, &m_messageSize, sizeof(m_messageSize));
+    setIov(IOV_MESSAGE_END, "\n", 1u);
+}
+
+JournaldAppender::~JournaldAppender() noexcept { ::close(m_socket); }
+
+void JournaldAppender::doLog(::timeval,
+                             Priority const priority,
+                             char const * message) noexcept
+{
+    auto const toLittleEndian = [](std::uint64_t const v) noexcept {
+        std::uint64_t r;
+        unsigned char * const out = reinterpret_cast<unsigned char *>(&r);
+        for (unsigned i = 0u; i < 8u; ++i)
+            out[i] = static_cast<unsigned char>(v >> (i * 8u));
+        return r;
+    };
+
+    auto const & priorityField =
+            m_priorityFields[static_cast<unsigned>(priority)];
+    m_iov[IOV_PRIORITY].iov_base = const_cast<char *>(priorityField.c_str());
+    m_iov[IOV_PRIORITY].iov_len = priorityField.size();
+
+    std::size_t prefixSize = 0u;
+    auto const * const recordInfo = Logger::currentRecordInfo();
+    if (recordInfo && (recordInfo->prefix == message))
+        prefixSize = recordInfo->prefixSize;
+    std::size_t const messageSize = std::strlen(message);
+    assert(prefixSize <= messageSize);
+
+    // Drop the separating space from the prefix field:
+    std::size_t prefixFieldSize = prefixSize;
+    if (prefixFieldSize && (message[prefixFieldSize - 1u] == ' '))
+        --prefixFieldSize;
+    m_prefixSize = toLittleEndian(prefixFieldSize);
+    m_iov[IOV_PREFIX].iov_base = const_cast<char *>(message);
+    m_iov[IOV_PREFIX].iov_len = prefixFieldSize;
+    m_messageSize = toLittleEndian(messageSize);
+    m_iov[IOV_MESSAGE].iov_base = const_cast<char *>(message);
+    m_iov[IOV_MESSAGE].iov_len = messageSize;
+
+    std::size_t const iovCount = prefixFieldSize ? IOV_COUNT : IOV_PREFIX_KEY;
+
+    ::msghdr header;
+    std::memset(&header, 0, sizeof(header));
+    header.msg_iov = m_iov;
+    header.msg_iovlen = iovCount;
+    for (;;) {
+        if (::sendmsg(m_socket, &header, MSG_NOSIGNAL) >= 0)
+            return;
+        if (errno == EINTR)
+            continue;
+        if ((errno == EMSGSIZE) || (errno == ENOBUFS))
+            sendViaMemfd(iovCount);
+        return;
+    }
+}
+
+bool JournaldAppender::sendViaMemfd(std::size_t const iovCount) noexcept {
+    #ifdef MFD_ALLOW_SEALING
+    int const fd = ::memfd_create("loghard-journal",
+                                  MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1)
+        return false;
+    // Copy the vectors, since writing may require adjusting them:
+    ::iovec iovCopy[IOV_COUNT];
+    assert(iovCount <= IOV_COUNT);
+    std::memcpy(iovCopy, m_iov, iovCount * sizeof(::iovec));
+    ::iovec * iov = iovCopy;
+    std::size_t left = iovCount;
+    while (left) {
+        auto r = ::writev(fd, iov, static_cast<int>(left));
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            ::close(fd);
+            return false;
+        }
+        while (left && (static_cast<std::size_t>(r) >= iov->iov_len)) {
+            r -= static_cast<decltype(r)>(iov->iov_len);
+            ++iov;
+            --left;
+        }
+        if (left) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + r;
+            iov->iov_len -= static_cast<std::size_t>(r);
+        }
+    }
+    // journald requires the memfd to be sealed:
+    if (::fcntl(fd,
+                F_ADD_SEALS,
+                F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    union {
+        ::cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    std::memset(&control, 0, sizeof(control));
+    ::msghdr header;
+    std::memset(&header, 0, sizeof(header));
+    header.msg_control = &control;
+    header.msg_controllen = sizeof(control);
+    ::cmsghdr * const cmsg = CMSG_FIRSTHDR(&header);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    header.msg_controllen = cmsg->cmsg_len;
+
+    ssize_t r;
+    do {
+        r = ::sendmsg(m_socket, &header, MSG_NOSIGNAL);
+    } while ((r < 0) && (errno == EINTR));
+    ::close(fd);
+    return r >= 0;
+    #else
+    (void) iovCount;
+    return false;
+    #endif
+}
+
+} /* namespace LogHard { */
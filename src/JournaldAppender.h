@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_JOURNALDAPPENDER_H
+#define LOGHARD_JOURNALDAPPENDER_H
+
+#include "Appender.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <sys/uio.h>
+#include "Exception.h"
+
+
+namespace LogHard {
+
+/**
+  \brief An appender speaking the native protocol of systemd-journald.
+
+  Every record is sent as a single datagram with the MESSAGE, PRIORITY,
+  SYSLOG_IDENTIFIER and LOGHARD_PRIORITY fields. Records logged through a
+  Logger with a prefix also get the prefix (without the trailing space) as the
+  LOGHARD_PREFIX field. Records too large for a datagram are passed to journald
+  in a sealed memfd instead.
+*/
+class JournaldAppender: public Appender {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         ConnectException);
+
+public: /* Methods: */
+
+    JournaldAppender(std::string const & ident,
+                     std::string socketPath =
+                            "/run/systemd/journal/socket");
+
+    ~JournaldAppender() noexcept override;
+
+private: /* Methods: */
+
+    void doLog(::timeval time,
+               Priority const priority,
+               char const * message) noexcept override;
+
+    bool sendViaMemfd(std::size_t const iovCount) noexcept;
+
+private: /* Fields: */
+
+    std::string const m_socketPath;
+    int m_socket;
+
+    std::string const m_identifierField;
+    std::string m_priorityFields[6u];
+
+    /* Prebuilt I/O vectors. Only the priority fields, the field lengths and
+       the values vary between records: */
+    ::iovec m_iov[10u];
+    std::uint64_t m_prefixSize;
+    std::uint64_t m_messageSize;
+
+}; /* class JournaldAppender */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_JOURNALDAPPENDER_H */
@@ -0,0 +1,421 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "Layout.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <ctime>
+#include <pthread.h>
+#include <sharemind/Concat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <functional>
+#include <thread>
+#endif
+#include "Appender.h"
+
+
+namespace LogHard {
+
+namespace {
+
+/** The broken-down time of the previous record of the thread. */
+struct TmCache {
+    bool valid;
+    ::time_t second;
+    std::tm tm;
+};
+
+/**
+  The strftime() output of time steps of recent records of the thread, which
+  changes at most once per second.
+*/
+struct TimeTextCache {
+    std::uint64_t layoutId;
+    std::size_t step;
+    ::time_t second;
+    std::size_t size;
+    char text[64u];
+};
+
+constexpr std::size_t timeTextCacheSize = 8u;
+
+std::atomic<std::uint64_t> lastLayoutId(0u);
+
+thread_local TmCache tl_localTm;
+thread_local TmCache tl_utcTm;
+thread_local TimeTextCache tl_timeTexts[timeTextCacheSize];
+thread_local unsigned long long tl_threadId = 0u;
+
+std::tm const & localTm(::time_t const second) noexcept {
+    auto & cache = tl_localTm;
+    if (!cache.valid || (cache.second != second)) {
+        ::localtime_r(&second, &cache.tm);
+        cache.second = second;
+        cache.valid = true;
+    }
+    return cache.tm;
+}
+
+std::tm const & utcTm(::time_t const second) noexcept {
+    auto & cache = tl_utcTm;
+    if (!cache.valid || (cache.second != second)) {
+        ::gmtime_r(&second, &cache.tm);
+        cache.second = second;
+        cache.valid = true;
+    }
+    return cache.tm;
+}
+
+::timeval now() noexcept {
+    ::timeval r;
+    ::gettimeofday(&r, nullptr);
+    return r;
+}
+
+void resetThreadId() noexcept { tl_threadId = 0u; }
+
+unsigned long long threadId() noexcept {
+    if (!tl_threadId) {
+        // The forking thread continues as another thread in the child:
+        static int const registered =
+                ::pthread_atfork(nullptr, nullptr, &resetThreadId);
+        (void) registered;
+        #ifdef __linux__
+        tl_threadId = static_cast<unsigned long long>(::syscall(SYS_gettid));
+        #else
+        tl_threadId = std::hash<std::thread::id>()(std::this_thread::get_id());
+        #endif
+    }
+    return tl_threadId;
+}
+
+char * append(char * out,
+              char const * const end,
+              char const * const data,
+              std::size_t const size) noexcept
+{
+    auto const n = std::min(size, static_cast<std::size_t>(end - out));
+    std::memcpy(out, data, n);
+    return out + n;
+}
+
+char * appendUnsigned(char * out,
+                      char const * const end,
+                      unsigned long long value,
+                      unsigned const minDigits = 1u) noexcept
+{
+    char digits[24u];
+    char * d = digits + sizeof(digits);
+    unsigned n = 0u;
+    do {
+        *--d = static_cast<char>('0' + value % 10u);
+        value /= 10u;
+        ++n;
+    } while (value || (n < minDigits));
+    return append(out, end, d, n);
+}
+
+} // anonymous namespace
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception, Layout::, Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(Layout::Exception,
+                                                    Layout::,
+                                                    ParseException);
+
+constexpr std::size_t Layout::FormattedLine::maxIovCount;
+constexpr std::size_t Layout::FormattedLine::bufferSize;
+
+Layout::Layout(std::string const & pattern)
+    : Layout(pattern.c_str())
+{}
+
+Layout::Layout(char const * const pattern)
+    : m_pattern((assert(pattern), pattern))
+    , m_origin(now())
+    , m_id(++lastLayoutId)
+{
+    auto const fail = [pattern](char const * const reason) {
+        throw ParseException(sharemind::concat("Invalid layout pattern \"",
+                                               pattern,
+                                               "\": ",
+                                               reason));
+    };
+    std::string literal;
+    auto const flushLiteral = [this, &literal]() {
+        if (!literal.empty()) {
+            addText(Step::Literal, literal.data(), literal.size());
+            literal.clear();
+        }
+    };
+    std::size_t messages = 0u;
+    for (char const * p = pattern; *p; ++p) {
+        if (*p != '%') {
+            literal.push_back(*p);
+            continue;
+        }
+        bool leftAligned = false;
+        if (*++p == '-') {
+            leftAligned = true;
+            ++p;
+        }
+        std::size_t width = 0u;
+        for (; (*p >= '0') && (*p <= '9'); ++p)
+            if ((width = width * 10u + static_cast<std::size_t>(*p - '0'))
+                > FormattedLine::bufferSize)
+                fail("width too large");
+        if (leftAligned && !width)
+            fail("missing width");
+        if (width && !std::strchr("rpt", *p))
+            fail("width given for a conversion which does not support it");
+        switch (*p) {
+        case '%': literal.push_back('%'); break;
+        case 'n': literal.push_back('\n'); break;
+        case 'm':
+            flushLiteral();
+            addStep(Step::Message);
+            ++messages;
+            break;
+        case 'r':
+            flushLiteral();
+            addStep(Step::Relative, width, leftAligned);
+            break;
+        case 'p':
+            flushLiteral();
+            addStep(Step::Priority, width, leftAligned);
+            break;
+        case 't':
+            flushLiteral();
+            addStep(Step::ThreadId, width, leftAligned);
+            break;
+        case 'd':
+        case 'D': {
+            flushLiteral();
+            auto const step = (*p == 'd') ? Step::LocalTime : Step::UtcTime;
+            if (p[1] == '{') {
+                char const * const end = std::strchr(p + 2, '}');
+                if (!end)
+                    fail("unterminated time format");
+                compileTime(step, std::string(p + 2, end));
+                p = end;
+            } else {
+                compileTime(step, "%Y.%m.%d %H:%M:%S");
+            }
+            break;
+        }
+        case 'i':
+            flushLiteral();
+            compileTime(Step::LocalTime, "%Y-%m-%dT%H:%M:%S.%6f");
+            addStep(Step::LocalOffset);
+            break;
+        case 'I':
+            flushLiteral();
+            compileTime(Step::UtcTime, "%Y-%m-%dT%H:%M:%S.%6fZ");
+            break;
+        case '\0': fail("incomplete conversion"); break;
+        default: fail("unknown conversion"); break;
+        }
+    }
+    flushLiteral();
+    // Every message may need an I/O vector of its own and one after it:
+    if (messages * 2u + 1u > FormattedLine::maxIovCount)
+        fail("too many messages");
+}
+
+void Layout::addStep(Step const step,
+                     std::size_t const width,
+                     bool const leftAligned)
+{ m_steps.emplace_back(CompiledStep{step, leftAligned, width, 0u, 0u}); }
+
+void Layout::addText(Step const step, char const * const text, std::size_t size)
+{
+    auto const offset = m_text.size();
+    m_text.append(text, size).push_back('\0');
+    m_steps.emplace_back(CompiledStep{step, false, 0u, offset, size});
+}
+
+void Layout::compileTime(Step const step, std::string const & format) {
+    std::string chunk;
+    for (std::size_t i = 0u; i < format.size(); ++i) {
+        if (format[i] != '%' || (i + 1u == format.size())) {
+            chunk.push_back(format[i]);
+            continue;
+        }
+        std::size_t digits = 6u;
+        std::size_t j = i + 1u;
+        if ((format[j] >= '1') && (format[j] <= '6')) {
+            digits = static_cast<std::size_t>(format[j] - '0');
+            ++j;
+        }
+        if ((j < format.size()) && (format[j] == 'f')) {
+            if (!chunk.empty()) {
+                addText(step, chunk.data(), chunk.size());
+                chunk.clear();
+            }
+            m_steps.emplace_back(
+                        CompiledStep{Step::Fraction, false, 0u, digits, 0u});
+        } else {
+            // Pass other conversions, including %%, on to strftime():
+            chunk.append(format, i, 2u);
+            j = i + 1u;
+        }
+        i = j;
+    }
+    if (!chunk.empty())
+        addText(step, chunk.data(), chunk.size());
+}
+
+Layout::FormattedLine::FormattedLine(Layout const & layout,
+                                     ::timeval time,
+                                     Priority const priority,
+                                     char const * const message) noexcept
+{
+    assert(message);
+    char * out = m_buffer;
+    char * const end = m_buffer + bufferSize;
+    char * segment = m_buffer;
+    auto const addIov = [this](char const * const data, std::size_t const size)
+    {
+        assert(m_iovCount < static_cast<int>(maxIovCount));
+        m_iov[m_iovCount].iov_base = const_cast<char *>(data);
+        m_iov[m_iovCount].iov_len = size;
+        ++m_iovCount;
+        m_size += size;
+    };
+
+    for (std::size_t i = 0u; i < layout.m_steps.size(); ++i) {
+        auto const & s = layout.m_steps[i];
+        char * const start = out;
+        char const * const text = layout.m_text.c_str() + s.offset;
+        switch (s.step) {
+        case Step::Literal:
+            out = append(out, end, text, s.size);
+            break;
+        case Step::Message:
+            if (out != segment)
+                addIov(segment, static_cast<std::size_t>(out - segment));
+            addIov(message, std::strlen(message));
+            segment = out;
+            break;
+        case Step::LocalTime:
+        case Step::UtcTime: {
+            auto & cache =
+                    tl_timeTexts[(layout.m_id + i) % timeTextCacheSize];
+            if ((cache.layoutId == layout.m_id) && (cache.step == i)
+                && (cache.second == time.tv_sec))
+            {
+                out = append(out, end, cache.text, cache.size);
+                break;
+            }
+            out += std::strftime(out,
+                                 static_cast<std::size_t>(end - out),
+                                 text,
+                                 (s.step == Step::LocalTime)
+                                 ? &localTm(time.tv_sec)
+                                 : &utcTm(time.tv_sec));
+            // Zero may also mean that the text did not fit into m_buffer:
+            auto const size = static_cast<std::size_t>(out - start);
+            if (size && (size <= sizeof(cache.text))) {
+                std::memcpy(cache.text, start, size);
+                cache.size = size;
+                cache.layoutId = layout.m_id;
+                cache.step = i;
+                cache.second = time.tv_sec;
+            }
+            break;
+        }
+        case Step::Fraction: {
+            char digits[6u];
+            appendUnsigned(digits,
+                           digits + sizeof(digits),
+                           static_cast<unsigned long long>(
+                               time.tv_usec % 1000000),
+                           6u);
+            out = append(out, end, digits, s.offset);
+            break;
+        }
+        case Step::LocalOffset: {
+            auto offset = localTm(time.tv_sec).tm_gmtoff / 60;
+            char sign = '+';
+            if (offset < 0) {
+                sign = '-';
+                offset = -offset;
+            }
+            out = append(out, end, &sign, 1u);
+            out = appendUnsigned(out,
+                                 end,
+                                 static_cast<unsigned long long>(offset / 60),
+                                 2u);
+            out = append(out, end, ":", 1u);
+            out = appendUnsigned(out,
+                                 end,
+                                 static_cast<unsigned long long>(offset % 60),
+                                 2u);
+            break;
+        }
+        case Step::Relative: {
+            // From the time of the record, which may have been logged earlier:
+            auto const elapsed =
+                    (static_cast<long long>(time.tv_sec)
+                     - static_cast<long long>(layout.m_origin.tv_sec))
+                    * 1000000
+                    + (static_cast<long long>(time.tv_usec)
+                       - static_cast<long long>(layout.m_origin.tv_usec));
+            if (elapsed < 0)
+                out = append(out, end, "-", 1u);
+            auto const us = static_cast<unsigned long long>(
+                                (elapsed < 0) ? -elapsed : elapsed);
+            out = appendUnsigned(out, end, us / 1000000u);
+            out = append(out, end, ".", 1u);
+            out = appendUnsigned(out, end, us % 1000000u, 6u);
+            break;
+        }
+        case Step::Priority: {
+            auto const * const p = Appender::priorityString(priority);
+            out = append(out, end, p, std::strlen(p));
+            break;
+        }
+        case Step::ThreadId:
+            out = appendUnsigned(out, end, threadId());
+            break;
+        }
+
+        auto const size = static_cast<std::size_t>(out - start);
+        if (size < s.width) {
+            auto const padding = std::min(s.width - size,
+                                          static_cast<std::size_t>(end - out));
+            if (!s.leftAligned) {
+                std::memmove(start + padding, start, size);
+                std::memset(start, ' ', padding);
+            } else {
+                std::memset(out, ' ', padding);
+            }
+            out += padding;
+        }
+    }
+    if (out != segment)
+        addIov(segment, static_cast<std::size_t>(out - segment));
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_LAYOUT_H
+#define LOGHARD_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <vector>
+#include "Exception.h"
+#include "Priority.h"
+
+
+namespace LogHard {
+
+/**
+  \brief A layout of log lines, compiled from a pattern once.
+
+  The pattern consists of literal text and the following conversions:
+
+      %d        local time as "YYYY.MM.DD HH:MM:SS"
+      %d{FMT}   local time formatted by strftime() with FMT, in which %Nf
+                (N from 1 to 6, default 6) denotes the first N digits of the
+                fraction of the second
+      %D, %D{FMT}  like %d, but in UTC
+      %i        local time in ISO 8601, e.g. "2017-07-14T05:40:00.123456+03:00"
+      %I        UTC time in ISO 8601, e.g. "2017-07-14T02:40:00.123456Z"
+      %r        seconds from the construction of the Layout to the time of
+                the record, e.g. "12.345678", or "-0.250000" for records
+                logged before
+      %p        priority, e.g. "WARNING"
+      %t        thread id (on Linux, the kernel thread id)
+      %m        message
+      %n        newline
+      %%        percent sign
+
+  The %r, %p and %t conversions can be padded with spaces to a minimum width
+  given as a decimal number after the percent sign, e.g. %7p, and are then
+  aligned to the right unless the width is preceded by a minus sign, e.g.
+  %-7p. The pattern of the default layout of the text appenders is
+  "%d %-7p %m%n".
+*/
+class Layout {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         ParseException);
+
+    /** A log line laid out as an I/O vector for writev() and friends. */
+    class FormattedLine {
+
+    public: /* Constants: */
+
+        constexpr static std::size_t maxIovCount = 16u;
+
+        /** Space for everything but the messages, the rest is truncated. */
+        constexpr static std::size_t bufferSize = 512u;
+
+    public: /* Methods: */
+
+        FormattedLine(Layout const & layout,
+                      ::timeval time,
+                      Priority const priority,
+                      char const * const message) noexcept;
+
+        FormattedLine(FormattedLine const &) = delete;
+        FormattedLine & operator=(FormattedLine const &) = delete;
+
+        ::iovec const * iov() const noexcept { return m_iov; }
+
+        int iovCount() const noexcept { return m_iovCount; }
+
+        std::size_t size() const noexcept { return m_size; }
+
+    private: /* Fields: */
+
+        char m_buffer[bufferSize];
+        ::iovec m_iov[maxIovCount];
+        int m_iovCount = 0;
+        std::size_t m_size = 0u;
+
+    }; /* class FormattedLine { */
+
+public: /* Methods: */
+
+    explicit Layout(std::string const & pattern);
+    explicit Layout(char const * const pattern);
+
+    std::string const & pattern() const noexcept { return m_pattern; }
+
+    /** \returns the time of construction which %r is relative to. */
+    ::timeval origin() const noexcept { return m_origin; }
+
+private: /* Types: */
+
+    enum class Step : std::uint8_t {
+        Literal,
+        Message,
+        LocalTime,
+        UtcTime,
+        Fraction,
+        LocalOffset,
+        Relative,
+        Priority,
+        ThreadId
+    };
+
+    struct CompiledStep {
+        Step step;
+        bool leftAligned;
+        std::size_t width;
+        /** Literal text or strftime() format in m_text, or fraction digits. */
+        std::size_t offset;
+        std::size_t size;
+    };
+
+private: /* Methods: */
+
+    void addStep(Step const step,
+                 std::size_t const width = 0u,
+                 bool const leftAligned = false);
+
+    void addText(Step const step, char const * const text, std::size_t size);
+
+    void compileTime(Step const step, std::string const & format);
+
+private: /* Fields: */
+
+    std::string m_pattern;
+    std::vector<CompiledStep> m_steps;
+    /** Literals and NUL-terminated strftime() formats of the steps. */
+    std::string m_text;
+    ::timeval const m_origin;
+    /** Unique among all Layouts, for caching formatted times. */
+    std::uint64_t const m_id;
+
+}; /* class Layout { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_LAYOUT_H */
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "LogContext.h"
+
+
+namespace LogHard {
+
+namespace {
+
+thread_local Priority tl_verbosity = Priority::Fatal;
+
+} // anonymous namespace
+
+std::atomic<unsigned> LogContext::s_elevatedThreads{0u};
+
+Priority LogContext::verbosity() noexcept { return tl_verbosity; }
+
+void LogContext::setVerbosity(Priority const verbosity) noexcept {
+    bool const elevated = (verbosity != Priority::Fatal);
+    if (elevated != (tl_verbosity != Priority::Fatal)) {
+        if (elevated) {
+            s_elevatedThreads.fetch_add(1u, std::memory_order_relaxed);
+        } else {
+            s_elevatedThreads.fetch_sub(1u, std::memory_order_relaxed);
+        }
+    }
+    tl_verbosity = verbosity;
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_LOGCONTEXT_H
+#define LOGHARD_LOGCONTEXT_H
+
+#include <atomic>
+#include "Priority.h"
+
+
+namespace LogHard {
+
+/**
+  \brief The logging context of the current thread, see
+         Logger::ScopedVerbosity.
+
+  The verbosity of the context is the least severe priority which is logged
+  by the thread regardless of the Logger, Backend and Appender filters.
+  Priority::Fatal means no elevation.
+*/
+class LogContext {
+
+public: /* Methods: */
+
+    static Priority verbosity() noexcept;
+
+    static void setVerbosity(Priority const verbosity) noexcept;
+
+    /**
+      \returns whether the priority is elevated by the context.
+      \note Unless some thread has elevated its verbosity, this only costs a
+            relaxed atomic load.
+    */
+    static bool elevates(Priority const priority) noexcept {
+        return s_elevatedThreads.load(std::memory_order_relaxed)
+               && priority <= verbosity();
+    }
+
+private: /* Fields: */
+
+    /** The number of threads with a verbosity other than Priority::Fatal. */
+    static std::atomic<unsigned> s_elevatedThreads;
+
+}; /* class LogContext { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_LOGCONTEXT_H */
@@ -36,20 +36,88 @@ static_assert(STACK_BUFFER_SIZE > MAX_MESSAGE_SIZE, "Overflow");
 thread_local char tl_message[STACK_BUFFER_SIZE] = {};
 thread_local ::timeval tl_time = {};
 thread_local std::size_t tl_offset = 0u;
+thread_local std::size_t tl_prefixSize = 0u;
+thread_local Logger::RecordInfo const * tl_recordInfo = nullptr;
+
+bool callSitePasses(CallSite & callSite, Logger const & logger) noexcept {
+    switch (callSite.mode()) {
+    case CallSite::Mode::Enabled:
+        return true;
+    case CallSite::Mode::Default:
+        return logger.enabled(callSite.priority());
+    case CallSite::Mode::Disabled:
+        break;
+    }
+    return false;
+}
 
 } // anonymous namespace
 
 Logger::MessageBuilder::MessageBuilder(Priority priority, Logger const & logger)
         noexcept
-    : MessageBuilder(Logger::now(), priority, logger)
-{}
+    : m_priority(priority)
+{
+    if (logger.enabled(priority)) {
+        start(Logger::now(), logger);
+    } else {
+        tl_offset = STACK_BUFFER_SIZE;
+    }
+}
 
 Logger::MessageBuilder::MessageBuilder(::timeval theTime,
                                        Priority priority,
                                        Logger const & logger) noexcept
-    : m_backend(sharemind::assertReturn(logger.backend()))
-    , m_priority(priority)
+    : m_priority(priority)
 {
+    if (logger.enabled(priority)) {
+        start(std::move(theTime), logger);
+    } else {
+        tl_offset = STACK_BUFFER_SIZE;
+    }
+}
+
+Logger::MessageBuilder::MessageBuilder(CallSite & callSite,
+                                       Logger const & logger) noexcept
+    : m_priority(callSite.priority())
+{
+    if (callSitePasses(callSite, logger)) {
+        start(Logger::now(), logger);
+    } else {
+        tl_offset = STACK_BUFFER_SIZE;
+    }
+}
+
+Logger::MessageBuilder::MessageBuilder(CallSite & callSite,
+                                       RateLimiter & rateLimiter,
+                                       Logger const & logger) noexcept
+    : m_priority(callSite.priority())
+{
+    if (!callSitePasses(callSite, logger)) {
+        tl_offset = STACK_BUFFER_SIZE;
+        return;
+    }
+    if (!rateLimiter.acquire()) {
+        LOGHARD_STATISTICS_ONLY(
+            if (auto * const counters = logger.backend()->counters())
+                BackendCounters::increment(counters->suppressed);)
+        tl_offset = STACK_BUFFER_SIZE;
+        return;
+    }
+    auto const theTime(Logger::now());
+    if (auto const suppressed = rateLimiter.takeSuppressed()) {
+        start(theTime, logger);
+        *this << "Suppressed " << suppressed << " similar messages from "
+              << callSite.file() << ':' << callSite.line() << '.';
+        finish();
+    }
+    start(theTime, logger);
+}
+
+void Logger::MessageBuilder::start(::timeval theTime, Logger const & logger)
+        noexcept
+{
+    m_backend = sharemind::assertReturn(logger.backend());
+    m_filterNode = &logger.filterNode();
     tl_time = std::move(theTime);
     auto const & prefix = logger.prefix();
     if (!prefix.empty()) {
@@ -58,22 +126,37 @@ Logger::MessageBuilder::MessageBuilder(::timeval theTime,
     } else {
         tl_offset = 0u;
     }
+    tl_prefixSize = tl_offset;
 }
 
 Logger::MessageBuilder::~MessageBuilder() noexcept {
-    if (!m_backend)
-        return;
+    if (m_backend)
+        finish();
+}
+
+void Logger::MessageBuilder::finish() noexcept {
+    assert(m_backend);
     assert(tl_offset <= STACK_BUFFER_SIZE);
     assert(tl_offset < STACK_BUFFER_SIZE
            || tl_message[STACK_BUFFER_SIZE - 1u] == '\0');
-    if (tl_offset < STACK_BUFFER_SIZE)
+    std::size_t size;
+    if (tl_offset < STACK_BUFFER_SIZE) {
         tl_message[tl_offset] = '\0';
-    m_backend->doLog(std::move(tl_time), m_priority, tl_message);
+        size = tl_offset;
+    } else {
+        size = std::strlen(tl_message);
+    }
+    LOGHARD_STATISTICS_ONLY(m_filterNode->countVolume(m_priority, size);)
+    RecordInfo const recordInfo{tl_message, tl_prefixSize};
+    auto const oldRecordInfo = tl_recordInfo;
+    tl_recordInfo = &recordInfo;
+    m_backend->dispatch(std::move(tl_time), m_priority, tl_message, size);
+    tl_recordInfo = oldRecordInfo;
 }
 
 Logger::MessageBuilder &
 Logger::MessageBuilder::operator<<(char const v) noexcept {
-    assert(m_backend);
+    assert(m_backend || tl_offset == STACK_BUFFER_SIZE);
     if (tl_offset <= MAX_MESSAGE_SIZE) {
         if (tl_offset == MAX_MESSAGE_SIZE)
             return elide();
@@ -90,7 +173,7 @@ Logger::MessageBuilder::operator<<(bool const v) noexcept
 #define LOGHARD_LHC_OP(valueType,valueGetter,formatString) \
     Logger::MessageBuilder & \
     Logger::MessageBuilder::operator<<(valueType const v) noexcept { \
-        assert(m_backend); \
+        assert(m_backend || tl_offset == STACK_BUFFER_SIZE); \
         if (tl_offset > MAX_MESSAGE_SIZE) { \
             assert(tl_offset == STACK_BUFFER_SIZE); \
             return *this; \
@@ -141,7 +224,7 @@ Logger::MessageBuilder::operator<<(float const v) noexcept
 Logger::MessageBuilder &
 Logger::MessageBuilder::operator<<(char const * v) noexcept {
     assert(v);
-    assert(m_backend);
+    assert(m_backend || tl_offset == STACK_BUFFER_SIZE);
     auto o = tl_offset;
     if (o > MAX_MESSAGE_SIZE) {
         assert(o == STACK_BUFFER_SIZE);
@@ -163,7 +246,7 @@ Logger::MessageBuilder::operator<<(char const * v) noexcept {
 
 Logger::MessageBuilder &
 Logger::MessageBuilder::operator<<(std::string const & v) noexcept {
-    assert(m_backend);
+    assert(m_backend || tl_offset == STACK_BUFFER_SIZE);
     auto const s = v.size();
     if (s <= 0u)
         return *this;
@@ -205,6 +288,9 @@ Logger::MessageBuilder::operator<<(sharemind::Uuid const & v) noexcept {
 Logger::MessageBuilder & Logger::MessageBuilder::elide() noexcept {
     assert(tl_offset <= MAX_MESSAGE_SIZE);
     assert(m_backend);
+    LOGHARD_STATISTICS_ONLY(
+        if (auto * const counters = m_backend->counters())
+            BackendCounters::increment(counters->elided);)
     std::memcpy(&tl_message[tl_offset], "...", 4u);
     tl_offset = STACK_BUFFER_SIZE;
     return *this;
@@ -232,21 +318,80 @@ void Logger::StandardExceptionFormatter::operator()(
 
 Logger::Logger(std::shared_ptr<Backend> backend) noexcept
     : m_backend(sharemind::assertReturn(std::move(backend)))
-{}
+    , m_filterNode(&m_backend->filter().root())
+    , m_baseFilterNode(m_filterNode)
+{
+    PrefixFilter::acquire(*m_filterNode);
+    PrefixFilter::acquire(*m_baseFilterNode);
+}
+
+Logger::Logger(std::shared_ptr<Backend> backend,
+               ComponentTag,
+               std::string && component) noexcept
+    : m_backend(sharemind::assertReturn(std::move(backend)))
+    , m_prefix(component + ' ')
+    , m_filterNode(&m_backend->filter().acquireChild(
+                       m_backend->filter().root(),
+                       component))
+    , m_baseFilterNode(&m_backend->filter().root())
+{ PrefixFilter::acquire(*m_baseFilterNode); }
 
 Logger::Logger(Logger && move) noexcept
     : m_backend(sharemind::assertReturn(std::move(move.m_backend)))
     , m_prefix(std::move(move.m_prefix))
     , m_basePrefix(std::move(move.m_prefix))
-{}
+    , m_filterNode(move.m_filterNode)
+    , m_baseFilterNode(move.m_filterNode)
+{
+    // Take over the reference to the filter node, the base is re-acquired:
+    PrefixFilter::acquire(*m_baseFilterNode);
+    m_backend->filter().release(*move.m_baseFilterNode);
+    move.m_filterNode = nullptr;
+    move.m_baseFilterNode = nullptr;
+}
 
 Logger::Logger(Logger const & copy) noexcept
     : m_backend(sharemind::assertReturn(copy.m_backend))
     , m_prefix(copy.m_prefix)
     , m_basePrefix(copy.m_prefix)
-{}
+    , m_filterNode(copy.m_filterNode)
+    , m_baseFilterNode(copy.m_filterNode)
+{
+    PrefixFilter::acquire(*m_filterNode);
+    PrefixFilter::acquire(*m_baseFilterNode);
+}
+
+Logger::Logger(Logger const & logger,
+               ComponentTag,
+               std::string && component) noexcept
+    : m_backend(sharemind::assertReturn(logger.m_backend))
+    , m_prefix(logger.m_prefix.empty()
+               ? component + ' '
+               : (*(logger.m_prefix.crbegin()) != ' ')
+                 ? logger.m_prefix + component + ' '
+                 : std::string(logger.m_prefix.cbegin(),
+                               logger.m_prefix.cend() - 1) + component + ' ')
+    , m_basePrefix(logger.m_prefix)
+    , m_filterNode(&m_backend->filter().acquireChild(*logger.m_filterNode,
+                                                     component))
+    , m_baseFilterNode(logger.m_filterNode)
+{ PrefixFilter::acquire(*m_baseFilterNode); }
+
+void Logger::setComponent(std::string && component) {
+    auto prefix(sharemind::concat(m_basePrefix, component, ' '));
+    auto & filter = m_backend->filter();
+    auto & node = filter.acquireChild(*m_baseFilterNode, component);
+    m_prefix = std::move(prefix);
+    filter.release(*m_filterNode);
+    m_filterNode = &node;
+}
 
-Logger::~Logger() noexcept {}
+Logger::~Logger() noexcept {
+    if (m_filterNode) {
+        m_backend->filter().release(*m_filterNode);
+        m_backend->filter().release(*m_baseFilterNode);
+    }
+}
 
 ::timeval Logger::now() noexcept {
     ::timeval theTime;
@@ -255,6 +400,9 @@ Logger::~Logger() noexcept {}
     return theTime;
 }
 
+Logger::RecordInfo const * Logger::currentRecordInfo() noexcept
+{ return tl_recordInfo; }
+
 Logger::MessageBuilder Logger::fatal() const noexcept
 { return MessageBuilder(Priority::Fatal, *this); }
 
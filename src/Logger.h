@@ -36,7 +36,11 @@
 #include <type_traits>
 #include <utility>
 #include "Backend.h"
+#include "CallSite.h"
+#include "LogContext.h"
+#include "PrefixFilter.h"
 #include "Priority.h"
+#include "RateLimiter.h"
 
 
 /*
@@ -56,6 +60,75 @@
 #endif
 #endif
 
+/*
+    LOGHARD_LOG registers a static CallSite for the statement, which allows the
+    statement to be enabled or disabled individually at runtime. Usage example:
+
+        LOGHARD_LOG(m_logger, Debug) << "Here";
+        LOGHARD_DEBUG(m_logger) << "Here";
+
+    When the call site is in its default mode, the record is filtered like
+    records from m_logger.debug(). The stream expressions are not evaluated if
+    the record does not pass.
+
+    LOGHARD_LOG_EVERY_N and LOGHARD_LOG_RATE additionally pass the records of
+    the statement through a static RateLimiter. When a record passes after
+    some were suppressed, a summary record is logged before it:
+
+        LOGHARD_LOG_EVERY_N(m_logger, Warning, 1000) << "Bad peer";
+        LOGHARD_LOG_RATE(m_logger, Warning, 10, 100) << "Bad peer";
+*/
+#define LOGHARD_LOG(logger, priority) \
+    LOGHARD_LOG_(logger, priority, loghardCallSite_)
+
+#define LOGHARD_LOG_EVERY_N(logger, priority, n) \
+    LOGHARD_LOG_LIMITED_(logger, priority, (n))
+
+#define LOGHARD_LOG_RATE(logger, priority, perSecond, burst) \
+    LOGHARD_LOG_LIMITED_(logger, priority, (perSecond), (burst))
+
+#define LOGHARD_LOG_CALLSITE_(priority) \
+    static ::LogHard::CallSite loghardCallSite_( \
+            __FILE__, \
+            __LINE__, \
+            __func__, \
+            ::LogHard::Priority::priority)
+
+#define LOGHARD_LOG_(logger, priority, ...) \
+    if (bool loghardCallSiteDone_ = false) {} else \
+        for (LOGHARD_LOG_CALLSITE_(priority); \
+             !loghardCallSiteDone_; \
+             loghardCallSiteDone_ = true) \
+            LOGHARD_LOG_BUILDER_(logger, __VA_ARGS__)
+
+#define LOGHARD_LOG_LIMITED_(logger, priority, ...) \
+    if (bool loghardCallSiteDone_ = false) {} else \
+        for (LOGHARD_LOG_CALLSITE_(priority); \
+             !loghardCallSiteDone_; \
+             loghardCallSiteDone_ = true) \
+            for (static ::LogHard::RateLimiter loghardRateLimiter_( \
+                        __VA_ARGS__); \
+                 !loghardCallSiteDone_; \
+                 loghardCallSiteDone_ = true) \
+                LOGHARD_LOG_BUILDER_(logger, \
+                                     loghardCallSite_, \
+                                     loghardRateLimiter_)
+
+#define LOGHARD_LOG_BUILDER_(logger, ...) \
+    for (::LogHard::Logger::MessageBuilder loghardMessageBuilder_( \
+                __VA_ARGS__, \
+                (logger)); \
+         !loghardCallSiteDone_ && loghardMessageBuilder_; \
+         loghardCallSiteDone_ = true) \
+        loghardMessageBuilder_
+
+#define LOGHARD_FATAL(logger) LOGHARD_LOG(logger, Fatal)
+#define LOGHARD_ERROR(logger) LOGHARD_LOG(logger, Error)
+#define LOGHARD_WARNING(logger) LOGHARD_LOG(logger, Warning)
+#define LOGHARD_INFO(logger) LOGHARD_LOG(logger, Normal)
+#define LOGHARD_DEBUG(logger) LOGHARD_LOG(logger, Debug)
+#define LOGHARD_FULLDEBUG(logger) LOGHARD_LOG(logger, FullDebug)
+
 namespace LogHard {
 
 class Logger {
@@ -70,6 +143,12 @@ public: /* Types: */
 
     struct HexByte { uint8_t const value; };
 
+    /** Details of a record which are not part of the appender interface. */
+    struct RecordInfo {
+        char const * prefix;
+        std::size_t prefixSize;
+    };
+
     class MessageBuilder {
 
     public: /* Methods: */
@@ -82,6 +161,15 @@ public: /* Types: */
         MessageBuilder(Priority priority, Logger const &) noexcept;
         MessageBuilder(::timeval, Priority priority, Logger const &) noexcept;
 
+        MessageBuilder(CallSite & callSite, Logger const &) noexcept;
+        MessageBuilder(CallSite & callSite,
+                       RateLimiter & rateLimiter,
+                       Logger const &) noexcept;
+
+        /** \returns whether the record passed the filters. */
+        explicit operator bool() const noexcept
+        { return static_cast<bool>(m_backend); }
+
 
         ~MessageBuilder() noexcept;
 
@@ -118,12 +206,17 @@ public: /* Types: */
 
     private: /* Methods: */
 
+        void start(::timeval theTime, Logger const & logger) noexcept;
+        void finish() noexcept;
+
         MessageBuilder & elide() noexcept;
 
     private: /* Fields: */
 
+        /** Empty for records which do not pass the filter of the Logger. */
         std::shared_ptr<Backend> m_backend;
         Priority m_priority;
+        PrefixFilter::Node const * m_filterNode = nullptr;
 
     }; /* struct MessageBuilder { */
 
@@ -146,6 +239,40 @@ public: /* Types: */
 
     }; /* StandardExceptionFormatter */
 
+    /**
+      \brief Sets the verbosity of the LogContext of the current thread for
+             the lifetime of the object. Usage example:
+
+                 Logger::ScopedVerbosity const verbosity(Priority::FullDebug);
+                 auto const captured(Logger::ScopedVerbosity::current());
+                 std::thread([captured]{
+                     Logger::ScopedVerbosity const verbosity(captured);
+                     // ...
+                 });
+    */
+    class ScopedVerbosity {
+
+    public: /* Methods: */
+
+        explicit ScopedVerbosity(Priority const verbosity) noexcept
+            : m_oldVerbosity(LogContext::verbosity())
+        { LogContext::setVerbosity(verbosity); }
+
+        ScopedVerbosity(ScopedVerbosity const &) = delete;
+        ScopedVerbosity & operator=(ScopedVerbosity const &) = delete;
+
+        ~ScopedVerbosity() noexcept
+        { LogContext::setVerbosity(m_oldVerbosity); }
+
+        /** \returns the verbosity to capture for other threads. */
+        static Priority current() noexcept { return LogContext::verbosity(); }
+
+    private: /* Fields: */
+
+        Priority const m_oldVerbosity;
+
+    }; /* class ScopedVerbosity */
+
 public: /* Methods: */
 
     Logger(std::shared_ptr<Backend> backend) noexcept;
@@ -153,10 +280,10 @@ public: /* Methods: */
     template <typename Arg, typename ... Args>
     Logger(std::shared_ptr<Backend> backend, Arg && arg, Args && ... args)
             noexcept
-        : m_backend(sharemind::assertReturn(std::move(backend)))
-        , m_prefix(sharemind::concat(std::forward<Arg>(arg),
-                                     std::forward<Args>(args)...,
-                                     ' '))
+        : Logger(std::move(backend),
+                 ComponentTag(),
+                 sharemind::concat(std::forward<Arg>(arg),
+                                   std::forward<Args>(args)...))
     {}
 
     Logger(Logger && move) noexcept;
@@ -165,23 +292,10 @@ public: /* Methods: */
 
     template <typename Arg, typename ... Args>
     Logger(Logger const & logger, Arg && arg, Args && ... args) noexcept
-        : m_backend(sharemind::assertReturn(logger.m_backend))
-        , m_prefix(logger.m_prefix.empty()
-                   ? sharemind::concat(std::forward<Arg>(arg),
-                                       std::forward<Args>(args)...,
-                                       ' ')
-                   : (*(logger.m_prefix.crbegin()) != ' ')
-                     ? sharemind::concat(logger.m_prefix,
-                                         std::forward<Arg>(arg),
-                                         std::forward<Args>(args)...,
-                                         ' ')
-                     : sharemind::concat(
-                           std::string(logger.m_prefix.cbegin(),
-                                       logger.m_prefix.cend() - 1),
-                           std::forward<Arg>(arg),
-                           std::forward<Args>(args)...,
-                           ' '))
-        , m_basePrefix(logger.m_prefix)
+        : Logger(logger,
+                 ComponentTag(),
+                 sharemind::concat(std::forward<Arg>(arg),
+                                   std::forward<Args>(args)...))
     {}
 
     ~Logger() noexcept;
@@ -199,10 +313,17 @@ public: /* Methods: */
     Backend::Lock retrieveBackendLock() const noexcept
     { return m_backend->retrieveLock(); }
 
-    template <typename ... Args> void setPrefix(Args && ... args) {
-        m_prefix = sharemind::concat(m_basePrefix,
-                                     std::forward<Args>(args)...,
-                                     ' ');
+    template <typename ... Args> void setPrefix(Args && ... args)
+    { setComponent(sharemind::concat(std::forward<Args>(args)...)); }
+
+    /** \returns the node of the Backend::filter() hierarchy of this Logger. */
+    PrefixFilter::Node const & filterNode() const noexcept
+    { return *m_filterNode; }
+
+    bool enabled(Priority const priority) const noexcept {
+        return (m_filterNode->enabled(priority)
+                || LogContext::elevates(priority))
+               && m_backend->overloadAllows(priority);
     }
 
     MessageBuilder fatal() const noexcept;
@@ -300,8 +421,29 @@ public: /* Methods: */
 
     static ::timeval now() noexcept;
 
+    /**
+      \returns details about the record which is being dispatched to appenders
+               by a MessageBuilder on this thread, or nullptr when not called
+               from within such a dispatch.
+    */
+    static RecordInfo const * currentRecordInfo() noexcept;
+
+private: /* Types: */
+
+    struct ComponentTag {};
+
 private: /* Methods: */
 
+    Logger(std::shared_ptr<Backend> backend,
+           ComponentTag,
+           std::string && component) noexcept;
+
+    Logger(Logger const & logger,
+           ComponentTag,
+           std::string && component) noexcept;
+
+    void setComponent(std::string && component);
+
     template <typename Printer>
     void printException_(std::exception_ptr e,
                          std::size_t const levelNow,
@@ -326,6 +468,8 @@ private: /* Fields: */
     std::shared_ptr<Backend> m_backend;
     std::string m_prefix;
     std::string m_basePrefix;
+    PrefixFilter::Node * m_filterNode;
+    PrefixFilter::Node * m_baseFilterNode;
 
 }; /* class Logger { */
 
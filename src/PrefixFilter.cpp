@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "PrefixFilter.h"
+
+#include <cassert>
+#include <utility>
+#include "Appender.h"
+
+
+namespace LogHard {
+
+PrefixFilter::Node::Node(Node * const parent,
+                         std::string name,
+                         Priority const priority) noexcept
+    : m_parent(parent)
+    , m_name(std::move(name))
+    , m_priority(priority)
+{}
+
+PrefixFilter::PrefixFilter(Priority const priority) noexcept
+    : m_root(nullptr, std::string(), priority)
+{
+    m_root.m_explicit = true;
+    m_root.m_pinned = true;
+}
+
+PrefixFilter::Node & PrefixFilter::child(Node & parent,
+                                         std::string const & component)
+{
+    auto name(nodeName(component));
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    auto & r = childLocked(parent, std::move(name));
+    r.m_pinned = true;
+    return r;
+}
+
+PrefixFilter::Node & PrefixFilter::acquireChild(Node & parent,
+                                                std::string const & component)
+{
+    auto name(nodeName(component));
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    auto & r = childLocked(parent, std::move(name));
+    acquire(r);
+    return r;
+}
+
+void PrefixFilter::release(Node & node) noexcept {
+    if (node.m_references.fetch_sub(1u, std::memory_order_acq_rel) != 1u)
+        return;
+    /* The node may have been acquired again by acquireChild() since, which
+       reclaimLocked() checks under the lock: */
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    reclaimLocked(node);
+}
+
+PrefixFilter::Node & PrefixFilter::node(std::string const & path) {
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    auto & r = nodeLocked(path);
+    r.m_pinned = true;
+    return r;
+}
+
+PrefixFilter::Node & PrefixFilter::nodeLocked(std::string const & path) {
+    Node * n = &m_root;
+    std::string::size_type start = 0u;
+    while (start < path.size()) {
+        auto end = path.find('/', start);
+        if (end == std::string::npos)
+            end = path.size();
+        if (end != start)
+            n = &childLocked(*n, path.substr(start, end - start));
+        start = end + 1u;
+    }
+    return *n;
+}
+
+void PrefixFilter::setPriority(Node & node, Priority const priority) noexcept
+{
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    node.m_explicit = true;
+    node.m_priority.store(priority, std::memory_order_relaxed);
+    propagate(node);
+    if (&node == &m_root)
+        Appender::noteDispatchChange();
+}
+
+void PrefixFilter::resetPriority(Node & node) noexcept {
+    if (!node.m_parent)
+        return;
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    node.m_explicit = false;
+    node.m_priority.store(node.m_parent->priority(),
+                          std::memory_order_relaxed);
+    propagate(node);
+    reclaimLocked(node);
+}
+
+std::string PrefixFilter::nodeName(std::string const & component) {
+    static char const whitespace[] = " \t";
+    auto begin = component.find_first_not_of(whitespace);
+    if (begin == std::string::npos)
+        return std::string();
+    auto end = component.find_last_not_of(whitespace) + 1u;
+    if (end - begin >= 2u
+        && component[begin] == '['
+        && component[end - 1u] == ']'
+        && component.find_first_of("[]", begin + 1u) == end - 1u)
+    {
+        ++begin;
+        --end;
+    }
+    return component.substr(begin, end - begin);
+}
+
+void PrefixFilter::configure(
+        std::vector<std::pair<std::string, Priority> > const & priorities)
+{ configure_(nullptr, priorities); }
+
+void PrefixFilter::configure(
+        Priority const rootPriority,
+        std::vector<std::pair<std::string, Priority> > const & priorities)
+{ configure_(&rootPriority, priorities); }
+
+void PrefixFilter::configure_(
+        Priority const * const rootPriority,
+        std::vector<std::pair<std::string, Priority> > const & priorities)
+{
+    std::vector<std::pair<Node *, Priority> > nodes;
+    nodes.reserve(priorities.size());
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    // Create the nodes first, so that nothing is changed on failure:
+    for (auto const & p : priorities)
+        nodes.emplace_back(&nodeLocked(p.first), p.second);
+
+    clearExplicit(m_root);
+    if (rootPriority) {
+        m_root.m_priority.store(*rootPriority, std::memory_order_relaxed);
+        Appender::noteDispatchChange();
+    }
+    for (auto const & np : nodes) {
+        np.first->m_explicit = true;
+        np.first->m_priority.store(np.second, std::memory_order_relaxed);
+    }
+    propagate(m_root);
+    prune(m_root);
+}
+
+PrefixFilter::Node & PrefixFilter::childLocked(Node & parent,
+                                               std::string name)
+{
+    auto it(parent.m_children.find(name));
+    if (it != parent.m_children.end())
+        return *it->second;
+    std::unique_ptr<Node> n(new Node(&parent, name, parent.priority()));
+    Node & r = *n;
+    parent.m_children.emplace(std::move(name), std::move(n));
+    return r;
+}
+
+std::vector<PrefixFilter::Volume> PrefixFilter::volumes() const {
+    std::vector<Volume> r;
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    collectVolumes(m_root, std::string(), r);
+    return r;
+}
+
+void PrefixFilter::collectVolumes(Node const & node,
+                                  std::string const & path,
+                                  std::vector<Volume> & volumes)
+{
+    volumes.emplace_back(Volume{path, node.volume()});
+    for (auto const & cp : node.m_children)
+        collectVolumes(*cp.second,
+                       path.empty() ? cp.first : path + '/' + cp.first,
+                       volumes);
+}
+
+bool PrefixFilter::reclaimable(Node const & node) noexcept {
+    return !node.m_pinned
+           && !node.m_explicit
+           && node.m_children.empty()
+           && !node.m_references.load(std::memory_order_acquire);
+}
+
+void PrefixFilter::reclaimLocked(Node & node) noexcept {
+    // Removing a node may make its parent reclaimable as well:
+    for (Node * n = &node; reclaimable(*n);) {
+        Node * const parent = n->m_parent;
+        assert(parent);
+        auto const it(parent->m_children.find(n->m_name));
+        assert(it != parent->m_children.end());
+        parent->m_children.erase(it);
+        n = parent;
+    }
+}
+
+void PrefixFilter::prune(Node & node) noexcept {
+    for (auto it = node.m_children.begin(); it != node.m_children.end();) {
+        prune(*it->second);
+        if (reclaimable(*it->second)) {
+            it = node.m_children.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PrefixFilter::clearExplicit(Node & node) noexcept {
+    for (auto & cp : node.m_children) {
+        cp.second->m_explicit = false;
+        clearExplicit(*cp.second);
+    }
+}
+
+void PrefixFilter::propagate(Node & node) noexcept {
+    auto const priority = node.priority();
+    for (auto & cp : node.m_children) {
+        Node & c = *cp.second;
+        if (!c.m_explicit)
+            c.m_priority.store(priority, std::memory_order_relaxed);
+        propagate(c);
+    }
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_PREFIXFILTER_H
+#define LOGHARD_PREFIXFILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Priority.h"
+#include "Statistics.h"
+
+
+namespace LogHard {
+
+/**
+  \brief A hierarchy of priority filters following the Logger prefixes.
+
+  Every Logger refers to a node of the hierarchy of its Backend. A child
+  Logger refers to a child node named after the prefix component it adds,
+  e.g. the node "Network/Tcp" for a Logger created by
+  Logger(Logger(backend, "[Network]"), "[Tcp]"). The priority of a node is
+  either set explicitly or inherited from its parent. Changes propagate to the
+  descendant nodes immediately, so that checking whether a record passes the
+  filter of a node takes a single atomic load.
+
+  Nodes returned by child() and node() are kept for the lifetime of the
+  filter. Nodes acquired by Loggers with acquireChild() are removed again
+  once they are neither referenced by Loggers, explicitly configured nor have
+  children, so that short-lived prefixes (e.g. one per session or peer) do
+  not accumulate. Their volume counts are dropped with them.
+*/
+class PrefixFilter {
+
+public: /* Types: */
+
+    class Node {
+
+        friend class PrefixFilter;
+
+    public: /* Methods: */
+
+        Node(Node const &) = delete;
+        Node & operator=(Node const &) = delete;
+
+        Priority priority() const noexcept
+        { return m_priority.load(std::memory_order_relaxed); }
+
+        bool enabled(Priority const priority) const noexcept
+        { return priority <= this->priority(); }
+
+        std::string const & name() const noexcept { return m_name; }
+
+        Node const * parent() const noexcept { return m_parent; }
+
+        /** \brief Accounts a record logged by a Logger of this node. */
+        void countVolume(Priority const priority, std::size_t const bytes)
+                const noexcept
+        { m_volume.record(priority, bytes); }
+
+        /** \returns the volume of records logged by Loggers of this node. */
+        VolumeCounters::Snapshot volume() const noexcept
+        { return m_volume.snapshot(); }
+
+    private: /* Methods: */
+
+        Node(Node * const parent,
+             std::string name,
+             Priority const priority) noexcept;
+
+    private: /* Fields: */
+
+        Node * const m_parent;
+        std::string const m_name;
+        std::atomic<Priority> m_priority;
+        mutable VolumeCounters m_volume;
+
+        /** The number of acquire() calls not matched by release() yet. */
+        std::atomic<std::size_t> m_references{0u};
+
+        /* The following are protected by PrefixFilter::m_mutex: */
+        bool m_explicit = false;
+        bool m_pinned = false;
+        std::map<std::string, std::unique_ptr<Node> > m_children;
+
+    }; /* class Node { */
+
+    struct Volume {
+        /** The path of the node as for node(). */
+        std::string path;
+        VolumeCounters::Snapshot counts;
+    };
+
+public: /* Methods: */
+
+    PrefixFilter(Priority const priority = Priority::Normal) noexcept;
+
+    Node & root() noexcept { return m_root; }
+    Node const & root() const noexcept { return m_root; }
+
+    /**
+      \returns the child node for the given Logger prefix component, creating
+               it if needed.
+    */
+    Node & child(Node & parent, std::string const & component);
+
+    /**
+      \brief Like child(), but acquires a reference to the node instead of
+             keeping it for the lifetime of the filter.
+      \note Every acquired node must be released by release().
+    */
+    Node & acquireChild(Node & parent, std::string const & component);
+
+    /** \brief Acquires another reference to an already acquired node. */
+    static void acquire(Node & node) noexcept
+    { node.m_references.fetch_add(1u, std::memory_order_relaxed); }
+
+    /** \brief Releases a reference, removing the node if no longer needed. */
+    void release(Node & node) noexcept;
+
+    /**
+      \param[in] path The '/'-separated names of the nodes starting from the
+                      root, e.g. "Network/Tcp". The empty path denotes the
+                      root.
+      \returns the node with the given path, creating it if needed.
+    */
+    Node & node(std::string const & path);
+
+    /** \brief Explicitly sets the priority of the given node. */
+    void setPriority(Node & node, Priority const priority) noexcept;
+
+    /** \brief Makes the given non-root node inherit the priority again. */
+    void resetPriority(Node & node) noexcept;
+
+    /**
+      \brief Replaces the explicit priorities of all non-root nodes in a single
+             step. Every node changes directly from its old to its new
+             priority.
+      \param[in] priorities Pairs of node paths (as for node()) and their
+                            priorities.
+    */
+    void configure(
+            std::vector<std::pair<std::string, Priority> > const & priorities);
+
+    /** \brief Like configure(priorities), but also sets the root priority. */
+    void configure(
+            Priority const rootPriority,
+            std::vector<std::pair<std::string, Priority> > const & priorities);
+
+    /** \returns the volumes of all nodes, parents before their children. */
+    std::vector<Volume> volumes() const;
+
+    /**
+      \returns the name of the node for the given Logger prefix component, i.e.
+               the component stripped of whitespace and enclosing brackets.
+    */
+    static std::string nodeName(std::string const & component);
+
+private: /* Methods: */
+
+    Node & childLocked(Node & parent, std::string name);
+    Node & nodeLocked(std::string const & path);
+
+    void configure_(
+            Priority const * const rootPriority,
+            std::vector<std::pair<std::string, Priority> > const & priorities);
+
+    static bool reclaimable(Node const & node) noexcept;
+    static void reclaimLocked(Node & node) noexcept;
+    static void prune(Node & node) noexcept;
+    static void clearExplicit(Node & node) noexcept;
+    static void propagate(Node & node) noexcept;
+    static void collectVolumes(Node const & node,
+                               std::string const & path,
+                               std::vector<Volume> & volumes);
+
+private: /* Fields: */
+
+    mutable std::mutex m_mutex;
+    Node m_root;
+
+}; /* class PrefixFilter { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_PREFIXFILTER_H */
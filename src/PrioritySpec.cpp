@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "PrioritySpec.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <sharemind/Concat.h>
+#include "PriorityParser.h"
+
+
+namespace LogHard {
+
+namespace {
+
+std::string trim(std::string const & s, std::size_t begin, std::size_t end) {
+    static char const whitespace[] = " \t\r\n";
+    begin = s.find_first_not_of(whitespace, begin);
+    if (begin >= end)
+        return std::string();
+    end = s.find_last_not_of(whitespace, end - 1u) + 1u;
+    return s.substr(begin, end - begin);
+}
+
+} // anonymous namespace
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    PrioritySpec::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(PrioritySpec::Exception,
+                                                    PrioritySpec::,
+                                                    ParseException);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(PrioritySpec::Exception,
+                                                    PrioritySpec::,
+                                                    UnknownAppenderException);
+
+PrioritySpec::PrioritySpec() noexcept {}
+
+PrioritySpec::PrioritySpec(char const * spec)
+    : PrioritySpec((assert(spec), std::string(spec)))
+{}
+
+PrioritySpec::PrioritySpec(std::string const & spec) {
+    std::size_t start = 0u;
+    while (start <= spec.size()) {
+        auto end = spec.find(',', start);
+        if (end == std::string::npos)
+            end = spec.size();
+        auto const entry(trim(spec, start, end));
+        start = end + 1u;
+        if (entry.empty())
+            continue;
+
+        auto const eq = entry.rfind('=');
+        if (eq == std::string::npos)
+            throw ParseException(sharemind::concat(
+                                     "Missing '=' in priority specification "
+                                     "entry \"", entry, "\"!"));
+        auto target(trim(entry, 0u, eq));
+        if (target.empty())
+            throw ParseException(sharemind::concat(
+                                     "Missing target in priority "
+                                     "specification entry \"", entry, "\"!"));
+        Priority priority;
+        try {
+            priority = parsePriority(trim(entry, eq + 1u, entry.size()));
+        } catch (PriorityParseException const &) {
+            throw ParseException(sharemind::concat(
+                                     "Invalid priority in priority "
+                                     "specification entry \"", entry, "\"!"));
+        }
+
+        if (target == "*") {
+            m_hasBackendPriority = true;
+            m_backendPriority = priority;
+        } else if (target.find(':') != std::string::npos) {
+            m_appenderPriorities.emplace_back(std::move(target), priority);
+        } else {
+            std::replace(target.begin(), target.end(), '.', '/');
+            m_nodePriorities.emplace_back(std::move(target), priority);
+        }
+    }
+}
+
+PrioritySpec PrioritySpec::fromEnvironment(char const * const name) {
+    assert(name);
+    if (char const * const spec = std::getenv(name))
+        return PrioritySpec(spec);
+    return PrioritySpec();
+}
+
+bool PrioritySpec::empty() const noexcept {
+    return !m_hasBackendPriority
+           && m_nodePriorities.empty()
+           && m_appenderPriorities.empty();
+}
+
+void PrioritySpec::apply(Backend & backend, Appenders const & appenders) const
+{
+    // Resolve the appenders first, so that nothing is changed on failure:
+    std::vector<std::pair<Appender *, Priority> > resolved;
+    resolved.reserve(m_appenderPriorities.size());
+    for (auto const & ap : m_appenderPriorities) {
+        auto const it(appenders.find(ap.first));
+        if (it == appenders.end() || !it->second)
+            throw UnknownAppenderException(
+                    sharemind::concat("Unknown appender \"", ap.first,
+                                      "\" in priority specification!"));
+        resolved.emplace_back(it->second.get(), ap.second);
+    }
+
+    if (m_hasBackendPriority) {
+        backend.filter().configure(m_backendPriority, m_nodePriorities);
+    } else {
+        backend.filter().configure(m_nodePriorities);
+    }
+    for (auto const & ap : resolved)
+        ap.first->setPriority(ap.second);
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_PRIORITYSPEC_H
+#define LOGHARD_PRIORITYSPEC_H
+
+#include <exception>
+#include <map>
+#include <memory>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Appender.h"
+#include "Backend.h"
+#include "Exception.h"
+#include "Priority.h"
+
+
+namespace LogHard {
+
+/**
+  \brief A parsed priority specification, e.g.
+
+      "*=warn,Network=debug,Network.Tls=fulldebug,file:/var/log/x=info"
+
+  Each comma-separated entry sets a priority (as accepted by parsePriority())
+  for a target. The target "*" denotes the Backend itself, targets containing
+  a colon denote appenders by the names given to apply(), and all other targets
+  denote nodes of the Backend::filter() hierarchy, with '.' or '/' separating
+  the node names.
+*/
+class PrioritySpec {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         ParseException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+            Exception,
+            UnknownAppenderException);
+
+    using Appenders = std::map<std::string, std::shared_ptr<Appender> >;
+
+public: /* Methods: */
+
+    PrioritySpec() noexcept;
+    explicit PrioritySpec(char const * spec);
+    explicit PrioritySpec(std::string const & spec);
+
+    /**
+      \returns the specification in the given environment variable, or an empty
+               specification if the variable is not set.
+    */
+    static PrioritySpec fromEnvironment(
+            char const * const name = "LOGHARD_PRIORITY");
+
+    bool empty() const noexcept;
+
+    /**
+      \brief Applies the specification, replacing any priorities set for the
+             filter nodes by a previous specification.
+      \param[in] appenders The appenders which may be named in the
+                           specification.
+    */
+    void apply(Backend & backend,
+               Appenders const & appenders = Appenders()) const;
+
+private: /* Fields: */
+
+    bool m_hasBackendPriority = false;
+    Priority m_backendPriority = Priority::Normal;
+    std::vector<std::pair<std::string, Priority> > m_nodePriorities;
+    std::vector<std::pair<std::string, Priority> > m_appenderPriorities;
+
+}; /* class PrioritySpec { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_PRIORITYSPEC_H */
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "PrioritySpecWatcher.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sharemind/Concat.h>
+#include <sstream>
+#include <unistd.h>
+#include <utility>
+
+#ifdef __linux__
+#include <climits>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#endif
+
+
+namespace LogHard {
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    PrioritySpecWatcher::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        PrioritySpecWatcher::Exception,
+        PrioritySpecWatcher::,
+        WatchException);
+
+PrioritySpecWatcher::PrioritySpecWatcher(std::shared_ptr<Backend> backend,
+                                         std::string path,
+                                         PrioritySpec::Appenders appenders)
+    : m_path(std::move(path))
+    , m_appenders(std::move(appenders))
+    , m_logger(std::move(backend), "[PrioritySpecWatcher]")
+{
+    try {
+        #ifdef __linux__
+        // Watch the directory, so that replacing the file is also noticed:
+        auto const slash = m_path.rfind('/');
+        std::string const directory(
+                    slash == std::string::npos
+                    ? std::string(".")
+                    : slash == 0u
+                      ? std::string("/")
+                      : m_path.substr(0u, slash));
+        m_fileName = (slash == std::string::npos)
+                     ? m_path
+                     : m_path.substr(slash + 1u);
+
+        m_inotifyFd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (m_inotifyFd == -1)
+            throw sharemind::ErrnoException(errno);
+        if (::inotify_add_watch(m_inotifyFd,
+                                directory.c_str(),
+                                IN_CLOSE_WRITE | IN_MOVED_TO) == -1)
+            throw sharemind::ErrnoException(errno);
+        m_stopFd = ::eventfd(0u, EFD_CLOEXEC);
+        if (m_stopFd == -1)
+            throw sharemind::ErrnoException(errno);
+        reload();
+        m_thread = std::thread(&PrioritySpecWatcher::run, this);
+        #else
+        throw sharemind::ErrnoException(ENOSYS);
+        #endif
+    } catch (...) {
+        if (m_stopFd != -1)
+            ::close(m_stopFd);
+        if (m_inotifyFd != -1)
+            ::close(m_inotifyFd);
+        std::throw_with_nested(
+                    WatchException(
+                        sharemind::concat("Failed to watch \"", m_path,
+                                          "\" for priority specifications!")));
+    }
+}
+
+PrioritySpecWatcher::~PrioritySpecWatcher() noexcept {
+    #ifdef __linux__
+    std::uint64_t const one = 1u;
+    #ifdef __GNUC__
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wunused-result"
+    #endif
+    (void) ::write(m_stopFd, &one, sizeof(one));
+    #ifdef __GNUC__
+    #pragma GCC diagnostic pop
+    #endif
+    m_thread.join();
+    ::close(m_stopFd);
+    ::close(m_inotifyFd);
+    #endif
+}
+
+void PrioritySpecWatcher::reload() noexcept {
+    try {
+        std::ifstream file(m_path);
+        if (!file)
+            return;
+        std::ostringstream oss;
+        oss << file.rdbuf();
+        PrioritySpec const spec(oss.str());
+        spec.apply(*m_logger.backend(), m_appenders);
+        m_logger.info() << "Applied priority specification from \"" << m_path
+                        << "\".";
+    } catch (...) {
+        m_logger.error() << "Failed to apply priority specification from \""
+                         << m_path << "\":";
+        m_logger.printCurrentException<Priority::Error>();
+    }
+}
+
+void PrioritySpecWatcher::run() noexcept {
+    #ifdef __linux__
+    ::pollfd fds[2u] = {{m_inotifyFd, POLLIN, 0}, {m_stopFd, POLLIN, 0}};
+    alignas(::inotify_event) char buffer[sizeof(::inotify_event) + NAME_MAX
+                                         + 1u];
+    for (;;) {
+        if (::poll(fds, 2u, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            m_logger.error() << "Failed to wait for changes to \"" << m_path
+                             << "\": " << std::strerror(errno);
+            return;
+        }
+        if (fds[1u].revents)
+            return;
+
+        bool changed = false;
+        ::ssize_t r;
+        while ((r = ::read(m_inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char const * p = buffer; p < buffer + r;) {
+                auto const & e = *reinterpret_cast<::inotify_event const *>(p);
+                if (e.len && m_fileName == e.name)
+                    changed = true;
+                p += sizeof(::inotify_event) + e.len;
+            }
+        }
+        if (changed)
+            reload();
+    }
+    #endif
+}
+
+} /* namespace LogHard { */
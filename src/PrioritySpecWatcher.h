@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_PRIORITYSPECWATCHER_H
+#define LOGHARD_PRIORITYSPECWATCHER_H
+
+#include <exception>
+#include <memory>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <thread>
+#include "Backend.h"
+#include "Exception.h"
+#include "Logger.h"
+#include "PrioritySpec.h"
+
+
+namespace LogHard {
+
+/**
+  \brief Applies the PrioritySpec in a file to a Backend whenever the file is
+         written or replaced, using inotify (Linux only).
+
+  The file is read once on construction, if it exists. Failures to read, parse
+  or apply the file are logged to the Backend.
+*/
+class PrioritySpecWatcher {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         WatchException);
+
+public: /* Methods: */
+
+    PrioritySpecWatcher(std::shared_ptr<Backend> backend,
+                        std::string path,
+                        PrioritySpec::Appenders appenders =
+                                PrioritySpec::Appenders());
+    ~PrioritySpecWatcher() noexcept;
+
+    PrioritySpecWatcher(PrioritySpecWatcher const &) = delete;
+    PrioritySpecWatcher & operator=(PrioritySpecWatcher const &) = delete;
+
+private: /* Methods: */
+
+    void reload() noexcept;
+    void run() noexcept;
+
+private: /* Fields: */
+
+    std::string const m_path;
+    std::string m_fileName;
+    PrioritySpec::Appenders const m_appenders;
+    Logger const m_logger;
+    int m_inotifyFd = -1;
+    int m_stopFd = -1;
+    std::thread m_thread;
+
+}; /* class PrioritySpecWatcher { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_PRIORITYSPECWATCHER_H */
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "RateLimiter.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+namespace LogHard {
+
+constexpr std::uint64_t RateLimiter::NANOSECONDS_PER_SECOND;
+
+bool RateLimiter::acquireToken() noexcept {
+    using namespace std::chrono;
+    std::uint64_t const now = static_cast<std::uint64_t>(
+            duration_cast<nanoseconds>(
+                steady_clock::now().time_since_epoch()).count());
+
+    // Generic cell rate algorithm, the state is the theoretical arrival time:
+    auto tat = m_state.load(std::memory_order_relaxed);
+    do {
+        if (tat > now + m_tolerance)
+            return false;
+    } while (!m_state.compare_exchange_weak(tat,
+                                            std::max(tat, now) + m_interval,
+                                            std::memory_order_relaxed));
+    return true;
+}
+
+} /* namespace LogHard { */
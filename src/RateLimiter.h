@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_RATELIMITER_H
+#define LOGHARD_RATELIMITER_H
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace LogHard {
+
+/**
+  \brief Lock-free per call site rate limiter, see LOGHARD_LOG_EVERY_N and
+         LOGHARD_LOG_RATE.
+
+  Either passes every N-th record, or implements a token bucket with the
+  given rate and burst size. The number of records suppressed since the last
+  record which passed is kept for reporting.
+*/
+class alignas(64) RateLimiter {
+
+public: /* Methods: */
+
+    /** \brief Passes the first record and every N-th record after it. */
+    constexpr explicit RateLimiter(std::uint64_t const everyN) noexcept
+        : m_everyN(everyN ? everyN : 1u)
+        , m_interval(0u)
+        , m_tolerance(0u)
+    {}
+
+    /**
+      \brief Passes on average perSecond records per second, allowing bursts
+             of up to burst records.
+    */
+    constexpr RateLimiter(std::uint64_t const perSecond,
+                          std::uint64_t const burst) noexcept
+        : m_everyN(0u)
+        , m_interval(NANOSECONDS_PER_SECOND / (perSecond ? perSecond : 1u))
+        , m_tolerance((burst ? burst - 1u : 0u)
+                      * (NANOSECONDS_PER_SECOND / (perSecond ? perSecond : 1u)))
+    {}
+
+    RateLimiter(RateLimiter const &) = delete;
+    RateLimiter & operator=(RateLimiter const &) = delete;
+
+    /** \returns whether the next record passes the limiter. */
+    bool acquire() noexcept {
+        if (m_everyN) {
+            if (!(m_state.fetch_add(1u, std::memory_order_relaxed) % m_everyN))
+                return true;
+        } else if (acquireToken()) {
+            return true;
+        }
+        m_suppressed.fetch_add(1u, std::memory_order_relaxed);
+        return false;
+    }
+
+    /** \returns the number of suppressed records since the last call. */
+    std::uint64_t takeSuppressed() noexcept
+    { return m_suppressed.exchange(0u, std::memory_order_relaxed); }
+
+private: /* Methods: */
+
+    bool acquireToken() noexcept;
+
+private: /* Constants: */
+
+    constexpr static std::uint64_t NANOSECONDS_PER_SECOND = 1000000000u;
+
+private: /* Fields: */
+
+    std::uint64_t const m_everyN;
+    std::uint64_t const m_interval;
+    std::uint64_t const m_tolerance;
+
+    /** The record counter or the theoretical arrival time in nanoseconds. */
+    std::atomic<std::uint64_t> m_state{0u};
+    std::atomic<std::uint64_t> m_suppressed{0u};
+
+}; /* class RateLimiter { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_RATELIMITER_H */
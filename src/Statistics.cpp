@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "Statistics.h"
+
+#include <cassert>
+#include <limits>
+
+
+namespace LogHard {
+
+namespace {
+
+std::atomic<std::size_t> nextShard{0u};
+thread_local std::size_t tl_shard = Histogram::SHARDS;
+thread_local unsigned tl_latencySample = 0u;
+
+std::size_t currentShard() noexcept {
+    if (tl_shard == Histogram::SHARDS)
+        tl_shard = nextShard.fetch_add(1u, std::memory_order_relaxed)
+                   % (Histogram::SHARDS - 1u) + 1u;
+    return tl_shard;
+}
+
+unsigned log2(std::uint64_t const value) noexcept {
+    assert(value);
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+}
+
+} // anonymous namespace
+
+constexpr unsigned Histogram::SUB_BUCKET_BITS;
+constexpr unsigned Histogram::SUB_BUCKETS;
+constexpr unsigned Histogram::MAX_EXPONENT;
+constexpr std::size_t Histogram::BUCKETS;
+constexpr std::size_t Histogram::SHARDS;
+constexpr std::size_t VolumeCounters::PRIORITIES;
+constexpr std::size_t VolumeCounters::SHARDS;
+constexpr unsigned AppenderCounters::LATENCY_SAMPLE_INTERVAL;
+
+std::uint64_t Histogram::Snapshot::percentile(double const p) const noexcept {
+    if (!count)
+        return 0u;
+    auto const rank = static_cast<std::uint64_t>(
+            static_cast<double>(count - 1u) * p) + 1u;
+    std::uint64_t seen = 0u;
+    for (std::size_t i = 0u; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return bucketUpperBound(i);
+    }
+    return max();
+}
+
+std::uint64_t Histogram::Snapshot::max() const noexcept {
+    for (std::size_t i = BUCKETS; i; --i)
+        if (buckets[i - 1u])
+            return bucketUpperBound(i - 1u);
+    return 0u;
+}
+
+void Histogram::Snapshot::merge(Snapshot const & other) noexcept {
+    count += other.count;
+    sum += other.sum;
+    for (std::size_t i = 0u; i < BUCKETS; ++i)
+        buckets[i] += other.buckets[i];
+}
+
+void Histogram::record(std::uint64_t const value) noexcept {
+    auto & shard = m_shards[currentShard()];
+    shard.buckets[bucketIndex(value)].fetch_add(1u, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+void Histogram::recordSerialized(std::uint64_t const value) noexcept {
+    // The first shard is reserved for serialized callers:
+    auto & shard = m_shards[0u];
+    auto & bucket = shard.buckets[bucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1u,
+                 std::memory_order_relaxed);
+    shard.sum.store(shard.sum.load(std::memory_order_relaxed) + value,
+                    std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const noexcept {
+    Snapshot r;
+    r.count = 0u;
+    r.sum = 0u;
+    r.buckets.fill(0u);
+    for (auto const & shard : m_shards) {
+        for (std::size_t i = 0u; i < BUCKETS; ++i) {
+            auto const n = shard.buckets[i].load(std::memory_order_relaxed);
+            r.buckets[i] += n;
+            r.count += n;
+        }
+        r.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return r;
+}
+
+std::size_t Histogram::bucketIndex(std::uint64_t const value) noexcept {
+    if (value < SUB_BUCKETS)
+        return static_cast<std::size_t>(value);
+    auto const e = log2(value);
+    if (e > MAX_EXPONENT)
+        return BUCKETS - 1u;
+    auto const sub = (value >> (e - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1u);
+    return (e - SUB_BUCKET_BITS + 1u) * SUB_BUCKETS
+           + static_cast<std::size_t>(sub);
+}
+
+std::uint64_t Histogram::bucketLowerBound(std::size_t const index) noexcept {
+    assert(index < BUCKETS);
+    if (index < SUB_BUCKETS)
+        return index;
+    auto const e = static_cast<unsigned>(index / SUB_BUCKETS)
+                   + SUB_BUCKET_BITS - 1u;
+    auto const sub = static_cast<std::uint64_t>(index % SUB_BUCKETS);
+    return (SUB_BUCKETS + sub) << (e - SUB_BUCKET_BITS);
+}
+
+std::uint64_t Histogram::bucketUpperBound(std::size_t const index) noexcept {
+    assert(index < BUCKETS);
+    if (index == BUCKETS - 1u)
+        return std::numeric_limits<std::uint64_t>::max();
+    return bucketLowerBound(index + 1u) - 1u;
+}
+
+std::uint64_t VolumeCounters::Snapshot::totalMessages() const noexcept {
+    std::uint64_t r = 0u;
+    for (auto const n : messages)
+        r += n;
+    return r;
+}
+
+std::uint64_t VolumeCounters::Snapshot::totalBytes() const noexcept {
+    std::uint64_t r = 0u;
+    for (auto const n : bytes)
+        r += n;
+    return r;
+}
+
+void VolumeCounters::record(Priority const priority, std::size_t const bytes)
+        noexcept
+{
+    auto & shard = m_shards[currentShard() % SHARDS];
+    auto const p = static_cast<std::size_t>(priority);
+    shard.messages[p].fetch_add(1u, std::memory_order_relaxed);
+    shard.bytes[p].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+VolumeCounters::Snapshot VolumeCounters::snapshot() const noexcept {
+    Snapshot r;
+    r.messages.fill(0u);
+    r.bytes.fill(0u);
+    for (auto const & shard : m_shards) {
+        for (std::size_t p = 0u; p < PRIORITIES; ++p) {
+            r.messages[p] += shard.messages[p].load(std::memory_order_relaxed);
+            r.bytes[p] += shard.bytes[p].load(std::memory_order_relaxed);
+        }
+    }
+    return r;
+}
+
+bool AppenderCounters::sampleLatency() noexcept
+{ return !(tl_latencySample++ % LATENCY_SAMPLE_INTERVAL); }
+
+AppenderStatistics AppenderCounters::snapshot() const noexcept {
+    AppenderStatistics r;
+    r.records = records.load(std::memory_order_relaxed);
+    r.bytes = bytes.load(std::memory_order_relaxed);
+    r.filtered = filtered.load(std::memory_order_relaxed);
+    r.latency = latency.snapshot();
+    return r;
+}
+
+BackendStatistics BackendCounters::snapshot() const noexcept {
+    BackendStatistics r;
+    for (std::size_t i = 0u; i < records.size(); ++i)
+        r.records[i] = records[i].load(std::memory_order_relaxed);
+    r.bytesFormatted = bytesFormatted.load(std::memory_order_relaxed);
+    r.bytesDelivered = bytesDelivered.load(std::memory_order_relaxed);
+    r.filtered = filtered.load(std::memory_order_relaxed);
+    r.elided = elided.load(std::memory_order_relaxed);
+    r.dropped = dropped.load(std::memory_order_relaxed);
+    r.suppressed = suppressed.load(std::memory_order_relaxed);
+    r.lockWait = lockWait.snapshot();
+    return r;
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,265 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_STATISTICS_H
+#define LOGHARD_STATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+#include "Priority.h"
+
+
+/* Statistics are collected unless the library is built with
+   LOGHARD_NO_STATISTICS defined, see the LogHard_STATISTICS CMake option.
+   The definition is part of the LogHard target interface, because code
+   including this header must agree with the library about it. */
+#ifndef LOGHARD_NO_STATISTICS
+#define LOGHARD_STATISTICS_ONLY(...) __VA_ARGS__
+#else
+#define LOGHARD_STATISTICS_ONLY(...)
+#endif
+
+namespace LogHard {
+
+/**
+  \brief A lock-free log-linear histogram of durations in nanoseconds.
+
+  Every power of two is split into SUB_BUCKETS linear buckets, hence the
+  relative error of the bucket bounds is at most 1/SUB_BUCKETS. Values are
+  recorded into per-thread shards to avoid contention.
+*/
+class Histogram {
+
+public: /* Constants: */
+
+    constexpr static unsigned SUB_BUCKET_BITS = 2u;
+    constexpr static unsigned SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    /** Larger values (about 18 minutes) are recorded into the last bucket. */
+    constexpr static unsigned MAX_EXPONENT = 40u;
+    constexpr static std::size_t BUCKETS =
+            (MAX_EXPONENT - SUB_BUCKET_BITS + 2u) * SUB_BUCKETS;
+    constexpr static std::size_t SHARDS = 8u;
+
+public: /* Types: */
+
+    struct Snapshot {
+
+        /** \returns the upper bound of the bucket of the given percentile. */
+        std::uint64_t percentile(double const p) const noexcept;
+
+        /** \returns the upper bound of the highest nonempty bucket. */
+        std::uint64_t max() const noexcept;
+
+        void merge(Snapshot const & other) noexcept;
+
+        std::uint64_t count;
+        std::uint64_t sum;
+        std::array<std::uint64_t, BUCKETS> buckets;
+
+    };
+
+public: /* Methods: */
+
+    void record(std::uint64_t const value) noexcept;
+
+    /** \brief Like record(), but for callers which are serialized. */
+    void recordSerialized(std::uint64_t const value) noexcept;
+
+    Snapshot snapshot() const noexcept;
+
+    static std::size_t bucketIndex(std::uint64_t const value) noexcept;
+    static std::uint64_t bucketLowerBound(std::size_t const index) noexcept;
+    static std::uint64_t bucketUpperBound(std::size_t const index) noexcept;
+
+private: /* Types: */
+
+    /** Padded instead of aligned, since histograms are allocated with new. */
+    struct Shard {
+        std::array<std::atomic<std::uint64_t>, BUCKETS> buckets;
+        std::atomic<std::uint64_t> sum;
+        char padding[64u];
+    };
+
+private: /* Fields: */
+
+    std::array<Shard, SHARDS> m_shards{};
+
+}; /* class Histogram { */
+
+/**
+  \brief Lock-free message and byte counters per priority with per-thread
+         shards, see PrefixFilter::Node::volume().
+*/
+class VolumeCounters {
+
+public: /* Constants: */
+
+    constexpr static std::size_t PRIORITIES =
+            static_cast<std::size_t>(Priority::FullDebug) + 1u;
+    constexpr static std::size_t SHARDS = 4u;
+
+public: /* Types: */
+
+    struct Snapshot {
+
+        std::uint64_t totalMessages() const noexcept;
+        std::uint64_t totalBytes() const noexcept;
+
+        std::array<std::uint64_t, PRIORITIES> messages;
+        std::array<std::uint64_t, PRIORITIES> bytes;
+
+    };
+
+public: /* Methods: */
+
+    void record(Priority const priority, std::size_t const bytes) noexcept;
+
+    Snapshot snapshot() const noexcept;
+
+private: /* Types: */
+
+    struct Shard {
+        std::array<std::atomic<std::uint64_t>, PRIORITIES> messages;
+        std::array<std::atomic<std::uint64_t>, PRIORITIES> bytes;
+        char padding[64u];
+    };
+
+private: /* Fields: */
+
+    std::array<Shard, SHARDS> m_shards{};
+
+}; /* class VolumeCounters { */
+
+/** \brief Statistics of an Appender, see Appender::statistics(). */
+struct AppenderStatistics {
+    /** Records passed to the appender implementation. */
+    std::uint64_t records;
+    /** Message bytes of these records. */
+    std::uint64_t bytes;
+    /**
+      Records rejected by the priority of the appender. Backends skip such
+      appenders using their dispatch tables, so only elevated records (see
+      Logger::ScopedVerbosity) and direct calls are counted.
+    */
+    std::uint64_t filtered;
+    /**
+      Duration of doLog() and doLogBatch() calls, sampled for every
+      AppenderCounters::LATENCY_SAMPLE_INTERVAL-th call of each thread.
+    */
+    Histogram::Snapshot latency;
+};
+
+/** \brief Statistics of a Backend, see Backend::statistics(). */
+struct BackendStatistics {
+    /** Records delivered to the appenders, per priority. */
+    std::array<std::uint64_t,
+               static_cast<std::size_t>(Priority::FullDebug) + 1u> records;
+    /** Message bytes of records which passed the Logger filters. */
+    std::uint64_t bytesFormatted;
+    /** Message bytes of records delivered to the appenders. */
+    std::uint64_t bytesDelivered;
+    /** Records rejected by Backend::Appender due to the priority. */
+    std::uint64_t filtered;
+    /** Records which did not fit into the message buffer of the Logger. */
+    std::uint64_t elided;
+    /** Records rejected by Backend::Appender due to overload protection. */
+    std::uint64_t dropped;
+    /** Records suppressed as duplicates or by rate limiters. */
+    std::uint64_t suppressed;
+    /** Time spent waiting for the Backend lock. */
+    Histogram::Snapshot lockWait;
+    std::vector<AppenderStatistics> appenders;
+};
+
+struct AppenderCounters {
+
+    /** Reading the clock costs more than the rest of the bookkeeping. */
+    constexpr static unsigned LATENCY_SAMPLE_INTERVAL = 16u;
+
+    void recordLogged(std::size_t const recordCount,
+                      std::size_t const byteCount) noexcept
+    {
+        records.fetch_add(recordCount, std::memory_order_relaxed);
+        bytes.fetch_add(byteCount, std::memory_order_relaxed);
+    }
+
+    /** \returns whether the latency of the current call is to be sampled. */
+    static bool sampleLatency() noexcept;
+
+    AppenderStatistics snapshot() const noexcept;
+
+    std::atomic<std::uint64_t> records{0u};
+    std::atomic<std::uint64_t> bytes{0u};
+    std::atomic<std::uint64_t> filtered{0u};
+    Histogram latency;
+
+};
+
+struct BackendCounters {
+
+    static void increment(std::atomic<std::uint64_t> & counter,
+                          std::uint64_t const n = 1u) noexcept
+    { counter.fetch_add(n, std::memory_order_relaxed); }
+
+    /** \brief Like increment(), but for callers holding the Backend lock. */
+    static void incrementLocked(std::atomic<std::uint64_t> & counter,
+                                std::uint64_t const n = 1u) noexcept
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n,
+                      std::memory_order_relaxed);
+    }
+
+    /** \returns the statistics except for the appenders. */
+    BackendStatistics snapshot() const noexcept;
+
+    std::array<std::atomic<std::uint64_t>,
+               static_cast<std::size_t>(Priority::FullDebug) + 1u> records{};
+    std::atomic<std::uint64_t> bytesFormatted{0u};
+    std::atomic<std::uint64_t> bytesDelivered{0u};
+    std::atomic<std::uint64_t> filtered{0u};
+    std::atomic<std::uint64_t> elided{0u};
+    std::atomic<std::uint64_t> dropped{0u};
+    std::atomic<std::uint64_t> suppressed{0u};
+    Histogram lockWait;
+
+};
+
+/** \returns new counters, or nullptr if statistics are disabled. */
+template <typename Counters>
+Counters * newCounters() noexcept {
+    LOGHARD_STATISTICS_ONLY(return new (std::nothrow) Counters();)
+    return nullptr;
+}
+
+/** \returns the duration in nanoseconds. */
+template <typename Duration>
+std::uint64_t durationNanoseconds(Duration const duration) noexcept {
+    return static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    duration).count());
+}
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_STATISTICS_H */
@@ -20,11 +20,18 @@
 #include "StdAppender.h"
 
 #include <unistd.h>
+#include <utility>
 #include "CFileAppender.h"
 
 
 namespace LogHard {
 
+StdAppender::StdAppender() noexcept {}
+
+StdAppender::StdAppender(Layout layout)
+    : m_layout(new Layout(std::move(layout)))
+{}
+
 StdAppender::~StdAppender() noexcept {}
 
 void StdAppender::doLog(::timeval time,
@@ -34,7 +41,13 @@ void StdAppender::doLog(::timeval time,
     int const fn = (priority <= Priority::Warning)
                     ? STDERR_FILENO
                     : STDOUT_FILENO;
-    CFileAppender::logToFile(fn, time, priority, message);
+    if (m_layout) {
+        CFileAppender::logToFile(
+                    fn,
+                    Layout::FormattedLine(*m_layout, time, priority, message));
+    } else {
+        CFileAppender::logToFile(fn, time, priority, message);
+    }
 }
 
 } /* namespace LogHard { */
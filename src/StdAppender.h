@@ -22,6 +22,9 @@
 
 #include "Appender.h"
 
+#include <memory>
+#include "Layout.h"
+
 
 namespace LogHard {
 
@@ -29,6 +32,8 @@ class StdAppender: public Appender {
 
 public: /* Methods: */
 
+    StdAppender() noexcept;
+    explicit StdAppender(Layout layout);
     ~StdAppender() noexcept override;
 
 private: /* Methods: */
@@ -37,6 +42,11 @@ private: /* Methods: */
                Priority const priority,
                char const * message) noexcept override;
 
+private: /* Fields: */
+
+    /** If null, lines are laid out by CFileAppender::FormattedLine. */
+    std::unique_ptr<Layout const> m_layout;
+
 }; /* class StdAppender */
 
 } /* namespace LogHard { */
@@ -0,0 +1,385 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "SyslogSocketAppender.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sharemind/Concat.h>
+#include <pthread.h>
+#include <sharemind/DebugOnly.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <vector>
+
+
+namespace LogHard {
+
+namespace {
+
+constexpr std::size_t TIMESTAMP_BUFFER_SIZE =
+        sizeof("YYYY-MM-DDTHH:MM:SS.uuuuuuZ");
+
+/** The formatted second of the previous record of the thread. */
+struct TimeStampCache {
+    bool valid;
+    ::time_t second;
+    std::size_t size;
+    char text[TIMESTAMP_BUFFER_SIZE];
+};
+
+thread_local TimeStampCache tl_rfc3164Cache;
+thread_local TimeStampCache tl_rfc5424Cache;
+
+std::size_t formatRfc3164TimeStamp(char * const buffer, ::timeval const & time)
+        noexcept
+{
+    auto & cache = tl_rfc3164Cache;
+    if (!cache.valid || (cache.second != time.tv_sec)) {
+        // Not using %b, since it is locale dependent:
+        static char const months[][4u] = {
+            "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+        };
+        std::tm tm;
+        SHAREMIND_DEBUG_ONLY(auto const r =) ::localtime_r(&time.tv_sec, &tm);
+        assert(r);
+        auto const n = std::snprintf(cache.text,
+                                     TIMESTAMP_BUFFER_SIZE,
+                                     "%s %2d %02d:%02d:%02d",
+                                     months[tm.tm_mon % 12],
+                                     tm.tm_mday,
+                                     tm.tm_hour,
+                                     tm.tm_min,
+                                     tm.tm_sec);
+        assert(n > 0);
+        cache.size = std::min(static_cast<std::size_t>(n),
+                              TIMESTAMP_BUFFER_SIZE - 1u);
+        cache.second = time.tv_sec;
+        cache.valid = true;
+    }
+    std::memcpy(buffer, cache.text, cache.size);
+    return cache.size;
+}
+
+std::size_t formatRfc5424TimeStamp(char * const buffer, ::timeval const & time)
+        noexcept
+{
+    // Only the part up to and including the decimal point is cached:
+    auto & cache = tl_rfc5424Cache;
+    if (!cache.valid || (cache.second != time.tv_sec)) {
+        std::tm tm;
+        SHAREMIND_DEBUG_ONLY(auto const r =) ::gmtime_r(&time.tv_sec, &tm);
+        assert(r);
+        auto const n = std::snprintf(cache.text,
+                                     TIMESTAMP_BUFFER_SIZE,
+                                     "%04d-%02d-%02dT%02d:%02d:%02d.",
+                                     tm.tm_year + 1900,
+                                     tm.tm_mon + 1,
+                                     tm.tm_mday,
+                                     tm.tm_hour,
+                                     tm.tm_min,
+                                     tm.tm_sec);
+        assert(n > 0);
+        cache.size = std::min(static_cast<std::size_t>(n),
+                              TIMESTAMP_BUFFER_SIZE - 8u);
+        cache.second = time.tv_sec;
+        cache.valid = true;
+    }
+    std::memcpy(buffer, cache.text, cache.size);
+    char * out = buffer + cache.size;
+    auto usec = static_cast<unsigned>(time.tv_usec % 1000000);
+    for (unsigned i = 6u; i--; usec /= 10u)
+        out[i] = static_cast<char>('0' + usec % 10u);
+    out[6u] = 'Z';
+    return cache.size + 7u;
+}
+
+/** Incremented in the child process after every fork(). */
+std::atomic<unsigned> forkGeneration{0u};
+
+void noteFork() noexcept
+{ forkGeneration.fetch_add(1u, std::memory_order_relaxed); }
+
+int syslogSeverity(Priority const priority) noexcept {
+    constexpr static int priorities[] =
+        { LOG_EMERG, LOG_ERR, LOG_WARNING, LOG_INFO, LOG_DEBUG, LOG_DEBUG };
+    return priorities[static_cast<unsigned>(priority)];
+}
+
+} // anonymous namespace
+
+struct SyslogSocketAppender::Batch {
+
+    struct Slot {
+        char timeStamp[TIMESTAMP_BUFFER_SIZE];
+        std::unique_ptr<char[]> message;
+        ::iovec iov[4u];
+    };
+
+    Batch(std::size_t const batchSize,
+          std::size_t const maxMessageSize_,
+          std::chrono::milliseconds const maxDelay_)
+        : maxMessageSize(maxMessageSize_)
+        , maxDelay(maxDelay_)
+        , slots(batchSize)
+        , headers(batchSize)
+    {
+        for (Slot & slot : slots)
+            slot.message.reset(new char[maxMessageSize]);
+    }
+
+    void renderHeaderSuffix() {
+        headerSuffix = sharemind::concat(headerBeforePid,
+                                         static_cast<long>(::getpid()),
+                                         headerAfterPid);
+    }
+
+    /**
+      \brief Drops the records queued by the parent process and renders the
+             new process ID, if the process has forked since the last call.
+    */
+    void checkFork() noexcept {
+        auto const generation = forkGeneration.load(std::memory_order_relaxed);
+        if (generation == rendered)
+            return;
+        pending = 0u;
+        try {
+            renderHeaderSuffix();
+        } catch (...) {}
+        rendered = generation;
+    }
+
+    /// Rendered "<PRI>" (RFC 3164) or "<PRI>1 " (RFC 5424) per priority.
+    std::string priorityPrefixes[6u];
+
+    /// Rendered " IDENT[PID]: " (RFC 3164) or " HOST IDENT PID - - " (RFC 5424).
+    std::string headerSuffix;
+    /// The parts of headerSuffix around the process ID.
+    std::string headerBeforePid;
+    char const * headerAfterPid;
+    /// The value of forkGeneration when headerSuffix was rendered.
+    unsigned rendered = forkGeneration.load(std::memory_order_relaxed);
+
+    std::size_t const maxMessageSize;
+    std::chrono::microseconds const maxDelay;
+    /// The time of the oldest queued record.
+    ::timeval oldest;
+    std::vector<Slot> slots;
+    #ifdef __linux__
+    std::vector<::mmsghdr> headers;
+    #else
+    std::vector<::msghdr> headers;
+    #endif
+    std::size_t pending = 0u;
+
+};
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    SyslogSocketAppender::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        SyslogSocketAppender::Exception,
+        SyslogSocketAppender::,
+        ConnectException);
+
+SyslogSocketAppender::SyslogSocketAppender(std::string const & ident,
+                                           int const facility,
+                                           std::string socketPath,
+                                           Format const format,
+                                           std::size_t const batchSize,
+                                           std::size_t const maxMessageSize,
+                                           std::chrono::milliseconds const
+                                                   maxDelay)
+    : m_socketPath(std::move(socketPath))
+    , m_format(format)
+    , m_batch(new Batch(std::max(batchSize, std::size_t(1u)),
+                        std::max(maxMessageSize, std::size_t(1u)),
+                        maxDelay))
+{
+    static int const registered =
+            ::pthread_atfork(nullptr, nullptr, &noteFork);
+    (void) registered;
+    for (unsigned p = 0u; p < 6u; ++p) {
+        auto const pri =
+                (facility & LOG_FACMASK)
+                | syslogSeverity(static_cast<Priority>(p));
+        m_batch->priorityPrefixes[p] =
+                (format == Format::Rfc3164)
+                ? sharemind::concat('<', pri, '>')
+                : sharemind::concat('<', pri, ">1 ");
+    }
+    if (format == Format::Rfc3164) {
+        m_batch->headerBeforePid = sharemind::concat(' ', ident, '[');
+        m_batch->headerAfterPid = "]: ";
+    } else {
+        char hostName[256u];
+        if (::gethostname(hostName, sizeof(hostName)) != 0)
+            std::strcpy(hostName, "-");
+        hostName[sizeof(hostName) - 1u] = '\0';
+        m_batch->headerBeforePid =
+                sharemind::concat(' ',
+                                  hostName,
+                                  ' ',
+                                  ident.empty() ? std::string("-") : ident,
+                                  ' ');
+        m_batch->headerAfterPid = " - - ";
+    }
+    m_batch->renderHeaderSuffix();
+
+    if (!reconnect())
+        throw ConnectException(
+                sharemind::concat("Failed to connect to syslog socket \"",
+                                  m_socketPath,
+                                  "\"!"));
+}
+
+SyslogSocketAppender::~SyslogSocketAppender() noexcept {
+    flush();
+    if (m_socket != -1)
+        ::close(m_socket);
+}
+
+bool SyslogSocketAppender::reconnect() noexcept {
+    if (m_socket != -1) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    ::sockaddr_un addr;
+    if (m_socketPath.size() >= sizeof(addr.sun_path))
+        return false;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, m_socketPath.c_str(), m_socketPath.size());
+
+    #ifdef SOCK_CLOEXEC
+    int const s = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    #else
+    int const s = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    #endif
+    if (s == -1)
+        return false;
+    if (::connect(s, reinterpret_cast<::sockaddr *>(&addr), sizeof(addr))
+        != 0)
+    {
+        ::close(s);
+        return false;
+    }
+    m_socket = s;
+    return true;
+}
+
+void SyslogSocketAppender::flush() noexcept {
+    Batch & batch = *m_batch;
+    batch.checkFork();
+    std::size_t sent = 0u;
+    bool reconnected = false;
+    while (sent < batch.pending) {
+        if (m_socket == -1) {
+            if (reconnected || !reconnect())
+                break;
+            reconnected = true;
+        }
+        #ifdef __linux__
+        auto const r = ::sendmmsg(m_socket,
+                                  &batch.headers[sent],
+                                  static_cast<unsigned>(batch.pending - sent),
+                                  0);
+        #else
+        auto const r = ::sendmsg(m_socket, &batch.headers[sent], 0) < 0
+                       ? -1
+                       : 1;
+        #endif
+        if (r > 0) {
+            sent += static_cast<std::size_t>(r);
+        } else if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            // The syslog daemon might have been restarted, so try once more:
+            if (!reconnected
+                && ((errno == ECONNREFUSED)
+                    || (errno == ENOTCONN)
+                    || (errno == ECONNRESET)
+                    || (errno == ENOENT)))
+            {
+                ::close(m_socket);
+                m_socket = -1;
+                continue;
+            }
+            break; // Drop the rest.
+        }
+    }
+    batch.pending = 0u;
+}
+
+void SyslogSocketAppender::doLog(::timeval time,
+                                 Priority const priority,
+                                 char const * message) noexcept
+{
+    Batch & batch = *m_batch;
+    batch.checkFork();
+    assert(batch.pending < batch.slots.size());
+    auto & slot = batch.slots[batch.pending];
+    auto const & prefix =
+            batch.priorityPrefixes[static_cast<unsigned>(priority)];
+    std::size_t const timeStampSize =
+            (m_format == Format::Rfc3164)
+            ? formatRfc3164TimeStamp(slot.timeStamp, time)
+            : formatRfc5424TimeStamp(slot.timeStamp, time);
+    auto const messageSize = std::min(std::strlen(message),
+                                      batch.maxMessageSize);
+    std::memcpy(slot.message.get(), message, messageSize);
+
+    slot.iov[0u].iov_base = const_cast<char *>(prefix.c_str());
+    slot.iov[0u].iov_len = prefix.size();
+    slot.iov[1u].iov_base = slot.timeStamp;
+    slot.iov[1u].iov_len = timeStampSize;
+    slot.iov[2u].iov_base = const_cast<char *>(batch.headerSuffix.c_str());
+    slot.iov[2u].iov_len = batch.headerSuffix.size();
+    slot.iov[3u].iov_base = slot.message.get();
+    slot.iov[3u].iov_len = messageSize;
+
+    #ifdef __linux__
+    ::msghdr & header = batch.headers[batch.pending].msg_hdr;
+    #else
+    ::msghdr & header = batch.headers[batch.pending];
+    #endif
+    std::memset(&header, 0, sizeof(header));
+    header.msg_iov = slot.iov;
+    header.msg_iovlen = 4u;
+
+    if (!batch.pending)
+        batch.oldest = time;
+    if ((++batch.pending == batch.slots.size())
+        || (priority <= Priority::Warning)
+        || (std::chrono::seconds(time.tv_sec - batch.oldest.tv_sec)
+            + std::chrono::microseconds(time.tv_usec - batch.oldest.tv_usec)
+            >= batch.maxDelay))
+        flush();
+}
+
+} /* namespace LogHard { */
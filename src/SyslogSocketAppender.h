@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_SYSLOGSOCKETAPPENDER_H
+#define LOGHARD_SYSLOGSOCKETAPPENDER_H
+
+#include "Appender.h"
+
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include "Exception.h"
+
+
+namespace LogHard {
+
+/**
+  \brief An appender which sends syslog frames directly to a unix socket.
+
+  Unlike SyslogAppender, this does not go through syslog(3), hence any number
+  of instances with different idents and facilities may be used at the same
+  time. The frame header for every priority is rendered once at construction.
+
+  If batchSize is greater than one, records below Priority::Warning are
+  queued until the batch is full and then sent with a single sendmmsg() call.
+  Records at Priority::Warning and above, flush() and destruction send the
+  queued records immediately, as does any record logged at least maxDelay
+  after the oldest queued record. There is no timer, hence callers must call
+  flush() themselves if queued records must not wait for further logging.
+
+  After fork(), the child process discards the records queued by the parent
+  and renders its own process ID into the frame headers.
+*/
+class SyslogSocketAppender: public Appender {
+
+public: /* Types: */
+
+    enum class Format { Rfc3164, Rfc5424 };
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         ConnectException);
+
+public: /* Methods: */
+
+    SyslogSocketAppender(std::string const & ident,
+                         int const facility,
+                         std::string socketPath = "/dev/log",
+                         Format const format = Format::Rfc3164,
+                         std::size_t const batchSize = 1u,
+                         std::size_t const maxMessageSize = 8192u,
+                         std::chrono::milliseconds const maxDelay =
+                                 std::chrono::seconds(1));
+
+    ~SyslogSocketAppender() noexcept override;
+
+    /** Sends all queued records. */
+    void flush() noexcept;
+
+private: /* Types: */
+
+    struct Batch;
+
+private: /* Methods: */
+
+    void doLog(::timeval time,
+               Priority const priority,
+               char const * message) noexcept override;
+
+    bool reconnect() noexcept;
+
+private: /* Fields: */
+
+    std::string const m_socketPath;
+    Format const m_format;
+    int m_socket = -1;
+    std::unique_ptr<Batch> m_batch;
+
+}; /* class SyslogSocketAppender { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_SYSLOGSOCKETAPPENDER_H */
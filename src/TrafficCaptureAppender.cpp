@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "TrafficCaptureAppender.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sharemind/Concat.h>
+#include <unistd.h>
+#include "Logger.h"
+
+
+namespace LogHard {
+
+namespace {
+
+std::atomic<std::uint64_t> nextThreadId{1u};
+thread_local std::uint64_t tl_threadId = 0u;
+
+std::uint64_t threadId() noexcept {
+    if (!tl_threadId)
+        tl_threadId = nextThreadId.fetch_add(1u, std::memory_order_relaxed);
+    return tl_threadId;
+}
+
+std::uint64_t hashPrefix(char const * const prefix, std::size_t const size)
+        noexcept
+{
+    // FNV-1a:
+    std::uint64_t hash = 0xcbf29ce484222325u;
+    for (std::size_t i = 0u; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(prefix[i]);
+        hash *= 0x100000001b3u;
+    }
+    return hash;
+}
+
+} // anonymous namespace
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    TrafficCaptureAppender::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        TrafficCaptureAppender::Exception,
+        TrafficCaptureAppender::,
+        FileOpenException);
+
+constexpr char const * TrafficCaptureAppender::FORMAT;
+constexpr std::size_t TrafficCaptureAppender::BUFFER_SIZE;
+constexpr std::size_t TrafficCaptureAppender::MAX_LINE_SIZE;
+
+TrafficCaptureAppender::TrafficCaptureAppender(std::string const & path,
+                                               ::mode_t const flags)
+    : TrafficCaptureAppender(path.c_str(), flags)
+{}
+
+TrafficCaptureAppender::TrafficCaptureAppender(char const * const path,
+                                               ::mode_t const flags)
+    : m_fd(::open(path,
+                  O_WRONLY | O_CREAT | O_TRUNC | O_NOCTTY | O_CLOEXEC,
+                  flags))
+    , m_buffer(new char[BUFFER_SIZE])
+{
+    try {
+        if (m_fd == -1)
+            throw sharemind::ErrnoException(errno);
+    } catch (...) {
+        std::throw_with_nested(
+                    FileOpenException(
+                        sharemind::concat(
+                            "Failed to open file \"",
+                            path,
+                            "\" for capturing traffic!")));
+    }
+    appendLocked(FORMAT, std::strlen(FORMAT));
+    appendLocked("\n", 1u);
+}
+
+TrafficCaptureAppender::~TrafficCaptureAppender() noexcept {
+    flush();
+    ::close(m_fd);
+}
+
+void TrafficCaptureAppender::flush() noexcept {
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    flushLocked();
+}
+
+void TrafficCaptureAppender::doLog(::timeval time,
+                                   Priority const priority,
+                                   char const * message) noexcept
+{
+    std::size_t prefixSize = 0u;
+    auto const * const recordInfo = Logger::currentRecordInfo();
+    if (recordInfo && (recordInfo->prefix == message))
+        prefixSize = recordInfo->prefixSize;
+    auto const size = std::strlen(message);
+    auto const now = static_cast<std::uint64_t>(time.tv_sec) * 1000000u
+                     + static_cast<std::uint64_t>(time.tv_usec);
+    auto const thread = threadId();
+
+    std::lock_guard<std::mutex> const guard(m_mutex);
+    std::uint64_t delta = 0u;
+    if (!m_started) {
+        m_started = true;
+        m_lastTime = now;
+    } else if (now > m_lastTime) {
+        delta = now - m_lastTime;
+        m_lastTime = now;
+    }
+    auto const prefixId = prefixSize ? prefixIdLocked(message, prefixSize) : 0u;
+    char line[MAX_LINE_SIZE];
+    auto const r = std::snprintf(line,
+                                 sizeof(line),
+                                 "r %llu %u %zu %zu %llu\n",
+                                 static_cast<unsigned long long>(delta),
+                                 static_cast<unsigned>(priority),
+                                 prefixId,
+                                 size,
+                                 static_cast<unsigned long long>(thread));
+    if (r > 0)
+        appendLocked(line, static_cast<std::size_t>(r));
+}
+
+std::size_t TrafficCaptureAppender::prefixIdLocked(
+        char const * const prefix,
+        std::size_t const prefixSize) noexcept
+{
+    auto const hash = hashPrefix(prefix, prefixSize);
+    auto const range = m_prefixIds.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto const & known = m_prefixes[it->second - 1u];
+        if ((known.size() == prefixSize)
+            && (std::memcmp(known.data(), prefix, prefixSize) == 0))
+            return it->second;
+    }
+
+    // New prefixes are rare, so allocating here is acceptable:
+    std::size_t id;
+    try {
+        m_prefixes.emplace_back(prefix, prefixSize);
+        id = m_prefixes.size();
+        try {
+            m_prefixIds.emplace(hash, id);
+        } catch (...) {
+            m_prefixes.pop_back();
+            throw;
+        }
+    } catch (...) {
+        return 0u;
+    }
+    char line[MAX_LINE_SIZE];
+    auto const r = std::snprintf(line, sizeof(line), "p %zu %zu\n",
+                                 id, prefixSize);
+    if (r > 0)
+        appendLocked(line, static_cast<std::size_t>(r));
+    return id;
+}
+
+void TrafficCaptureAppender::appendLocked(char const * const line,
+                                          std::size_t const size) noexcept
+{
+    if (m_bufferSize + size > BUFFER_SIZE)
+        flushLocked();
+    std::memcpy(m_buffer.get() + m_bufferSize, line, size);
+    m_bufferSize += size;
+}
+
+void TrafficCaptureAppender::flushLocked() noexcept {
+    char const * data = m_buffer.get();
+    std::size_t left = m_bufferSize;
+    while (left) {
+        auto const r = ::write(m_fd, data, left);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            break; // Drop the rest of the buffer.
+        }
+        data += r;
+        left -= static_cast<std::size_t>(r);
+    }
+    m_bufferSize = 0u;
+}
+
+} /* namespace LogHard { */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_TRAFFICCAPTUREAPPENDER_H
+#define LOGHARD_TRAFFICCAPTUREAPPENDER_H
+
+#include "Appender.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unordered_map>
+#include <vector>
+#include "Exception.h"
+
+
+namespace LogHard {
+
+/**
+  \brief An appender which records only the shape of the traffic, for
+         replaying it later with TrafficReplay.
+
+  The contents of the messages are not recorded. The capture is a text file
+  which starts with a FORMAT line, followed by lines of the forms
+
+      p <prefix id> <prefix length>
+      r <delta> <priority> <prefix id> <message length> <thread id>
+
+  where delta is the number of microseconds since the previous record (never
+  negative, even if records arrive out of order), priority is the numeric
+  value of the Priority, and the message length includes the prefix. Every
+  prefix of a Logger gets an id when first seen, the id 0 denoting records
+  without a prefix. Threads are numbered in the order in which they first log
+  to any TrafficCaptureAppender.
+*/
+class TrafficCaptureAppender: public Appender {
+
+public: /* Constants: */
+
+    constexpr static char const * FORMAT = "LogHard traffic capture 1";
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         FileOpenException);
+
+public: /* Methods: */
+
+    TrafficCaptureAppender(std::string const & path,
+                           ::mode_t const flags = 0644);
+
+    TrafficCaptureAppender(char const * const path,
+                           ::mode_t const flags = 0644);
+
+    ~TrafficCaptureAppender() noexcept override;
+
+    /** \brief Writes the buffered part of the capture to the file. */
+    void flush() noexcept;
+
+private: /* Constants: */
+
+    constexpr static std::size_t BUFFER_SIZE = 64u * 1024u;
+
+    /** Room for the longest line of the capture. */
+    constexpr static std::size_t MAX_LINE_SIZE = 128u;
+
+private: /* Methods: */
+
+    void doLog(::timeval time,
+               Priority const priority,
+               char const * message) noexcept override;
+
+    std::size_t prefixIdLocked(char const * const prefix,
+                               std::size_t const prefixSize) noexcept;
+
+    void appendLocked(char const * const line, std::size_t const size)
+            noexcept;
+
+    void flushLocked() noexcept;
+
+private: /* Fields: */
+
+    int const m_fd;
+
+    std::mutex m_mutex;
+    std::unique_ptr<char[]> const m_buffer;
+    std::size_t m_bufferSize = 0u;
+    bool m_started = false;
+    std::uint64_t m_lastTime = 0u;
+
+    /** Prefix ids by the hash of the prefix. */
+    std::unordered_multimap<std::uint64_t, std::size_t> m_prefixIds;
+    std::vector<std::string> m_prefixes;
+
+}; /* class TrafficCaptureAppender */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_TRAFFICCAPTUREAPPENDER_H */
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "TrafficReplay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <sharemind/Concat.h>
+#include <sstream>
+#include <thread>
+#include "Backend.h"
+#include "Logger.h"
+#include "TrafficCaptureAppender.h"
+
+
+namespace LogHard {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::uint64_t nanoseconds(Clock::duration const d) noexcept {
+    auto const r = std::chrono::duration_cast<std::chrono::nanoseconds>(d);
+    return (r.count() > 0) ? static_cast<std::uint64_t>(r.count()) : 0u;
+}
+
+} // anonymous namespace
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    TrafficReplay::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        TrafficReplay::Exception,
+        TrafficReplay::,
+        FileOpenException);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        TrafficReplay::Exception,
+        TrafficReplay::,
+        ParseException);
+
+TrafficReplay::TrafficReplay(std::string const & path)
+    : TrafficReplay(path.c_str())
+{}
+
+TrafficReplay::TrafficReplay(char const * const path)
+    : m_prefixSizes(1u, 0u)
+{
+    std::ifstream in(path);
+    if (!in)
+        throw FileOpenException(
+                sharemind::concat("Failed to open traffic capture \"",
+                                  path,
+                                  "\"!"));
+    auto const fail = [path](std::size_t const lineNumber,
+                             char const * const reason)
+    {
+        throw ParseException(
+                sharemind::concat("Invalid traffic capture \"", path,
+                                  "\" on line ", lineNumber, ": ", reason));
+    };
+
+    std::string line;
+    if (!std::getline(in, line) || (line != TrafficCaptureAppender::FORMAT))
+        fail(1u, "unknown format");
+
+    std::map<std::uint64_t, std::size_t> threads;
+    std::uint64_t time = 0u;
+    for (std::size_t lineNumber = 2u; std::getline(in, line); ++lineNumber) {
+        if (line.empty())
+            continue;
+        std::istringstream fields(line);
+        char type;
+        fields >> type;
+        if (type == 'p') {
+            std::size_t id;
+            std::size_t size;
+            if (!(fields >> id >> size) || !size)
+                fail(lineNumber, "invalid prefix");
+            if (id != m_prefixSizes.size())
+                fail(lineNumber, "unexpected prefix id");
+            m_prefixSizes.emplace_back(size);
+        } else if (type == 'r') {
+            std::uint64_t delta;
+            unsigned priority;
+            Record record;
+            std::uint64_t thread;
+            if (!(fields >> delta >> priority >> record.prefixId >> record.size
+                         >> thread))
+                fail(lineNumber, "invalid record");
+            if (priority > static_cast<unsigned>(Priority::FullDebug))
+                fail(lineNumber, "invalid priority");
+            if (record.prefixId >= m_prefixSizes.size())
+                fail(lineNumber, "undefined prefix id");
+            time += delta;
+            record.time = time;
+            record.priority = static_cast<Priority>(priority);
+            record.thread =
+                    threads.emplace(thread, threads.size()).first->second;
+            m_records.emplace_back(std::move(record));
+        } else {
+            fail(lineNumber, "unknown line type");
+        }
+    }
+    m_threads = threads.size();
+}
+
+TrafficReplay::Result TrafficReplay::replay(
+        std::shared_ptr<Backend> const & backend,
+        double const speed) const
+{
+    std::vector<std::unique_ptr<Logger> > loggers;
+    loggers.emplace_back(new Logger(backend));
+    std::size_t maxBodySize = 0u;
+    for (std::size_t id = 1u; id < m_prefixSizes.size(); ++id) {
+        // Logger appends a space to the component:
+        auto const size = m_prefixSizes[id] - 1u;
+        auto component(sharemind::concat("[Prefix", id, ']'));
+        if (component.size() < size) {
+            component.insert(component.size() - 1u,
+                             size - component.size(),
+                             '_');
+        } else {
+            component.resize(size);
+        }
+        loggers.emplace_back(new Logger(backend, std::move(component)));
+    }
+    std::vector<std::vector<Record const *> > schedules(m_threads);
+    for (auto const & record : m_records) {
+        schedules[record.thread].emplace_back(&record);
+        maxBodySize = std::max(maxBodySize, record.size);
+    }
+    std::string const filler(maxBodySize, 'x');
+
+    std::unique_ptr<Histogram> const lag(new Histogram());
+    std::unique_ptr<Histogram> const latency(new Histogram());
+    std::atomic<bool> go{false};
+    std::atomic<bool> cancel{false};
+    Clock::time_point start;
+    auto const replayThread = [&](std::vector<Record const *> const & records)
+    {
+        while (!go.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        if (cancel.load(std::memory_order_relaxed))
+            return;
+        for (auto const * const record : records) {
+            auto scheduled = start;
+            if (speed > 0.0) {
+                scheduled += std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::duration<double, std::micro>(
+                                static_cast<double>(record->time) / speed));
+                std::this_thread::sleep_until(scheduled);
+            }
+            auto const before(Clock::now());
+            auto const prefixSize = m_prefixSizes[record->prefixId];
+            auto const bodySize = (record->size > prefixSize)
+                                  ? record->size - prefixSize
+                                  : 0u;
+            Logger::MessageBuilder(record->priority,
+                                   *loggers[record->prefixId])
+                    << (filler.c_str() + (filler.size() - bodySize));
+            auto const after(Clock::now());
+            if (speed > 0.0)
+                lag->record(nanoseconds(before - scheduled));
+            latency->record(nanoseconds(after - before));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(schedules.size());
+    try {
+        for (auto const & schedule : schedules)
+            threads.emplace_back(replayThread, std::cref(schedule));
+    } catch (...) {
+        cancel.store(true, std::memory_order_relaxed);
+        go.store(true, std::memory_order_release);
+        for (auto & thread : threads)
+            thread.join();
+        throw;
+    }
+    start = Clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto & thread : threads)
+        thread.join();
+    auto const elapsed(Clock::now() - start);
+    return Result{
+        m_records.size(),
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed),
+        lag->snapshot(),
+        latency->snapshot()};
+}
+
+} /* namespace LogHard { */
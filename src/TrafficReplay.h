@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_TRAFFICREPLAY_H
+#define LOGHARD_TRAFFICREPLAY_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <vector>
+#include "Exception.h"
+#include "Priority.h"
+#include "Statistics.h"
+
+
+namespace LogHard {
+
+class Backend;
+
+/**
+  \brief Replays the traffic recorded by a TrafficCaptureAppender.
+
+  Every captured thread is replayed by its own thread, which logs records of
+  the captured priorities and sizes through Loggers with prefixes of the
+  captured sizes, at the captured times scaled by the given speed.
+*/
+class TrafficReplay {
+
+public: /* Types: */
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         FileOpenException);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         ParseException);
+
+    struct Record {
+
+        /** Microseconds since the first record. */
+        std::uint64_t time;
+
+        Priority priority;
+
+        /** Index into prefixSizes(). */
+        std::size_t prefixId;
+
+        /** The size of the message, including the prefix. */
+        std::size_t size;
+
+        /** The replay thread, less than threads(). */
+        std::size_t thread;
+
+    };
+
+    struct Result {
+
+        std::size_t records;
+        std::chrono::nanoseconds elapsed;
+
+        /** How late the records were logged compared to the schedule. */
+        Histogram::Snapshot lag;
+
+        /** The time spent in logging the records. */
+        Histogram::Snapshot latency;
+
+    };
+
+public: /* Methods: */
+
+    explicit TrafficReplay(std::string const & path);
+    explicit TrafficReplay(char const * const path);
+
+    std::vector<Record> const & records() const noexcept { return m_records; }
+
+    /** \returns the prefix sizes by prefix id, 0 for the id 0. */
+    std::vector<std::size_t> const & prefixSizes() const noexcept
+    { return m_prefixSizes; }
+
+    std::size_t threads() const noexcept { return m_threads; }
+
+    /**
+      \brief Replays the traffic to the given Backend.
+      \param[in] speed The speed relative to the capture, or 0.0 for logging
+                       all records as fast as possible.
+    */
+    Result replay(std::shared_ptr<Backend> const & backend,
+                  double const speed = 1.0) const;
+
+private: /* Fields: */
+
+    std::vector<Record> m_records;
+    std::vector<std::size_t> m_prefixSizes;
+    std::size_t m_threads = 0u;
+
+}; /* class TrafficReplay { */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_TRAFFICREPLAY_H */
@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "UringFileAppender.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sched.h>
+#include <sharemind/Concat.h>
+#include <unistd.h>
+#include <vector>
+#include "CFileAppender.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define LOGHARD_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+
+namespace LogHard {
+
+namespace {
+
+void writeAll(int const fd, char const * data, std::size_t size) noexcept {
+    while (size) {
+        auto const r = ::write(fd, data, size);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += r;
+        size -= static_cast<std::size_t>(r);
+    }
+}
+
+void syncFile(int const fd, UringFileAppender::SyncMode const syncMode)
+        noexcept
+{
+    if (syncMode == UringFileAppender::FSYNC) {
+        ::fsync(fd);
+    } else if (syncMode == UringFileAppender::FDATASYNC) {
+        #ifdef __APPLE__
+        ::fsync(fd);
+        #else
+        ::fdatasync(fd);
+        #endif
+    }
+}
+
+} // anonymous namespace
+
+#ifdef LOGHARD_HAVE_IO_URING
+
+struct UringFileAppender::Ring {
+
+    enum : std::uint64_t { WRITE_TAG = 1u, SYNC_TAG = 2u };
+
+    struct Batch {
+        std::vector<char> data;
+        std::size_t size = 0u;
+        ::iovec iov;
+    };
+
+    Ring(int const fd, SyncMode const syncMode, std::size_t const batchSize)
+        : m_fd(fd)
+        , m_syncMode(syncMode)
+    {
+        for (Batch & batch : m_batches)
+            batch.data.resize(batchSize);
+    }
+
+    ~Ring() noexcept {
+        if (m_sqesPtr != MAP_FAILED)
+            ::munmap(m_sqesPtr, m_sqesSize);
+        if ((m_cqPtr != MAP_FAILED) && (m_cqPtr != m_sqPtr))
+            ::munmap(m_cqPtr, m_cqSize);
+        if (m_sqPtr != MAP_FAILED)
+            ::munmap(m_sqPtr, m_sqSize);
+        if (m_ringFd != -1)
+            ::close(m_ringFd);
+    }
+
+    bool init() noexcept {
+        ::io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        m_ringFd = static_cast<int>(::syscall(__NR_io_uring_setup,
+                                              4u,
+                                              &params));
+        if (m_ringFd < 0) {
+            m_ringFd = -1;
+            return false;
+        }
+        m_sqSize = params.sq_off.array
+                   + params.sq_entries * sizeof(unsigned);
+        m_cqSize = params.cq_off.cqes
+                   + params.cq_entries * sizeof(::io_uring_cqe);
+        bool const singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMmap && (m_cqSize > m_sqSize))
+            m_sqSize = m_cqSize;
+        m_sqPtr = ::mmap(nullptr,
+                         m_sqSize,
+                         PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE,
+                         m_ringFd,
+                         IORING_OFF_SQ_RING);
+        if (m_sqPtr == MAP_FAILED)
+            return false;
+        if (singleMmap) {
+            m_cqPtr = m_sqPtr;
+        } else {
+            m_cqPtr = ::mmap(nullptr,
+                             m_cqSize,
+                             PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_POPULATE,
+                             m_ringFd,
+                             IORING_OFF_CQ_RING);
+            if (m_cqPtr == MAP_FAILED)
+                return false;
+        }
+        m_sqesSize = params.sq_entries * sizeof(::io_uring_sqe);
+        m_sqesPtr = ::mmap(nullptr,
+                           m_sqesSize,
+                           PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE,
+                           m_ringFd,
+                           IORING_OFF_SQES);
+        if (m_sqesPtr == MAP_FAILED)
+            return false;
+
+        char * const sq = static_cast<char *>(m_sqPtr);
+        m_sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        m_sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        m_sqes = static_cast<::io_uring_sqe *>(m_sqesPtr);
+        char * const cq = static_cast<char *>(m_cqPtr);
+        m_cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        m_cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<::io_uring_cqe *>(cq + params.cq_off.cqes);
+        m_appendOffset = (params.features & IORING_FEAT_RW_CUR_POS)
+                         ? static_cast<std::uint64_t>(-1)
+                         : 0u;
+        return true;
+    }
+
+    Batch & filling() noexcept { return m_batches[m_filling]; }
+    Batch & inFlight() noexcept { return m_batches[m_filling ^ 1u]; }
+
+    void prepareSqe(unsigned const index,
+                    std::uint8_t const opcode,
+                    std::uint64_t const userData) noexcept
+    {
+        ::io_uring_sqe & sqe = m_sqes[index & m_sqMask];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = opcode;
+        sqe.fd = m_fd;
+        sqe.user_data = userData;
+        m_sqArray[index & m_sqMask] = index & m_sqMask;
+    }
+
+    /** Submits the filling batch and makes it the in-flight batch. */
+    void submit() noexcept {
+        assert(!m_pending);
+        Batch & batch = filling();
+        assert(batch.size);
+        batch.iov.iov_base = batch.data.data();
+        batch.iov.iov_len = batch.size;
+
+        unsigned const tail = *m_sqTail;
+        prepareSqe(tail, IORING_OP_WRITEV, WRITE_TAG);
+        ::io_uring_sqe & writeSqe = m_sqes[tail & m_sqMask];
+        writeSqe.addr = reinterpret_cast<std::uintptr_t>(&batch.iov);
+        writeSqe.len = 1u;
+        writeSqe.off = m_appendOffset;
+        unsigned toSubmit = 1u;
+        if (m_syncMode != NO_SYNC) {
+            writeSqe.flags = IOSQE_IO_LINK;
+            prepareSqe(tail + 1u, IORING_OP_FSYNC, SYNC_TAG);
+            if (m_syncMode == FDATASYNC)
+                m_sqes[(tail + 1u) & m_sqMask].fsync_flags =
+                        IORING_FSYNC_DATASYNC;
+            toSubmit = 2u;
+        }
+        __atomic_store_n(m_sqTail, tail + toSubmit, __ATOMIC_RELEASE);
+
+        long r;
+        do {
+            r = ::syscall(__NR_io_uring_enter, m_ringFd, toSubmit, 0u, 0u,
+                          nullptr, 0u);
+        } while ((r < 0) && (errno == EINTR));
+        if (r <= 0) {
+            /* The kernel did not consume our entries, so take them back and
+               complete the batch via the synchronous path instead: */
+            __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+            writeAll(m_fd, batch.data.data(), batch.size);
+            syncFile(m_fd, m_syncMode);
+            batch.size = 0u;
+            return;
+        }
+        m_unsubmitted = toSubmit - static_cast<unsigned>(r);
+        m_pending = toSubmit;
+        m_filling ^= 1u;
+    }
+
+    /**
+      Processes available completions, optionally waiting for all. If waiting
+      fails for good, the in-flight batch is given up on and m_failed is set.
+    */
+    void reap(bool const wait) noexcept {
+        unsigned retries = 0u;
+        while (m_pending) {
+            unsigned head = *m_cqHead;
+            unsigned const tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+            if (head == tail) {
+                if (!wait)
+                    return;
+                auto const r = ::syscall(__NR_io_uring_enter,
+                                         m_ringFd,
+                                         m_unsubmitted,
+                                         1u,
+                                         IORING_ENTER_GETEVENTS,
+                                         nullptr,
+                                         0u);
+                if (r >= 0) {
+                    m_unsubmitted -= static_cast<unsigned>(r);
+                } else if (errno != EINTR) {
+                    // Only retry on transient shortages of resources:
+                    if (((errno != EAGAIN) && (errno != EBUSY))
+                        || (++retries >= 1000u))
+                    {
+                        m_failed = true;
+                        m_pending = 0u;
+                        inFlight().size = 0u;
+                        return;
+                    }
+                    ::sched_yield();
+                }
+                continue;
+            }
+            for (; head != tail; ++head)
+                complete(m_cqes[head & m_cqMask]);
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        }
+    }
+
+    void complete(::io_uring_cqe const & cqe) noexcept {
+        assert(m_pending);
+        Batch & batch = inFlight();
+        if (cqe.user_data == WRITE_TAG) {
+            std::size_t const written =
+                    (cqe.res > 0) ? static_cast<std::size_t>(cqe.res) : 0u;
+            if (written < batch.size) {
+                /* Short or failed write, which also cancels the linked sync.
+                   Write the rest synchronously: */
+                writeAll(m_fd, batch.data.data() + written,
+                         batch.size - written);
+                syncFile(m_fd, m_syncMode);
+            }
+        }
+        if (!--m_pending)
+            batch.size = 0u;
+    }
+
+    int const m_fd;
+    SyncMode const m_syncMode;
+    int m_ringFd = -1;
+    void * m_sqPtr = MAP_FAILED;
+    std::size_t m_sqSize = 0u;
+    void * m_cqPtr = MAP_FAILED;
+    std::size_t m_cqSize = 0u;
+    void * m_sqesPtr = MAP_FAILED;
+    std::size_t m_sqesSize = 0u;
+    unsigned * m_sqTail = nullptr;
+    unsigned m_sqMask = 0u;
+    unsigned * m_sqArray = nullptr;
+    ::io_uring_sqe * m_sqes = nullptr;
+    unsigned * m_cqHead = nullptr;
+    unsigned * m_cqTail = nullptr;
+    unsigned m_cqMask = 0u;
+    ::io_uring_cqe * m_cqes = nullptr;
+    std::uint64_t m_appendOffset = 0u;
+    Batch m_batches[2u];
+    unsigned m_filling = 0u;
+    unsigned m_pending = 0u;
+    unsigned m_unsubmitted = 0u;
+    bool m_failed = false;
+
+};
+
+#else
+
+struct UringFileAppender::Ring {
+
+    struct Batch {
+        std::vector<char> data;
+        std::size_t size = 0u;
+    };
+
+    Ring(int, SyncMode, std::size_t) noexcept {}
+
+    bool init() noexcept { return false; }
+
+    Batch & filling() noexcept { return m_batch; }
+    void submit() noexcept {}
+    void reap(bool) noexcept {}
+
+    Batch m_batch;
+    unsigned m_pending = 0u;
+    bool m_failed = false;
+
+};
+
+#endif
+
+SHAREMIND_DEFINE_EXCEPTION_NOINLINE(LogHard::Exception,
+                                    UringFileAppender::,
+                                    Exception);
+SHAREMIND_DEFINE_EXCEPTION_CONST_STDSTRING_NOINLINE(
+        UringFileAppender::Exception,
+        UringFileAppender::,
+        FileOpenException);
+
+UringFileAppender::UringFileAppender(std::string const & path,
+                                     FileAppender::OpenMode const openMode,
+                                     SyncMode const syncMode,
+                                     std::size_t const batchSize,
+                                     ::mode_t const flags)
+    : UringFileAppender(path.c_str(), openMode, syncMode, batchSize, flags)
+{}
+
+UringFileAppender::UringFileAppender(char const * const path,
+                                     FileAppender::OpenMode const openMode,
+                                     SyncMode const syncMode,
+                                     std::size_t const batchSize,
+                                     ::mode_t const flags)
+    : m_fd(::open(path,
+                  O_WRONLY | O_CREAT | O_APPEND | O_NOCTTY
+                  | ((openMode == FileAppender::OVERWRITE) ? O_TRUNC : 0u),
+                  flags))
+    , m_syncMode(syncMode)
+{
+    try {
+        if (m_fd == -1)
+            throw sharemind::ErrnoException(errno);
+    } catch (...) {
+        std::throw_with_nested(
+                    UringFileAppender::FileOpenException(
+                        sharemind::concat(
+                            "Failed to open file \"",
+                            path,
+                            "\" for logging!")));
+    }
+    try {
+        m_ring.reset(new Ring(m_fd, syncMode, batchSize));
+        if (!m_ring->init())
+            m_ring.reset();
+    } catch (...) {
+        ::close(m_fd);
+        throw;
+    }
+}
+
+UringFileAppender::~UringFileAppender() noexcept {
+    flush();
+    m_ring.reset();
+    ::close(m_fd);
+}
+
+void UringFileAppender::flush() noexcept {
+    if (!m_ring || !reap(true))
+        return;
+    if (m_ring->filling().size) {
+        m_ring->submit();
+        reap(true);
+    }
+}
+
+bool UringFileAppender::reap(bool const wait) noexcept {
+    m_ring->reap(wait);
+    if (!m_ring->m_failed)
+        return true;
+    // Write the buffered records synchronously and stop using io_uring:
+    auto const & batch = m_ring->filling();
+    if (batch.size) {
+        writeAll(m_fd, batch.data.data(), batch.size);
+        syncFile(m_fd, m_syncMode);
+    }
+    m_ring.reset();
+    return false;
+}
+
+void UringFileAppender::logSynchronously(::timeval time,
+                                         Priority const priority,
+                                         char const * message) noexcept
+{
+    CFileAppender::logToFile(m_fd, time, priority, message);
+    syncFile(m_fd, m_syncMode);
+}
+
+void UringFileAppender::doLog(::timeval time,
+                              Priority const priority,
+                              char const * message) noexcept
+{
+    if (!m_ring || !reap(false))
+        return logSynchronously(time, priority, message);
+
+    CFileAppender::FormattedLine const line(time, priority, message);
+    std::size_t const recordSize = line.size();
+    if (m_ring->filling().size + recordSize > m_ring->filling().data.size()) {
+        if (m_ring->filling().size) {
+            if (!reap(true))
+                return logSynchronously(time, priority, message);
+            m_ring->submit();
+        }
+        if (recordSize > m_ring->filling().data.size()) {
+            // Too large to ever fit into a batch, must keep ordering:
+            reap(true);
+            return logSynchronously(time, priority, message);
+        }
+    }
+
+    auto & batch = m_ring->filling();
+    line.copyTo(batch.data.data() + batch.size);
+    batch.size += recordSize;
+
+    if (!m_ring->m_pending)
+        m_ring->submit();
+}
+
+} /* namespace LogHard { */
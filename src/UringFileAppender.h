@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_URINGFILEAPPENDER_H
+#define LOGHARD_URINGFILEAPPENDER_H
+
+#include "Appender.h"
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <sharemind/ExceptionMacros.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "Exception.h"
+#include "FileAppender.h"
+
+
+namespace LogHard {
+
+/**
+  \brief A file appender which hands writes and syncs over to io_uring.
+
+  Records are formatted into one of two batch buffers. While a batch is being
+  written (and optionally synced by a linked FSYNC operation) by the kernel,
+  new records are buffered into the other batch, which is submitted as soon as
+  the previous one completes. Completions are reaped on subsequent log calls,
+  so no helper thread is needed. If io_uring is not available at runtime, or
+  waiting for completions fails for good, the appender falls back to
+  synchronous CFileAppender::logToFile() calls. In the latter case the batch
+  in flight is lost.
+*/
+class UringFileAppender: public Appender {
+
+public: /* Types: */
+
+    enum SyncMode { NO_SYNC, FSYNC, FDATASYNC };
+
+    SHAREMIND_DECLARE_EXCEPTION_NOINLINE(LogHard::Exception, Exception);
+    SHAREMIND_DECLARE_EXCEPTION_CONST_STDSTRING_NOINLINE(Exception,
+                                                         FileOpenException);
+
+public: /* Methods: */
+
+    UringFileAppender(std::string const & path,
+                      FileAppender::OpenMode const openMode,
+                      SyncMode const syncMode = FDATASYNC,
+                      std::size_t const batchSize = 64u * 1024u,
+                      ::mode_t const flags = 0644);
+
+    UringFileAppender(char const * const path,
+                      FileAppender::OpenMode const openMode,
+                      SyncMode const syncMode = FDATASYNC,
+                      std::size_t const batchSize = 64u * 1024u,
+                      ::mode_t const flags = 0644);
+
+    ~UringFileAppender() noexcept override;
+
+    bool usesUring() const noexcept { return static_cast<bool>(m_ring); }
+
+    /** Submits all buffered records and waits for their completion. */
+    void flush() noexcept;
+
+private: /* Types: */
+
+    struct Ring;
+
+private: /* Methods: */
+
+    /**
+      \brief Reaps completions of the ring, dropping the ring on failure.
+      \returns whether the ring is still in use.
+    */
+    bool reap(bool const wait) noexcept;
+
+    void doLog(::timeval time,
+               Priority const priority,
+               char const * message) noexcept override;
+
+    void logSynchronously(::timeval time,
+                          Priority const priority,
+                          char const * message) noexcept;
+
+private: /* Fields: */
+
+    int const m_fd;
+    SyncMode const m_syncMode;
+    std::unique_ptr<Ring> m_ring;
+
+}; /* class UringFileAppender */
+
+} /* namespace LogHard { */
+
+#endif /* LOGHARD_URINGFILEAPPENDER_H */
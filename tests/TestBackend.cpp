@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/Backend.h"
+
+#include <chrono>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../src/Logger.h"
+#include "TestUtils.h"
+
+
+using LogHard::Priority;
+using LogHardTest::CollectingAppender;
+
+int main() {
+    auto const backend(std::make_shared<LogHard::Backend>());
+    auto const appender(std::make_shared<CollectingAppender>());
+    backend->addAppender(appender);
+    backend->setDuplicateWindow(std::chrono::seconds(1));
+    LogHard::Logger const logger(backend);
+    auto & messages = appender->messages;
+
+    ::timeval time{1000, 0};
+    for (unsigned i = 0u; i < 5u; ++i)
+        logger.error(time) << "same";
+    logger.warning(time) << "same";
+    SHAREMIND_TESTASSERT(messages.size() == 3u);
+    SHAREMIND_TESTASSERT(messages[0u] == "same");
+    SHAREMIND_TESTASSERT(messages[1u] == "Last message repeated 4 times.");
+    SHAREMIND_TESTASSERT(messages[2u] == "same");
+
+    // Repeats after the window are logged again:
+    logger.warning(time) << "same";
+    time.tv_sec += 2;
+    logger.warning(time) << "same";
+    SHAREMIND_TESTASSERT(messages.size() == 5u);
+    SHAREMIND_TESTASSERT(messages[3u] == "Last message repeated 1 times.");
+    SHAREMIND_TESTASSERT(messages[4u] == "same");
+
+    logger.warning(time) << "same";
+    backend->flushDuplicates();
+    SHAREMIND_TESTASSERT(messages.size() == 6u);
+
+    backend->setDuplicateWindow(std::chrono::microseconds::zero());
+    logger.warning(time) << "same";
+    logger.warning(time) << "same";
+    SHAREMIND_TESTASSERT(messages.size() == 8u);
+
+    // Overload protection:
+    using Clock = std::chrono::steady_clock;
+    LogHard::Backend::OverloadPolicy policy;
+    policy.maxBytesPerSecond = 10000u;
+    policy.interval = std::chrono::milliseconds(10);
+    policy.recoveryIntervals = 2u;
+    backend->setPriority(Priority::FullDebug);
+    backend->setOverloadPolicy(policy);
+    std::string const line(100u, 'x');
+    auto deadline = Clock::now() + std::chrono::seconds(5);
+    while (backend->overloadStatus().priority != Priority::Normal
+           && Clock::now() < deadline)
+        logger.debug() << line;
+    SHAREMIND_TESTASSERT(backend->overloadStatus().priority
+                         == Priority::Normal);
+    SHAREMIND_TESTASSERT(!logger.enabled(Priority::Debug));
+    SHAREMIND_TESTASSERT(logger.enabled(Priority::Normal));
+    SHAREMIND_TESTASSERT(messages.back().find("Overload protection") == 0u);
+
+    deadline = Clock::now() + std::chrono::seconds(5);
+    while (backend->overloadStatus().priority != Priority::FullDebug
+           && Clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        logger.warning() << "calm";
+    }
+    SHAREMIND_TESTASSERT(logger.enabled(Priority::FullDebug));
+
+    backend->setOverloadPriority(Priority::Error);
+    SHAREMIND_TESTASSERT(!logger.enabled(Priority::Warning));
+    backend->setOverloadPolicy(LogHard::Backend::OverloadPolicy());
+    SHAREMIND_TESTASSERT(logger.enabled(Priority::FullDebug));
+
+    // Verbosity elevation of the current thread:
+    backend->setPriority(Priority::Normal);
+    appender->setPriority(Priority::Warning);
+    messages.clear();
+    logger.debug() << "filtered";
+    logger.info() << "filtered";
+    {
+        LogHard::Logger::ScopedVerbosity const verbosity(Priority::Debug);
+        SHAREMIND_TESTASSERT(logger.enabled(Priority::Debug));
+        SHAREMIND_TESTASSERT(!logger.enabled(Priority::FullDebug));
+        logger.debug() << "elevated";
+        logger.warning() << "accepted";
+        auto const captured(LogHard::Logger::ScopedVerbosity::current());
+        std::thread([&logger, captured]{
+            SHAREMIND_TESTASSERT(!logger.enabled(Priority::Debug));
+            LogHard::Logger::ScopedVerbosity const verbosity2(captured);
+            logger.info() << "propagated";
+        }).join();
+    }
+    logger.debug() << "filtered";
+    SHAREMIND_TESTASSERT(messages.size() == 3u);
+    SHAREMIND_TESTASSERT(messages[0u] == "elevated");
+    SHAREMIND_TESTASSERT(messages[1u] == "accepted");
+    SHAREMIND_TESTASSERT(messages[2u] == "propagated");
+
+    { // Routing by the priorities of the appenders:
+        auto const b(std::make_shared<LogHard::Backend>(Priority::FullDebug));
+        auto const errors(std::make_shared<CollectingAppender>());
+        auto const all(std::make_shared<CollectingAppender>());
+        errors->setPriority(Priority::Error);
+        b->addAppender(errors);
+        b->addAppender(all);
+        LogHard::Logger const l(b);
+        l.error() << "error";
+        l.debug() << "debug";
+        SHAREMIND_TESTASSERT(errors->messages.size() == 1u);
+        SHAREMIND_TESTASSERT(all->messages.size() == 2u);
+
+        errors->setPriority(Priority::Debug);
+        all->setPriority(Priority::Fatal);
+        l.debug() << "debug";
+        SHAREMIND_TESTASSERT(errors->messages.size() == 2u);
+        SHAREMIND_TESTASSERT(all->messages.size() == 2u);
+
+        b->removeAppender(errors);
+        all->setPriority(Priority::FullDebug);
+        l.error() << "error";
+        SHAREMIND_TESTASSERT(errors->messages.size() == 2u);
+        SHAREMIND_TESTASSERT(all->messages.size() == 3u);
+        b->addAppender(errors);
+        l.fullDebug() << "full";
+        SHAREMIND_TESTASSERT(errors->messages.size() == 2u);
+        SHAREMIND_TESTASSERT(all->messages.size() == 4u);
+    }
+
+    { // Nested Backends:
+        using BA = LogHard::Backend::Appender;
+        auto const top(std::make_shared<LogHard::Backend>(Priority::FullDebug));
+        auto const middle(std::make_shared<LogHard::Backend>(Priority::Debug));
+        auto const bottom(std::make_shared<LogHard::Backend>(Priority::Normal));
+        auto const m(std::make_shared<CollectingAppender>());
+        auto const b(std::make_shared<CollectingAppender>());
+        middle->addAppender(m);
+        bottom->addAppender(b);
+        auto const toMiddle(std::make_shared<BA>(middle, Priority::FullDebug));
+        auto const toBottom(
+                std::make_shared<BA>(bottom, Priority::FullDebug));
+        top->addAppender(toMiddle);
+        middle->addAppender(toBottom);
+
+        bool thrown = false;
+        try {
+            bottom->addAppender(std::make_shared<BA>(top));
+        } catch (LogHard::Backend::LoopException const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+        thrown = false;
+        try {
+            top->addAppender(std::make_shared<BA>(top));
+        } catch (LogHard::Backend::LoopException const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+
+        LogHard::Logger const l(top);
+        l.info() << "info";
+        l.debug() << "debug";
+        l.fullDebug() << "fullDebug";
+        SHAREMIND_TESTASSERT(m->messages.size() == 2u);
+        SHAREMIND_TESTASSERT(b->messages.size() == 1u);
+        SHAREMIND_TESTASSERT(b->messages[0u] == "info");
+        #ifndef LOGHARD_NO_STATISTICS
+        auto const s(bottom->statistics());
+        SHAREMIND_TESTASSERT(
+                s.records[static_cast<unsigned>(Priority::Normal)] == 1u);
+        #endif
+
+        // Appenders added to and removed from nested Backends take effect:
+        {
+            auto const b2(std::make_shared<CollectingAppender>());
+            bottom->removeAppender(b);
+            bottom->addAppender(b2);
+            l.info() << "info";
+            SHAREMIND_TESTASSERT(b->messages.size() == 1u);
+            SHAREMIND_TESTASSERT(b2->messages.size() == 1u);
+            bottom->removeAppender(b2);
+            l.info() << "info";
+            SHAREMIND_TESTASSERT(b2->messages.size() == 1u);
+            SHAREMIND_TESTASSERT(b2.use_count() == 1);
+            bottom->addAppender(b);
+            SHAREMIND_TESTASSERT(m->messages.size() == 4u);
+            m->messages.erase(m->messages.begin() + 2, m->messages.end());
+        }
+
+        // Changes in nested Backends take effect:
+        bottom->setPriority(Priority::Debug);
+        m->setPriority(Priority::Normal);
+        l.debug() << "debug";
+        SHAREMIND_TESTASSERT(m->messages.size() == 2u);
+        SHAREMIND_TESTASSERT(b->messages.size() == 2u);
+        bottom->setDuplicateWindow(std::chrono::seconds(1));
+        l.debug() << "debug";
+        l.debug() << "debug";
+        SHAREMIND_TESTASSERT(b->messages.size() == 3u);
+        bottom->setDuplicateWindow(std::chrono::seconds(0));
+        SHAREMIND_TESTASSERT(b->messages.size() == 4u);
+        middle->removeAppender(toBottom);
+        l.info() << "info";
+        SHAREMIND_TESTASSERT(m->messages.size() == 3u);
+        SHAREMIND_TESTASSERT(b->messages.size() == 4u);
+
+        // Without the link, the loop is allowed:
+        bottom->addAppender(std::make_shared<BA>(top));
+    }
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/CallSite.h"
+
+#include <cstring>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <vector>
+#include "../src/Backend.h"
+#include "../src/Logger.h"
+#include "TestUtils.h"
+
+
+using LogHard::CallSite;
+using LogHard::Priority;
+using LogHardTest::CollectingAppender;
+
+namespace {
+
+unsigned evaluations = 0u;
+
+char const * evaluate() noexcept {
+    ++evaluations;
+    return "evaluated";
+}
+
+void logDebug(LogHard::Logger const & logger) {
+    LOGHARD_DEBUG(logger) << "debug " << evaluate();
+}
+
+void logError(LogHard::Logger const & logger, bool const really) {
+    if (really)
+        LOGHARD_ERROR(logger) << "error";
+    else
+        LOGHARD_ERROR(logger) << "not really";
+}
+
+} // anonymous namespace
+
+int main() {
+    auto const backend(std::make_shared<LogHard::Backend>());
+    auto const appender(std::make_shared<CollectingAppender>());
+    backend->addAppender(appender);
+    LogHard::Logger const logger(backend);
+
+    // Disabled statements do not evaluate their arguments:
+    logDebug(logger);
+    SHAREMIND_TESTASSERT(appender->messages.empty());
+    SHAREMIND_TESTASSERT(evaluations == 0u);
+
+    CallSite * debugSite = nullptr;
+    for (CallSite * site = CallSite::first(); site; site = site->next())
+        if (site->priority() == Priority::Debug)
+            debugSite = site;
+    SHAREMIND_TESTASSERT(debugSite);
+    SHAREMIND_TESTASSERT(std::strcmp(debugSite->function(), "logDebug") == 0);
+    SHAREMIND_TESTASSERT(debugSite->mode() == CallSite::Mode::Default);
+
+    // Enabling a single call site bypasses the priority filter:
+    debugSite->setMode(CallSite::Mode::Enabled);
+    logDebug(logger);
+    SHAREMIND_TESTASSERT(appender->messages.size() == 1u);
+    SHAREMIND_TESTASSERT(appender->messages[0u] == "debug evaluated");
+
+    logError(logger, true);
+    logError(logger, false);
+    SHAREMIND_TESTASSERT(appender->messages.size() == 3u);
+    SHAREMIND_TESTASSERT(appender->messages[2u] == "not really");
+    SHAREMIND_TESTASSERT(CallSite::setMode("TestCallSite.cpp",
+                                           debugSite->line() + 5u,
+                                           CallSite::Mode::Disabled) == 1u);
+    logError(logger, true);
+    logError(logger, false);
+    SHAREMIND_TESTASSERT(appender->messages.size() == 4u);
+    SHAREMIND_TESTASSERT(appender->messages[3u] == "not really");
+}
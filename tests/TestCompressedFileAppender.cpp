@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/CompressedFileAppender.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fcntl.h>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../src/CFileAppender.h"
+#include "TestUtils.h"
+
+
+using LogHard::CFileAppender;
+using LogHard::CompressedFileAppender;
+using LogHard::CompressedFileReader;
+using LogHard::FileAppender;
+using LogHard::Priority;
+using LogHardTest::readFile;
+using sharemind::concat;
+
+namespace {
+
+::timeval const t{1500000000, 123456};
+
+std::string formatted(char const * const message) {
+    CFileAppender::FormattedLine const line(t, Priority::Normal, message);
+    std::string r(line.size(), '\0');
+    line.copyTo(&r[0u]);
+    return r;
+}
+
+struct Decompressed {
+    std::string data;
+    std::size_t frames;
+    bool truncated;
+};
+
+Decompressed decompress(std::string const & path) {
+    CompressedFileReader reader(path, 3u);
+    std::ostringstream oss;
+    auto const frames = reader.decompressTo(oss);
+    return Decompressed{oss.str(), frames, reader.truncated()};
+}
+
+void writeFile(std::string const & path, std::string const & data) {
+    int const fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    SHAREMIND_TESTASSERT(fd != -1);
+    SHAREMIND_TESTASSERT(::write(fd, data.data(), data.size())
+                         == static_cast<::ssize_t>(data.size()));
+    ::close(fd);
+}
+
+std::uint32_t loadU32(std::string const & data, std::size_t const offset) {
+    auto const * const p =
+            reinterpret_cast<unsigned char const *>(data.data() + offset);
+    return static_cast<std::uint32_t>(p[0u])
+           | (static_cast<std::uint32_t>(p[1u]) << 8u)
+           | (static_cast<std::uint32_t>(p[2u]) << 16u)
+           | (static_cast<std::uint32_t>(p[3u]) << 24u);
+}
+
+/** \returns the offsets of the frames in the file. */
+std::vector<std::size_t> frameOffsets(std::string const & data) {
+    std::vector<std::size_t> r;
+    for (std::size_t o = 0u; o < data.size();
+         o += CompressedFileAppender::frameHeaderSize + loadU32(data, o + 12u))
+        r.push_back(o);
+    return r;
+}
+
+bool corruptFrameThrown(std::string const & path) {
+    try {
+        decompress(path);
+    } catch (CompressedFileReader::CorruptFrameException const &) {
+        return true;
+    }
+    return false;
+}
+
+void testCodec(CompressedFileAppender::Codec const codec,
+               std::string const & path)
+{
+    // Round trip over many frames:
+    std::string expected;
+    {
+        CompressedFileAppender a(path,
+                                 FileAppender::OVERWRITE,
+                                 codec,
+                                 256u,
+                                 std::chrono::milliseconds(0));
+        for (unsigned i = 0u; i < 1000u; ++i) {
+            auto const message(concat("Message number ", i));
+            a.log(t, Priority::Normal, message.c_str());
+            expected += formatted(message.c_str());
+        }
+    }
+    auto const full(decompress(path));
+    SHAREMIND_TESTASSERT(!full.truncated);
+    SHAREMIND_TESTASSERT(full.data == expected);
+    auto const file(readFile(path));
+    auto const offsets(frameOffsets(file));
+    SHAREMIND_TESTASSERT(offsets.size() == full.frames);
+    SHAREMIND_TESTASSERT(full.frames > 10u);
+
+    // Files cut short anywhere in the last frame lose just the last frame:
+    auto const last = offsets.back();
+    for (auto const size : { last + 1u,
+                             last + CompressedFileAppender::frameHeaderSize,
+                             file.size() - 1u })
+    {
+        writeFile(path, file.substr(0u, size));
+        auto const d(decompress(path));
+        SHAREMIND_TESTASSERT(d.truncated);
+        SHAREMIND_TESTASSERT(d.frames == full.frames - 1u);
+        SHAREMIND_TESTASSERT(d.data.size() < expected.size());
+        SHAREMIND_TESTASSERT(expected.compare(0u, d.data.size(), d.data)
+                             == 0);
+    }
+    writeFile(path, file.substr(0u, last));
+    SHAREMIND_TESTASSERT(!decompress(path).truncated);
+
+    // A last frame which was partially written is considered truncated:
+    {
+        auto garbled(file);
+        garbled.back() = static_cast<char>(~garbled.back());
+        writeFile(path, garbled);
+        auto const d(decompress(path));
+        SHAREMIND_TESTASSERT(d.truncated);
+        SHAREMIND_TESTASSERT(d.frames == full.frames - 1u);
+    }
+
+    // But garbage elsewhere is corruption:
+    {
+        auto garbled(file);
+        auto & c = garbled[CompressedFileAppender::frameHeaderSize];
+        c = static_cast<char>(~c);
+        writeFile(path, garbled);
+        SHAREMIND_TESTASSERT(corruptFrameThrown(path));
+    }
+    {   // Not even trying to allocate huge buffers:
+        auto garbled(file);
+        garbled.replace(8u, 8u, 8u, '\xff');
+        writeFile(path, garbled);
+        SHAREMIND_TESTASSERT(corruptFrameThrown(path));
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    auto const path(concat("/tmp/TestCompressedFileAppender.", ::getpid()));
+
+    for (auto const codec : { CompressedFileAppender::Codec::Zlib,
+                              CompressedFileAppender::Codec::Zstd })
+        if (CompressedFileAppender::codecSupported(codec))
+            testCodec(codec, path);
+
+    { // Records larger than maxBlockSize are truncated:
+        std::string const message(CompressedFileAppender::maxBlockSize, 'x');
+        {
+            CompressedFileAppender a(path,
+                                     FileAppender::OVERWRITE,
+                                     CompressedFileAppender::defaultCodec(),
+                                     4096u);
+            a.log(t, Priority::Normal, "before");
+            a.log(t, Priority::Normal, message.c_str());
+            a.log(t, Priority::Normal, "after");
+        }
+        auto const d(decompress(path));
+        SHAREMIND_TESTASSERT(!d.truncated);
+        SHAREMIND_TESTASSERT(d.frames == 3u);
+        auto const big(formatted(message.c_str()));
+        auto const before(formatted("before"));
+        auto const after(formatted("after"));
+        SHAREMIND_TESTASSERT(d.data.size()
+                             == before.size()
+                                + CompressedFileAppender::maxBlockSize
+                                + after.size());
+        SHAREMIND_TESTASSERT(d.data.compare(
+                                 before.size(),
+                                 CompressedFileAppender::maxBlockSize - 1u,
+                                 big,
+                                 0u,
+                                 CompressedFileAppender::maxBlockSize - 1u)
+                             == 0);
+        SHAREMIND_TESTASSERT(
+                d.data.compare(before.size()
+                               + CompressedFileAppender::maxBlockSize - 1u,
+                               1u + after.size(),
+                               concat("\n", after)) == 0);
+    }
+
+    { // Partial blocks are written after the flush interval:
+        CompressedFileAppender a(path,
+                                 FileAppender::OVERWRITE,
+                                 CompressedFileAppender::defaultCodec(),
+                                 1024u * 1024u,
+                                 std::chrono::milliseconds(10));
+        a.log(t, Priority::Normal, "flushed");
+        auto const deadline =
+                std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        Decompressed d;
+        do {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            d = decompress(path);
+        } while (!d.frames && (std::chrono::steady_clock::now() < deadline));
+        SHAREMIND_TESTASSERT(d.frames == 1u);
+        SHAREMIND_TESTASSERT(d.data == formatted("flushed"));
+    }
+    ::unlink(path.c_str());
+}
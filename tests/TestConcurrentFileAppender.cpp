@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/ConcurrentFileAppender.h"
+
+#include <fcntl.h>
+#include <memory>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../src/CFileAppender.h"
+#include "TestUtils.h"
+
+
+using LogHard::CFileAppender;
+using LogHard::ConcurrentFileAppender;
+using LogHard::FileAppender;
+using LogHard::Priority;
+using LogHardTest::readFile;
+using sharemind::concat;
+
+namespace {
+
+constexpr unsigned threads = 8u;
+constexpr unsigned recordsPerThread = 5000u;
+
+::off_t fileSize(std::string const & path) {
+    struct ::stat st;
+    SHAREMIND_TESTASSERT(::stat(path.c_str(), &st) == 0);
+    return st.st_size;
+}
+
+std::size_t lineSize(::timeval const time, char const * const message) {
+    return CFileAppender::FormattedLine(time, Priority::Normal, message).size();
+}
+
+} // anonymous namespace
+
+int main() {
+    auto const path(concat("/tmp/TestConcurrentFileAppender.", ::getpid()));
+    std::string const existing("Existing line\n");
+    {
+        int const fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        SHAREMIND_TESTASSERT(fd != -1);
+        SHAREMIND_TESTASSERT(::write(fd, existing.data(), existing.size())
+                             == static_cast<::ssize_t>(existing.size()));
+        ::close(fd);
+    }
+
+    ::timeval const t{1500000000, 0};
+    std::size_t expectedSize = existing.size();
+    {
+        // A small extent size to reserve space often under contention:
+        auto const appender(
+                std::make_shared<ConcurrentFileAppender>(
+                    path,
+                    FileAppender::APPEND,
+                    4096u));
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0u; i < threads; ++i) {
+            workers.emplace_back([&appender, i, t]() {
+                for (unsigned j = 0u; j < recordsPerThread; ++j)
+                    appender->log(t,
+                                  Priority::Normal,
+                                  concat("Thread ", i, " record ", j).c_str());
+            });
+        }
+        for (auto & worker : workers)
+            worker.join();
+        for (unsigned i = 0u; i < threads; ++i)
+            for (unsigned j = 0u; j < recordsPerThread; ++j)
+                expectedSize += lineSize(
+                            t,
+                            concat("Thread ", i, " record ", j).c_str());
+
+        // The reserved space does not show up in the size of the file:
+        SHAREMIND_TESTASSERT(fileSize(path)
+                             == static_cast<::off_t>(expectedSize));
+    }
+    SHAREMIND_TESTASSERT(fileSize(path) == static_cast<::off_t>(expectedSize));
+
+    // No records were lost, interleaved or reordered within a thread:
+    auto const contents(readFile(path));
+    SHAREMIND_TESTASSERT(contents.size() == expectedSize);
+    SHAREMIND_TESTASSERT(contents.compare(0u, existing.size(), existing) == 0);
+    std::vector<unsigned> next(threads, 0u);
+    std::istringstream iss(contents.substr(existing.size()));
+    std::string line;
+    std::size_t lines = 0u;
+    while (std::getline(iss, line)) {
+        ++lines;
+        auto const prefix(concat(std::string(CFileAppender::timeStampSize, '?'),
+                                 " INFO    Thread "));
+        SHAREMIND_TESTASSERT(line.size() > prefix.size());
+        SHAREMIND_TESTASSERT(
+                line.compare(CFileAppender::timeStampSize,
+                             prefix.size() - CFileAppender::timeStampSize,
+                             prefix,
+                             CFileAppender::timeStampSize,
+                             std::string::npos) == 0);
+        std::istringstream fields(line.substr(prefix.size()));
+        unsigned i;
+        std::string record;
+        unsigned j;
+        SHAREMIND_TESTASSERT(fields >> i >> record >> j);
+        SHAREMIND_TESTASSERT(fields.eof());
+        SHAREMIND_TESTASSERT(record == "record");
+        SHAREMIND_TESTASSERT(i < threads);
+        SHAREMIND_TESTASSERT(j == next[i]);
+        ++next[i];
+    }
+    SHAREMIND_TESTASSERT(lines == threads * recordsPerThread);
+    for (auto const n : next)
+        SHAREMIND_TESTASSERT(n == recordsPerThread);
+    ::unlink(path.c_str());
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/EarlyAppender.h"
+
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "TestUtils.h"
+
+
+using LogHard::EarlyAppender;
+using LogHard::Priority;
+using LogHardTest::CollectingAppender;
+using Policy = LogHard::EarlyAppender::OverflowPolicy;
+
+namespace {
+
+void logNumbers(EarlyAppender & a, int from, int to) {
+    ::timeval const t{0, 0};
+    for (; from < to; ++from)
+        a.log(t, Priority::Normal, std::to_string(from).c_str());
+}
+
+} // anonymous namespace
+
+int main() {
+    { // Keep oldest, limited by the number of entries:
+        EarlyAppender a(4u, 16u, Policy::KeepOldest);
+        logNumbers(a, 0, 6);
+        SHAREMIND_TESTASSERT(a.size() == 4u);
+        SHAREMIND_TESTASSERT(a.dropped() == 2u);
+        CollectingAppender c;
+        a.logToAppender(c);
+        SHAREMIND_TESTASSERT(c.messages.size() == 5u);
+        SHAREMIND_TESTASSERT(c.messages[0u] == "0");
+        SHAREMIND_TESTASSERT(c.messages[3u] == "3");
+        SHAREMIND_TESTASSERT(c.priorities[4u] == Priority::Error);
+        SHAREMIND_TESTASSERT(c.messages[4u]
+                             == "Early log buffer full, 2 messages skipped!");
+    }
+    { // Keep newest, limited by arena size and wrapping around:
+        EarlyAppender a(1000u, 16u, Policy::KeepNewest, 20u);
+        logNumbers(a, 100, 200);
+        auto const entries(a.entries());
+        SHAREMIND_TESTASSERT(!entries.empty());
+        SHAREMIND_TESTASSERT(entries.size() + a.dropped() == 100u);
+        int expected = 200 - static_cast<int>(entries.size());
+        for (auto const & entry : entries)
+            SHAREMIND_TESTASSERT(entry.message
+                                 == std::to_string(expected++));
+        CollectingAppender c;
+        a.logToAppender(c, Priority::Warning);
+        SHAREMIND_TESTASSERT(c.messages.size() == 1u);
+        SHAREMIND_TESTASSERT(c.priorities[0u] == Priority::Error);
+
+        a.clear();
+        SHAREMIND_TESTASSERT(a.size() == 0u);
+        SHAREMIND_TESTASSERT(a.dropped() == 0u);
+        logNumbers(a, 0, 1);
+        SHAREMIND_TESTASSERT(a.entries().size() == 1u);
+        SHAREMIND_TESTASSERT(a.records().size() == 1u);
+        SHAREMIND_TESTASSERT(std::string(a.records()[0u].message) == "0");
+
+        // Copies stay valid when the buffer is reused:
+        auto const copies(a.entries());
+        a.clear();
+        logNumbers(a, 1, 2);
+        SHAREMIND_TESTASSERT(copies.size() == 1u);
+        SHAREMIND_TESTASSERT(copies[0u].message == "0");
+        SHAREMIND_TESTASSERT(copies[0u].priority == Priority::Normal);
+    }
+    { // Concurrent writers and replay into several appenders:
+        EarlyAppender a(4096u, 16u, Policy::KeepNewest, 4096u * 8u);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i)
+            threads.emplace_back(
+                        [&a, i]() {
+                            logNumbers(a, i * 100000, i * 100000 + 1000);
+                            a.log(::timeval{0, 0},
+                                  Priority::Warning,
+                                  "warning");
+                        });
+        for (auto & thread : threads)
+            thread.join();
+        SHAREMIND_TESTASSERT(a.size() == 4004u);
+        SHAREMIND_TESTASSERT(a.dropped() == 0u);
+        CollectingAppender all;
+        CollectingAppender warnings;
+        a.logToAppenders({{&all, Priority::FullDebug},
+                          {&warnings, Priority::Warning}});
+        SHAREMIND_TESTASSERT(all.messages.size() == 4004u);
+        SHAREMIND_TESTASSERT(all.batches < 4004u / 16u);
+        SHAREMIND_TESTASSERT(warnings.messages.size() == 4u);
+        for (auto const & message : warnings.messages)
+            SHAREMIND_TESTASSERT(message == "warning");
+        std::vector<int> perThread(4u, 0);
+        for (auto const & message : all.messages) {
+            if (message == "warning")
+                continue;
+            int const value = std::stoi(message);
+            int & previous =
+                    perThread[static_cast<std::size_t>(value / 100000)];
+            SHAREMIND_TESTASSERT(value % 100000 == previous);
+            ++previous;
+        }
+    }
+    { // Concurrent writers overwriting each other, every record counted once:
+        EarlyAppender a(64u, 16u, Policy::KeepNewest, 64u * 8u);
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i)
+            threads.emplace_back(
+                        [&a, i]() {
+                            for (int j = 0; j < 10; ++j)
+                                logNumbers(a,
+                                           i * 100000 + j * 1000,
+                                           i * 100000 + j * 1000 + 1000);
+                        });
+        for (auto & thread : threads)
+            thread.join();
+        SHAREMIND_TESTASSERT(a.size() + a.dropped() == 40000u);
+    }
+    { // Elision of long messages:
+        EarlyAppender a(4u, 8u);
+        a.log(::timeval{0, 0}, Priority::Normal, "0123456789abcdef");
+        SHAREMIND_TESTASSERT(a.entries()[0u].message == "012[...]");
+    }
+    { // Limits shorter than the elision marker:
+        EarlyAppender a(4u, 3u);
+        a.log(::timeval{0, 0}, Priority::Normal, "0123456789abcdef");
+        SHAREMIND_TESTASSERT(a.entries()[0u].message == "012");
+        EarlyAppender b(4u, 0u);
+        b.log(::timeval{0, 0}, Priority::Normal, "0123456789abcdef");
+        SHAREMIND_TESTASSERT(b.entries()[0u].message.empty());
+    }
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/FileAppender.h"
+
+#include <fcntl.h>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "../src/CFileAppender.h"
+
+
+using LogHard::CFileAppender;
+using LogHard::FileAppender;
+using LogHard::Priority;
+using sharemind::concat;
+
+namespace {
+
+::timeval const t{1500000000, 123456};
+std::size_t const pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+
+std::size_t lineSize(std::string const & message) {
+    return CFileAppender::FormattedLine(t,
+                                        Priority::Normal,
+                                        message.c_str()).size();
+}
+
+struct ::stat fileStat(std::string const & path) {
+    struct ::stat st;
+    SHAREMIND_TESTASSERT(::stat(path.c_str(), &st) == 0);
+    return st;
+}
+
+std::size_t allocated(std::string const & path)
+{ return static_cast<std::size_t>(fileStat(path).st_blocks) * 512u; }
+
+/** \returns the number of pages of the range which are in the page cache. */
+std::size_t residentPages(std::string const & path,
+                          std::size_t const offset,
+                          std::size_t const size)
+{
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    SHAREMIND_TESTASSERT(fd != -1);
+    void * const p = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd,
+                            static_cast<::off_t>(offset));
+    SHAREMIND_TESTASSERT(p != MAP_FAILED);
+    std::vector<unsigned char> pages((size + pageSize - 1u) / pageSize);
+    SHAREMIND_TESTASSERT(::mincore(p, size, pages.data()) == 0);
+    ::munmap(p, size);
+    ::close(fd);
+    std::size_t r = 0u;
+    for (auto const page : pages)
+        r += (page & 1u);
+    return r;
+}
+
+#ifdef __linux__
+bool canPreallocate(std::string const & path) {
+    int const fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    SHAREMIND_TESTASSERT(fd != -1);
+    bool const r = (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, 65536) == 0);
+    ::close(fd);
+    ::unlink(path.c_str());
+    return r;
+}
+
+/** \returns whether holes punched past the end of file release blocks. */
+bool canReleasePastEnd(std::string const & path) {
+    int const fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    SHAREMIND_TESTASSERT(fd != -1);
+    bool r = (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, 65536) == 0);
+    if (r) {
+        ::fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, 0, 65536);
+        struct ::stat st;
+        SHAREMIND_TESTASSERT(::fstat(fd, &st) == 0);
+        r = !st.st_blocks;
+    }
+    ::close(fd);
+    ::unlink(path.c_str());
+    return r;
+}
+
+/** \returns whether clean pages of the filesystem can be dropped. */
+bool canDropCache(std::string const & path) {
+    int const fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    SHAREMIND_TESTASSERT(fd != -1);
+    std::string const data(65536u, 'x');
+    SHAREMIND_TESTASSERT(::write(fd, data.data(), data.size())
+                         == static_cast<::ssize_t>(data.size()));
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+    bool const r = !residentPages(path, 0u, data.size());
+    ::unlink(path.c_str());
+    return r;
+}
+#endif
+
+} // anonymous namespace
+
+int main() {
+    auto const path(concat("/tmp/TestFileAppender.", ::getpid()));
+    std::string const message(1000u, 'x');
+    auto const size = lineSize(message);
+
+    // Without preallocation:
+    {
+        FileAppender a(path, FileAppender::OVERWRITE);
+        for (unsigned i = 0u; i < 10u; ++i)
+            a.log(t, Priority::Normal, message.c_str());
+        SHAREMIND_TESTASSERT(fileStat(path).st_size
+                             == static_cast<::off_t>(10u * size));
+    }
+
+    #ifdef __linux__
+    { // Preallocation does not change the size of the file:
+        constexpr std::size_t chunkSize = 1024u * 1024u;
+        bool const preallocates = canPreallocate(path);
+        bool const releases = preallocates && canReleasePastEnd(path);
+        {
+            FileAppender a(path,
+                           FileAppender::OVERWRITE,
+                           FileAppender::Preallocation{chunkSize, 0u});
+            for (unsigned i = 0u; i < 10u; ++i)
+                a.log(t, Priority::Normal, message.c_str());
+            SHAREMIND_TESTASSERT(fileStat(path).st_size
+                                 == static_cast<::off_t>(10u * size));
+            if (preallocates)
+                SHAREMIND_TESTASSERT(allocated(path) >= chunkSize);
+        }
+        // The destructor releases the blocks past the end of the file:
+        SHAREMIND_TESTASSERT(fileStat(path).st_size
+                             == static_cast<::off_t>(10u * size));
+        if (releases)
+            SHAREMIND_TESTASSERT(allocated(path) < chunkSize);
+
+        // Appending starts from the end of the existing file:
+        {
+            FileAppender a(path,
+                           FileAppender::APPEND,
+                           FileAppender::Preallocation{chunkSize, 0u});
+            for (unsigned i = 0u; i < 2000u; ++i)
+                a.log(t, Priority::Normal, message.c_str());
+            SHAREMIND_TESTASSERT(fileStat(path).st_size
+                                 == static_cast<::off_t>(2010u * size));
+            if (preallocates)
+                SHAREMIND_TESTASSERT(allocated(path) >= 2010u * size);
+        }
+        SHAREMIND_TESTASSERT(fileStat(path).st_size
+                             == static_cast<::off_t>(2010u * size));
+        if (releases)
+            SHAREMIND_TESTASSERT(allocated(path) < 2010u * size + chunkSize);
+
+        // The destructor keeps what other writers appended to the file:
+        {
+            FileAppender a(path,
+                           FileAppender::OVERWRITE,
+                           FileAppender::Preallocation{chunkSize, 0u});
+            a.log(t, Priority::Normal, message.c_str());
+            int const fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+            SHAREMIND_TESTASSERT(fd != -1);
+            SHAREMIND_TESTASSERT(::write(fd, "other\n", 6u) == 6);
+            ::close(fd);
+        }
+        SHAREMIND_TESTASSERT(fileStat(path).st_size
+                             == static_cast<::off_t>(size + 6u));
+        {
+            char buffer[6u];
+            int const fd = ::open(path.c_str(), O_RDONLY);
+            SHAREMIND_TESTASSERT(fd != -1);
+            SHAREMIND_TESTASSERT(::pread(fd,
+                                         buffer,
+                                         sizeof(buffer),
+                                         static_cast<::off_t>(size))
+                                 == 6);
+            ::close(fd);
+            SHAREMIND_TESTASSERT(std::string(buffer, 6u) == "other\n");
+        }
+    }
+
+    { // Ranges written back are dropped from the page cache:
+        constexpr std::size_t dropSize = 64u * 1024u;
+        bool const drops = canDropCache(path);
+        FileAppender a(path,
+                       FileAppender::OVERWRITE,
+                       FileAppender::Preallocation{0u, dropSize});
+        std::size_t written = 0u;
+        auto const logUntil = [&](std::size_t const end) {
+            while (written < end) {
+                a.log(t, Priority::Normal, message.c_str());
+                written += size;
+            }
+        };
+        // The first round starts writeback of the first range:
+        logUntil(dropSize);
+        auto const firstRange = written / pageSize * pageSize;
+        SHAREMIND_TESTASSERT(residentPages(path, 0u, firstRange));
+        {
+            // Wait for the writeback, since dirty pages can not be dropped:
+            int const fd = ::open(path.c_str(), O_WRONLY);
+            SHAREMIND_TESTASSERT(fd != -1);
+            ::fdatasync(fd);
+            ::close(fd);
+        }
+        // The second round drops the first range:
+        logUntil(written + dropSize);
+        if (drops)
+            SHAREMIND_TESTASSERT(!residentPages(path, 0u, firstRange));
+        auto const secondRange = written / pageSize * pageSize - firstRange;
+        SHAREMIND_TESTASSERT(residentPages(path, firstRange, secondRange));
+    }
+    #endif
+    ::unlink(path.c_str());
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/FlightRecorderAppender.h"
+
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <vector>
+#include "TestUtils.h"
+
+
+using LogHard::FlightRecorderAppender;
+using LogHard::Priority;
+using LogHardTest::CollectingAppender;
+
+int main() {
+    auto const target(std::make_shared<CollectingAppender>());
+    FlightRecorderAppender a(target, Priority::Error, 4u);
+    a.setPriority(Priority::Debug);
+    ::timeval const t{0, 0};
+    for (int i = 0; i < 10; ++i)
+        a.log(t, Priority::Debug, std::to_string(i).c_str());
+    a.log(t, Priority::FullDebug, "ignored");
+    SHAREMIND_TESTASSERT(target->messages.empty());
+
+    // Only the last records are dumped before the triggering one:
+    a.log(t, Priority::Error, "error");
+    SHAREMIND_TESTASSERT((target->messages
+                          == std::vector<std::string>{
+                                    "6", "7", "8", "9", "error"}));
+
+    // Records are dumped only once:
+    a.log(t, Priority::Warning, "warning");
+    a.log(t, Priority::Fatal, "fatal");
+    SHAREMIND_TESTASSERT(target->messages.size() == 7u);
+    SHAREMIND_TESTASSERT(target->messages[5u] == "warning");
+    SHAREMIND_TESTASSERT(target->messages[6u] == "fatal");
+    a.dump();
+    SHAREMIND_TESTASSERT(target->messages.size() == 7u);
+}
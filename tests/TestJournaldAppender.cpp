@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/JournaldAppender.h"
+
+#include <map>
+#include <memory>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <unistd.h>
+#include "../src/Backend.h"
+#include "../src/Logger.h"
+#include "TestUtils.h"
+
+
+using LogHard::JournaldAppender;
+using LogHard::Priority;
+using LogHardTest::SocketStandIn;
+using sharemind::concat;
+using Fields = std::map<std::string, std::string>;
+
+namespace {
+
+Fields parse(std::string const & data) {
+    Fields fields;
+    std::size_t i = 0u;
+    while (i < data.size()) {
+        auto const end = data.find_first_of("=\n", i);
+        SHAREMIND_TESTASSERT(end != std::string::npos);
+        std::string const key(data, i, end - i);
+        if (data[end] == '=') {
+            auto const valueEnd = data.find('\n', end);
+            SHAREMIND_TESTASSERT(valueEnd != std::string::npos);
+            fields[key] = data.substr(end + 1u, valueEnd - end - 1u);
+            i = valueEnd + 1u;
+        } else {
+            SHAREMIND_TESTASSERT(end + 9u <= data.size());
+            std::uint64_t size = 0u;
+            for (unsigned j = 8u; j > 0u; --j)
+                size = (size << 8u)
+                       | static_cast<unsigned char>(data[end + j]);
+            SHAREMIND_TESTASSERT(end + 9u + size < data.size());
+            fields[key] = data.substr(end + 9u, size);
+            SHAREMIND_TESTASSERT(data[end + 9u + size] == '\n');
+            i = end + 10u + size;
+        }
+    }
+    return fields;
+}
+
+} // anonymous namespace
+
+int main() {
+    SocketStandIn const socket(
+            concat("/tmp/TestJournaldAppender.", ::getpid()));
+    ::timeval const t{0, 0};
+
+    auto const appender(std::make_shared<JournaldAppender>("test",
+                                                           socket.path));
+    appender->log(t, Priority::Warning, "Multi\nline");
+    {
+        auto const fields = parse(socket.receive());
+        SHAREMIND_TESTASSERT(fields.size() == 4u);
+        SHAREMIND_TESTASSERT(fields.at("SYSLOG_IDENTIFIER") == "test");
+        SHAREMIND_TESTASSERT(fields.at("PRIORITY") == "4");
+        SHAREMIND_TESTASSERT(fields.at("LOGHARD_PRIORITY") == "WARNING");
+        SHAREMIND_TESTASSERT(fields.at("MESSAGE") == "Multi\nline");
+    }
+
+    auto const backend(std::make_shared<LogHard::Backend>());
+    backend->addAppender(appender);
+    LogHard::Logger const logger(backend, "[Network]");
+    LogHard::Logger const childLogger(logger, "[Tls]");
+    logger.error() << "Failed";
+    {
+        auto const fields = parse(socket.receive());
+        SHAREMIND_TESTASSERT(fields.at("PRIORITY") == "3");
+        SHAREMIND_TESTASSERT(fields.at("LOGHARD_PREFIX") == "[Network]");
+        SHAREMIND_TESTASSERT(fields.at("MESSAGE") == "[Network] Failed");
+    }
+    childLogger.info() << "Handshake";
+    {
+        auto const fields = parse(socket.receive());
+        SHAREMIND_TESTASSERT(fields.at("LOGHARD_PREFIX") == "[Network][Tls]");
+        SHAREMIND_TESTASSERT(fields.at("MESSAGE")
+                             == "[Network][Tls] Handshake");
+    }
+
+    // Records too large for a datagram are passed in a memfd:
+    std::string const large(32u * 1024u * 1024u, 'x');
+    appender->log(t, Priority::Normal, large.c_str());
+    {
+        auto const fields = parse(socket.receive());
+        SHAREMIND_TESTASSERT(fields.at("PRIORITY") == "6");
+        SHAREMIND_TESTASSERT(fields.at("MESSAGE") == large);
+    }
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/Layout.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <unistd.h>
+#include "../src/FileAppender.h"
+
+
+using LogHard::FileAppender;
+using LogHard::Layout;
+using LogHard::Priority;
+using sharemind::concat;
+
+namespace {
+
+::timeval const t{1500000000, 123456}; // 2017-07-14T02:40:00.123456Z
+
+std::string format(Layout const & layout,
+                   char const * const message,
+                   Priority const priority = Priority::Warning,
+                   ::timeval const time = t)
+{
+    Layout::FormattedLine const line(layout, time, priority, message);
+    std::string r;
+    for (int i = 0; i < line.iovCount(); ++i)
+        r.append(static_cast<char const *>(line.iov()[i].iov_base),
+                 line.iov()[i].iov_len);
+    SHAREMIND_TESTASSERT(r.size() == line.size());
+    return r;
+}
+
+std::string format(char const * const pattern,
+                   char const * const message,
+                   Priority const priority = Priority::Warning,
+                   ::timeval const time = t)
+{ return format(Layout(pattern), message, priority, time); }
+
+bool isUnsigned(std::string const & s) {
+    if (s.empty())
+        return false;
+    for (char const c : s)
+        if ((c < '0') || (c > '9'))
+            return false;
+    return true;
+}
+
+void testParseError(char const * const pattern) {
+    try {
+        Layout const layout(pattern);
+        SHAREMIND_TESTASSERT(false);
+    } catch (Layout::ParseException const &) {}
+}
+
+} // anonymous namespace
+
+int main() {
+    ::setenv("TZ", "XYZ-3", 1);
+    ::tzset();
+
+    // The default layout of the text appenders:
+    SHAREMIND_TESTASSERT(format("%d %-7p %m%n", "Hello")
+                         == "2017.07.14 05:40:00 WARNING Hello\n");
+    SHAREMIND_TESTASSERT(format("%d %-7p %m%n", "Hi", Priority::Normal)
+                         == "2017.07.14 05:40:00 INFO    Hi\n");
+
+    // Time formats:
+    SHAREMIND_TESTASSERT(format("%i", "")
+                         == "2017-07-14T05:40:00.123456+03:00");
+    SHAREMIND_TESTASSERT(format("%I", "") == "2017-07-14T02:40:00.123456Z");
+    SHAREMIND_TESTASSERT(format("%D", "") == "2017.07.14 02:40:00");
+    SHAREMIND_TESTASSERT(format("%d{%H:%M:%S.%3f}", "") == "05:40:00.123");
+    SHAREMIND_TESTASSERT(format("%D{%f|%1f%%f}", "") == "123456|1%f");
+    SHAREMIND_TESTASSERT(format("%d{%H:%M}", "", Priority::Warning,
+                                ::timeval{1500000059, 7})
+                         == "05:40");
+    SHAREMIND_TESTASSERT(format("%d{%S.%6f}", "", Priority::Warning,
+                                ::timeval{1500000059, 7})
+                         == "59.000007");
+    ::setenv("TZ", "XYZ+4:30", 1);
+    ::tzset();
+    SHAREMIND_TESTASSERT(format("%i", "", Priority::Warning,
+                                ::timeval{1500000060, 0})
+                         == "2017-07-13T22:11:00.000000-04:30");
+    ::setenv("TZ", "XYZ-3", 1);
+    ::tzset();
+
+    // Padding and literals:
+    SHAREMIND_TESTASSERT(format("[%7p]", "", Priority::Error) == "[  ERROR]");
+    SHAREMIND_TESTASSERT(format("[%-7p]", "", Priority::Error) == "[ERROR  ]");
+    SHAREMIND_TESTASSERT(format("[%3p]", "", Priority::Error) == "[ERROR]");
+    SHAREMIND_TESTASSERT(format("100%% %m%n%m", "x") == "100% x\nx");
+    SHAREMIND_TESTASSERT(format("", "x").empty());
+    SHAREMIND_TESTASSERT(format("%m", "").empty());
+
+    { // Thread ids:
+        Layout const layout("%t|");
+        auto const line = format(layout, "");
+        SHAREMIND_TESTASSERT(line.back() == '|');
+        SHAREMIND_TESTASSERT(isUnsigned(line.substr(0u, line.size() - 1u)));
+        SHAREMIND_TESTASSERT(format(layout, "") == line);
+    }
+
+    { // Time relative to the construction of the layout:
+        Layout const layout("%r|%12r|%-12r|");
+        auto const origin = layout.origin();
+        auto const usec = origin.tv_usec + 345678;
+        ::timeval const later{origin.tv_sec + 12 + usec / 1000000,
+                              usec % 1000000};
+        SHAREMIND_TESTASSERT(
+                format(layout, "", Priority::Warning, later)
+                == "12.345678|   12.345678|12.345678   |");
+        ::timeval earlier = origin;
+        earlier.tv_sec -= 2;
+        SHAREMIND_TESTASSERT(format(layout, "", Priority::Warning, earlier)
+                             == "-2.000000|   -2.000000|-2.000000   |");
+        SHAREMIND_TESTASSERT(format(layout, "", Priority::Warning, origin)
+                             == "0.000000|    0.000000|0.000000    |");
+    }
+
+    // Truncation of everything but the message:
+    {
+        std::string const longLiteral(1000u, 'x');
+        auto const line = format(concat(longLiteral, "%m").c_str(), "msg");
+        SHAREMIND_TESTASSERT(
+                line == concat(std::string(Layout::FormattedLine::bufferSize,
+                                           'x'),
+                               "msg"));
+    }
+
+    // Parse errors:
+    testParseError("%");
+    testParseError("%q");
+    testParseError("%5m");
+    testParseError("%-p");
+    testParseError("%d{%H");
+    testParseError("%m%m%m%m%m%m%m%m");
+    Layout const many("%m%m%m%m%m%m%m");
+    SHAREMIND_TESTASSERT(format(many, "a") == "aaaaaaa");
+
+    { // Appenders with layouts:
+        auto const path = concat("/tmp/TestLayout.", ::getpid());
+        {
+            FileAppender a(path,
+                           FileAppender::OVERWRITE,
+                           Layout("%I %p: %m%n"));
+            a.log(t, Priority::Error, "first");
+            LogHard::Appender::LogRecord const records[] = {
+                {t, Priority::Normal, "second"},
+                {t, Priority::Debug, "third"}
+            };
+            a.logBatch(records, 2u);
+        }
+        std::ifstream in(path);
+        std::string const contents((std::istreambuf_iterator<char>(in)),
+                                   std::istreambuf_iterator<char>());
+        ::unlink(path.c_str());
+        SHAREMIND_TESTASSERT(contents
+                             == "2017-07-14T02:40:00.123456Z ERROR: first\n"
+                                "2017-07-14T02:40:00.123456Z INFO: second\n"
+                                "2017-07-14T02:40:00.123456Z DEBUG: third\n");
+    }
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+/*
+  Verifies that logging does not allocate memory after warm-up. Global
+  operator new and (on glibc) malloc are replaced to count the allocations of
+  the current thread while armed, and to print the call stack of each.
+*/
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <new>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <sharemind/Uuid.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <syslog.h>
+#include <unistd.h>
+#include "../src/Backend.h"
+#include "../src/CFileAppender.h"
+#include "../src/CompressedFileAppender.h"
+#include "../src/ConcurrentFileAppender.h"
+#include "../src/EarlyAppender.h"
+#include "../src/FileAppender.h"
+#include "../src/FlightRecorderAppender.h"
+#include "../src/JournaldAppender.h"
+#include "../src/Logger.h"
+#include "../src/StdAppender.h"
+#include "../src/SyslogSocketAppender.h"
+#include "../src/UringFileAppender.h"
+#include "TestUtils.h"
+
+
+#ifdef __GLIBC__
+extern "C" void * __libc_malloc(std::size_t size);
+extern "C" void * __libc_calloc(std::size_t count, std::size_t size);
+extern "C" void * __libc_realloc(void * ptr, std::size_t size);
+extern "C" void __libc_free(void * ptr);
+#endif
+
+namespace {
+
+thread_local bool tl_armed = false;
+thread_local std::size_t tl_allocations = 0u;
+
+void onAllocation(std::size_t const size) noexcept {
+    if (!tl_armed)
+        return;
+    tl_armed = false;
+    ++tl_allocations;
+    std::fprintf(stderr, "Allocation of %zu bytes on the hot path:\n", size);
+    void * stack[64u];
+    ::backtrace_symbols_fd(stack, ::backtrace(stack, 64), STDERR_FILENO);
+    tl_armed = true;
+}
+
+void * allocate(std::size_t const size) {
+    onAllocation(size);
+#ifdef __GLIBC__
+    if (void * const r = __libc_malloc(size ? size : 1u))
+#else
+    if (void * const r = std::malloc(size ? size : 1u))
+#endif
+        return r;
+    throw std::bad_alloc();
+}
+
+} // anonymous namespace
+
+void * operator new(std::size_t size) { return allocate(size); }
+void * operator new[](std::size_t size) { return allocate(size); }
+void * operator new(std::size_t size, std::nothrow_t const &) noexcept {
+    try {
+        return allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void * operator new[](std::size_t size, std::nothrow_t const &) noexcept
+{ return operator new(size, std::nothrow); }
+void operator delete(void * ptr) noexcept { std::free(ptr); }
+void operator delete[](void * ptr) noexcept { std::free(ptr); }
+void operator delete(void * ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void * ptr, std::size_t) noexcept { std::free(ptr); }
+
+#ifdef __GLIBC__
+extern "C" void * malloc(std::size_t size) {
+    onAllocation(size);
+    return __libc_malloc(size);
+}
+extern "C" void * calloc(std::size_t count, std::size_t size) {
+    onAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+extern "C" void * realloc(void * ptr, std::size_t size) {
+    onAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+extern "C" void free(void * ptr) { __libc_free(ptr); }
+#endif
+
+using LogHardTest::NullAppender;
+using LogHardTest::SocketStandIn;
+
+namespace {
+
+constexpr std::size_t WARMUP_STATEMENTS = 16u;
+constexpr std::size_t STEADY_STATEMENTS = 1000u;
+
+/** \returns the number of allocations during the steady state. */
+std::size_t countAllocations(char const * const name,
+                             std::shared_ptr<LogHard::Appender> appender,
+                             std::function<void ()> const & drain =
+                                     std::function<void ()>())
+{
+    auto const backend(
+            std::make_shared<LogHard::Backend>(LogHard::Priority::FullDebug));
+    backend->addAppender(std::move(appender));
+    LogHard::Logger const logger(backend, "[Test]");
+    std::string const text("std::string");
+    sharemind::Uuid const uuid = sharemind::Uuid();
+    auto const log = [&](std::size_t const i) {
+        logger.info() << "Statement " << i << ' ' << 4242.4242 << ' ' << text
+                      << ' ' << LogHard::Logger::Hex<unsigned>{0xbeefu}
+                      << ' ' << uuid << ' ' << static_cast<void *>(nullptr);
+        logger.debug() << "Statement " << i;
+    };
+
+    for (std::size_t i = 0u; i < WARMUP_STATEMENTS; ++i) {
+        log(i);
+        if (drain)
+            drain();
+    }
+
+    std::fprintf(stderr, "Checking %s...\n", name);
+    tl_allocations = 0u;
+    for (std::size_t i = 0u; i < STEADY_STATEMENTS; ++i) {
+        tl_armed = true;
+        log(i);
+        tl_armed = false;
+        if (drain)
+            drain();
+    }
+    if (tl_allocations)
+        std::fprintf(stderr, "%s: %zu allocations!\n", name, tl_allocations);
+    return tl_allocations;
+}
+
+} // anonymous namespace
+
+int main() {
+    using LogHard::FileAppender;
+    using sharemind::concat;
+
+    // Load the unwinder before it is needed while armed:
+    {
+        void * stack[1u];
+        ::backtrace(stack, 1);
+    }
+
+    // Make sure the interposition works at all:
+    tl_armed = true;
+    std::free(std::malloc(42u));
+    delete new int(42);
+    tl_armed = false;
+    #ifdef __GLIBC__
+    SHAREMIND_TESTASSERT(tl_allocations == 2u);
+    #else
+    // Only operator new is interposed:
+    SHAREMIND_TESTASSERT(tl_allocations == 1u);
+    #endif
+    std::fprintf(stderr, "The allocations above were expected.\n");
+
+    auto const base(concat("/tmp/TestNoAllocation.", ::getpid()));
+    auto const path(concat(base, ".log"));
+    std::size_t failures = 0u;
+
+    failures += countAllocations("NullAppender",
+                                 std::make_shared<NullAppender>());
+    {
+        int const oldStdout = ::dup(STDOUT_FILENO);
+        int const null = ::open("/dev/null", O_WRONLY);
+        ::dup2(null, STDOUT_FILENO);
+        failures += countAllocations("StdAppender",
+                                     std::make_shared<LogHard::StdAppender>());
+        ::dup2(oldStdout, STDOUT_FILENO);
+        ::close(oldStdout);
+        ::close(null);
+    }
+    failures += countAllocations(
+                "FileAppender",
+                std::make_shared<FileAppender>(path, FileAppender::OVERWRITE));
+    {
+        std::unique_ptr<std::FILE, int (*)(std::FILE *)> file(
+                    std::fopen(path.c_str(), "w"),
+                    &std::fclose);
+        SHAREMIND_TESTASSERT(file);
+        failures += countAllocations(
+                    "CFileAppender",
+                    std::make_shared<LogHard::CFileAppender>(file.get()));
+    }
+    failures += countAllocations(
+                "ConcurrentFileAppender",
+                std::make_shared<LogHard::ConcurrentFileAppender>(
+                    path,
+                    FileAppender::OVERWRITE));
+    failures += countAllocations(
+                "CompressedFileAppender",
+                std::make_shared<LogHard::CompressedFileAppender>(
+                    path,
+                    FileAppender::OVERWRITE,
+                    LogHard::CompressedFileAppender::defaultCodec(),
+                    4096u));
+    failures += countAllocations(
+                "UringFileAppender",
+                std::make_shared<LogHard::UringFileAppender>(
+                    path,
+                    FileAppender::OVERWRITE));
+    {
+        SocketStandIn const socket(concat(base, ".syslog"));
+        failures += countAllocations(
+                    "SyslogSocketAppender",
+                    std::make_shared<LogHard::SyslogSocketAppender>(
+                        "TestNoAllocation",
+                        LOG_USER,
+                        socket.path),
+                    [&socket]{ socket.drain(); });
+    }
+    {
+        SocketStandIn const socket(concat(base, ".journal"));
+        failures += countAllocations(
+                    "JournaldAppender",
+                    std::make_shared<LogHard::JournaldAppender>(
+                        "TestNoAllocation",
+                        socket.path),
+                    [&socket]{ socket.drain(); });
+    }
+    failures += countAllocations(
+                "EarlyAppender",
+                std::make_shared<LogHard::EarlyAppender>(
+                    WARMUP_STATEMENTS + STEADY_STATEMENTS));
+    failures += countAllocations(
+                "FlightRecorderAppender",
+                std::make_shared<LogHard::FlightRecorderAppender>(
+                    std::make_shared<NullAppender>()));
+
+    ::unlink(path.c_str());
+    SHAREMIND_TESTASSERT(failures == 0u);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/PrefixFilter.h"
+
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <vector>
+#include "../src/Backend.h"
+#include "../src/Logger.h"
+#include "TestUtils.h"
+
+
+using LogHard::Backend;
+using LogHard::Logger;
+using LogHard::PrefixFilter;
+using LogHard::Priority;
+using LogHardTest::CollectingAppender;
+
+int main() {
+    SHAREMIND_TESTASSERT(PrefixFilter::nodeName(" [Network] ") == "Network");
+    SHAREMIND_TESTASSERT(PrefixFilter::nodeName("[A][B]") == "[A][B]");
+    SHAREMIND_TESTASSERT(PrefixFilter::nodeName("Tcp") == "Tcp");
+
+    auto const backend(std::make_shared<Backend>(Priority::Warning));
+    auto const appender(std::make_shared<CollectingAppender>());
+    backend->addAppender(appender);
+
+    Logger const root(backend);
+    Logger const network(backend, "[Network]");
+    Logger const tcp(network, "[Tcp]");
+    Logger const storage(root, "[Storage]");
+    SHAREMIND_TESTASSERT(tcp.prefix() == "[Network][Tcp] ");
+    SHAREMIND_TESTASSERT(&tcp.filterNode()
+                         == &backend->filter().node("Network/Tcp"));
+    SHAREMIND_TESTASSERT(!tcp.enabled(Priority::Debug));
+
+    // Enabling debugging for a subsystem affects its existing descendants:
+    auto & filter = backend->filter();
+    filter.setPriority(filter.node("Network"), Priority::Debug);
+    tcp.debug() << "tcp";
+    network.debug() << "network";
+    storage.debug() << "storage";
+    root.debug() << "root";
+    SHAREMIND_TESTASSERT((appender->messages
+                          == std::vector<std::string>{
+                                    "[Network][Tcp] tcp",
+                                    "[Network] network"}));
+
+    // Explicit settings of descendants are kept:
+    filter.setPriority(filter.node("Network/Tcp"), Priority::Error);
+    filter.setPriority(filter.node("Network"), Priority::FullDebug);
+    SHAREMIND_TESTASSERT(tcp.filterNode().priority() == Priority::Error);
+    filter.resetPriority(filter.node("Network/Tcp"));
+    SHAREMIND_TESTASSERT(tcp.filterNode().priority() == Priority::FullDebug);
+
+    // The backend priority is the priority of the root node:
+    backend->setPriority(Priority::Normal);
+    storage.info() << "storage";
+    SHAREMIND_TESTASSERT(appender->messages.back() == "[Storage] storage");
+    SHAREMIND_TESTASSERT(
+                filter.node("Network").priority() == Priority::FullDebug);
+
+    { // Nodes of short-lived Loggers are removed with the last Logger:
+        auto const b(std::make_shared<Backend>(Priority::Normal));
+        auto & f = b->filter();
+        auto const nodes = [&f]() { return f.volumes().size(); };
+        Logger const server(b, "[Server]");
+        SHAREMIND_TESTASSERT(nodes() == 2u);
+        for (unsigned i = 0u; i < 1000u; ++i) {
+            Logger const session(server, "[Session ", i, ']');
+            Logger const peer(session, "[Peer]");
+            SHAREMIND_TESTASSERT(nodes() == 4u);
+            peer.info() << "Hello";
+        }
+        SHAREMIND_TESTASSERT(nodes() == 2u);
+
+        // Copies and moves keep the node:
+        {
+            std::unique_ptr<Logger> copy;
+            {
+                Logger session(server, "[Session]");
+                Logger moved(std::move(session));
+                copy.reset(new Logger(moved));
+            }
+            SHAREMIND_TESTASSERT(nodes() == 3u);
+            SHAREMIND_TESTASSERT(&copy->filterNode().parent()->name()
+                                 == &server.filterNode().name());
+        }
+        SHAREMIND_TESTASSERT(nodes() == 2u);
+
+        // Changing the prefix releases the old node:
+        {
+            Logger session(server, "[Session 1]");
+            session.setPrefix("[Session 2]");
+            SHAREMIND_TESTASSERT(nodes() == 3u);
+            SHAREMIND_TESTASSERT(session.filterNode().name() == "Session 2");
+        }
+        SHAREMIND_TESTASSERT(nodes() == 2u);
+
+        // Explicitly configured nodes are kept until configured otherwise:
+        f.configure({{"Server/Session/Peer", Priority::Debug}});
+        SHAREMIND_TESTASSERT(nodes() == 4u);
+        {
+            Logger const session(server, "[Session]");
+            Logger const peer(session, "[Peer]");
+            SHAREMIND_TESTASSERT(peer.enabled(Priority::Debug));
+            f.configure({});
+            SHAREMIND_TESTASSERT(nodes() == 4u);
+            SHAREMIND_TESTASSERT(!peer.enabled(Priority::Debug));
+        }
+        SHAREMIND_TESTASSERT(nodes() == 2u);
+        f.configure({{"Server/Session", Priority::Debug}});
+        f.configure({});
+        SHAREMIND_TESTASSERT(nodes() == 2u);
+
+        // Nodes returned by node() and child() are kept:
+        f.node("Server/Pinned");
+        {
+            Logger const pinned(server, "[Pinned]");
+        }
+        SHAREMIND_TESTASSERT(nodes() == 3u);
+        f.configure({});
+        SHAREMIND_TESTASSERT(nodes() == 3u);
+    }
+}
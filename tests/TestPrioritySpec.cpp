@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/PrioritySpec.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "../src/Backend.h"
+#include "../src/Logger.h"
+#include "../src/PrioritySpecWatcher.h"
+
+
+using LogHard::Backend;
+using LogHard::Logger;
+using LogHard::Priority;
+using LogHard::PrioritySpec;
+
+namespace {
+
+struct CountingAppender: LogHard::Appender {
+    void doLog(::timeval, Priority const, char const *) noexcept override
+    { ++count; }
+    unsigned count = 0u;
+};
+
+template <typename F>
+bool parseFails(F && f) {
+    try {
+        f();
+    } catch (PrioritySpec::ParseException const &) {
+        return true;
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+int main() {
+    auto const backend(std::make_shared<Backend>());
+    Logger const tls(Logger(backend, "[Network]"), "[Tls]");
+    Logger const storage(backend, "[Storage]");
+    auto const file(std::make_shared<CountingAppender>());
+    PrioritySpec::Appenders const appenders{{"file:/var/log/x", file}};
+
+    PrioritySpec(" *=warn, Network=debug,Network.Tls=fulldebug ,"
+                 "file:/var/log/x=error,").apply(*backend, appenders);
+    SHAREMIND_TESTASSERT(storage.filterNode().priority() == Priority::Warning);
+    SHAREMIND_TESTASSERT(tls.filterNode().priority() == Priority::FullDebug);
+    SHAREMIND_TESTASSERT(backend->filter().node("Network").priority()
+                         == Priority::Debug);
+    file->log(Logger::now(), Priority::Warning, "x");
+    file->log(Logger::now(), Priority::Error, "x");
+    SHAREMIND_TESTASSERT(file->count == 1u);
+
+    // A new specification replaces the previous node priorities:
+    PrioritySpec("Storage=2").apply(*backend);
+    SHAREMIND_TESTASSERT(storage.filterNode().priority() == Priority::Warning);
+    SHAREMIND_TESTASSERT(tls.filterNode().priority() == Priority::Warning);
+
+    SHAREMIND_TESTASSERT(parseFails([]{ PrioritySpec("Network"); }));
+    SHAREMIND_TESTASSERT(parseFails([]{ PrioritySpec("=debug"); }));
+    SHAREMIND_TESTASSERT(parseFails([]{ PrioritySpec("x=loud"); }));
+    SHAREMIND_TESTASSERT(PrioritySpec("").empty());
+    bool unknownAppender = false;
+    try {
+        PrioritySpec("*=debug,syslog:x=debug").apply(*backend);
+    } catch (PrioritySpec::UnknownAppenderException const &) {
+        unknownAppender = true;
+    }
+    SHAREMIND_TESTASSERT(unknownAppender);
+    SHAREMIND_TESTASSERT(backend->filter().root().priority()
+                         == Priority::Warning);
+
+    ::setenv("LOGHARD_TEST_PRIORITY", "Storage=fatal", 1);
+    PrioritySpec::fromEnvironment("LOGHARD_TEST_PRIORITY").apply(*backend);
+    SHAREMIND_TESTASSERT(storage.filterNode().priority() == Priority::Fatal);
+
+    #ifdef __linux__
+    { // Changes to the watched file are applied:
+        std::string const path(
+                    "/tmp/TestPrioritySpec." + std::to_string(::getpid()));
+        LogHard::PrioritySpecWatcher const watcher(backend, path);
+        std::FILE * const f = std::fopen(path.c_str(), "w");
+        SHAREMIND_TESTASSERT(f);
+        std::fputs("Storage=debug\n", f);
+        std::fclose(f);
+        for (int i = 0; i < 500; ++i) {
+            if (storage.filterNode().priority() == Priority::Debug)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ::unlink(path.c_str());
+        SHAREMIND_TESTASSERT(storage.filterNode().priority()
+                             == Priority::Debug);
+    }
+    #endif
+}
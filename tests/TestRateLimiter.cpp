@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/RateLimiter.h"
+
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <vector>
+#include "../src/Backend.h"
+#include "../src/Logger.h"
+#include "TestUtils.h"
+
+
+using LogHard::Priority;
+using LogHardTest::CollectingAppender;
+
+namespace {
+
+void logEveryThird(LogHard::Logger const & logger, unsigned const i)
+{ LOGHARD_LOG_EVERY_N(logger, Warning, 3u) << "every " << i; }
+
+void logBurst(LogHard::Logger const & logger, unsigned const i)
+{ LOGHARD_LOG_RATE(logger, Warning, 1u, 2u) << "burst " << i; }
+
+} // anonymous namespace
+
+int main() {
+    static_assert(alignof(LogHard::RateLimiter) >= 64u, "Not isolated!");
+
+    {
+        LogHard::RateLimiter limiter(1000u, 10u);
+        unsigned passed = 0u;
+        for (unsigned i = 0u; i < 100u; ++i)
+            passed += limiter.acquire();
+        SHAREMIND_TESTASSERT(passed >= 10u && passed < 20u);
+        SHAREMIND_TESTASSERT(limiter.takeSuppressed() == 100u - passed);
+        SHAREMIND_TESTASSERT(limiter.takeSuppressed() == 0u);
+    }
+
+    auto const backend(std::make_shared<LogHard::Backend>());
+    auto const appender(std::make_shared<CollectingAppender>());
+    backend->addAppender(appender);
+    LogHard::Logger const logger(backend);
+    auto & messages = appender->messages;
+
+    for (unsigned i = 0u; i < 7u; ++i)
+        logEveryThird(logger, i);
+    SHAREMIND_TESTASSERT(messages.size() == 5u);
+    SHAREMIND_TESTASSERT(messages[0u] == "every 0");
+    SHAREMIND_TESTASSERT(messages[1u].find("Suppressed 2 similar") == 0u);
+    SHAREMIND_TESTASSERT(messages[2u] == "every 3");
+    SHAREMIND_TESTASSERT(messages[4u] == "every 6");
+
+    messages.clear();
+    for (unsigned i = 0u; i < 5u; ++i)
+        logBurst(logger, i);
+    SHAREMIND_TESTASSERT(messages.size() == 2u);
+    SHAREMIND_TESTASSERT(messages[1u] == "burst 1");
+}
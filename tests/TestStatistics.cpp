@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/Statistics.h"
+
+#include <memory>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <vector>
+#include "../src/Backend.h"
+#include "../src/BackendC.h"
+#include "../src/Logger.h"
+#include "TestUtils.h"
+
+
+using LogHard::Histogram;
+using LogHard::Priority;
+using LogHardTest::CollectingAppender;
+using LogHardTest::NullAppender;
+
+int main() {
+    // Bucket bounds are contiguous and contain their values:
+    for (std::size_t i = 0u; i + 1u < Histogram::BUCKETS; ++i) {
+        auto const lower = Histogram::bucketLowerBound(i);
+        auto const upper = Histogram::bucketUpperBound(i);
+        SHAREMIND_TESTASSERT(Histogram::bucketLowerBound(i + 1u) == upper + 1u);
+        SHAREMIND_TESTASSERT(Histogram::bucketIndex(lower) == i);
+        SHAREMIND_TESTASSERT(Histogram::bucketIndex(upper) == i);
+    }
+    SHAREMIND_TESTASSERT(Histogram::bucketIndex(~0ull)
+                         == Histogram::BUCKETS - 1u);
+
+    {
+        std::unique_ptr<Histogram> const h(new Histogram());
+        for (std::uint64_t v = 1u; v <= 1000u; ++v)
+            h->record(v);
+        auto const s(h->snapshot());
+        SHAREMIND_TESTASSERT(s.count == 1000u);
+        SHAREMIND_TESTASSERT(s.sum == 500500u);
+        SHAREMIND_TESTASSERT(s.percentile(0.5) >= 500u);
+        SHAREMIND_TESTASSERT(s.percentile(0.5) < 500u * 5u / 4u);
+        SHAREMIND_TESTASSERT(s.max() >= 1000u);
+    }
+
+    auto const backend(std::make_shared<LogHard::Backend>(Priority::Normal));
+    auto const appender(std::make_shared<NullAppender>());
+    appender->setPriority(Priority::Warning);
+    backend->addAppender(appender);
+    LogHard::Logger const logger(backend);
+    logger.error() << "12345";
+    logger.info() << "123";
+    logger.debug() << "not formatted";
+    logger.info() << std::string(20000u, 'x');
+
+    auto const s(backend->statistics());
+    #ifndef LOGHARD_NO_STATISTICS
+    SHAREMIND_TESTASSERT(s.records[static_cast<unsigned>(Priority::Error)]
+                         == 1u);
+    SHAREMIND_TESTASSERT(s.records[static_cast<unsigned>(Priority::Normal)]
+                         == 2u);
+    SHAREMIND_TESTASSERT(s.bytesFormatted == s.bytesDelivered);
+    SHAREMIND_TESTASSERT(s.elided == 1u);
+    SHAREMIND_TESTASSERT(s.lockWait.count == 3u);
+    SHAREMIND_TESTASSERT(s.appenders.size() == 1u);
+    SHAREMIND_TESTASSERT(s.appenders[0u].records == 1u);
+    SHAREMIND_TESTASSERT(s.appenders[0u].bytes == 5u);
+    // The Backend does not pass records to appenders which reject them:
+    SHAREMIND_TESTASSERT(s.appenders[0u].filtered == 0u);
+    appender->log(LogHard::Logger::now(), Priority::Debug, "filtered");
+    SHAREMIND_TESTASSERT(appender->statistics().filtered == 1u);
+    SHAREMIND_TESTASSERT(s.appenders[0u].latency.count <= 1u);
+    #endif
+
+    #ifndef LOGHARD_NO_STATISTICS
+    { // Volume per Logger prefix:
+        auto const b(std::make_shared<LogHard::Backend>(Priority::Normal));
+        auto const collector(std::make_shared<CollectingAppender>());
+        b->addAppender(collector);
+        LogHard::Logger const a(b, "[A]");
+        LogHard::Logger const ab(a, "[B]");
+        LogHard::Logger const c(b, "[C]");
+        a.info() << "1";
+        ab.info() << std::string(100u, 'x');
+        ab.info() << "2";
+        c.warning() << std::string(10u, 'x');
+        c.debug() << std::string(1000u, 'x'); // Filtered
+
+        auto const top(b->topTalkers(2u));
+        SHAREMIND_TESTASSERT(top.size() == 2u);
+        SHAREMIND_TESTASSERT(top[0u].path == "A/B");
+        SHAREMIND_TESTASSERT(top[0u].counts.totalMessages() == 2u);
+        SHAREMIND_TESTASSERT(top[1u].path == "C");
+        SHAREMIND_TESTASSERT(
+                top[1u].counts.bytes[static_cast<unsigned>(Priority::Warning)]
+                == 14u);
+
+        b->setTopTalkersReport(std::chrono::seconds(1), 1u);
+        c.info() << "3";
+        auto time(LogHard::Logger::now());
+        time.tv_sec += 5;
+        a.info(time) << "four!";
+        auto const & m = collector->messages;
+        SHAREMIND_TESTASSERT(m.size() == 7u);
+        SHAREMIND_TESTASSERT(m[5u].find("Top talkers in the last ") == 0u);
+        SHAREMIND_TESTASSERT(m[5u].find(" A 9 bytes in 1 records.")
+                             != std::string::npos);
+        SHAREMIND_TESTASSERT(m[6u] == "[A] four!");
+    }
+    #endif
+
+    LogHardBackendStatistics cs;
+    LogHardBackend * const cBackend = LogHardBackend_new(nullptr, nullptr);
+    SHAREMIND_TESTASSERT(cBackend);
+    SHAREMIND_TESTASSERT(LogHardBackend_statistics(cBackend, &cs));
+    SHAREMIND_TESTASSERT(cs.appenderRecords == 0u);
+    SHAREMIND_TESTASSERT(cs.lockWait.count == 0u);
+    LogHardBackend_free(cBackend);
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/SyslogSocketAppender.h"
+
+#include <chrono>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <syslog.h>
+#include <unistd.h>
+#include "TestUtils.h"
+
+
+using LogHard::Priority;
+using LogHard::SyslogSocketAppender;
+using LogHardTest::SocketStandIn;
+using sharemind::concat;
+
+namespace {
+
+bool endsWith(std::string const & s, std::string const & end) {
+    return (s.size() >= end.size())
+           && (s.compare(s.size() - end.size(), end.size(), end) == 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    SocketStandIn const socket(
+            concat("/tmp/TestSyslogSocketAppender.", ::getpid()));
+    ::timeval const t{1500000000, 123456};
+    auto const pid = static_cast<long>(::getpid());
+
+    { // RFC 3164, unbatched:
+        SyslogSocketAppender a("first", LOG_USER, socket.path);
+        a.log(t, Priority::Normal, "Hello");
+        auto const frame = socket.receive();
+        auto const end = concat(" first[", pid, "]: Hello");
+        SHAREMIND_TESTASSERT(frame.compare(0u, 4u, "<14>") == 0);
+        SHAREMIND_TESTASSERT(frame.size() == 4u + 15u + end.size());
+        SHAREMIND_TESTASSERT(endsWith(frame, end));
+    }
+
+    { // RFC 5424, several independent instances:
+        SyslogSocketAppender a("first",
+                               LOG_DAEMON,
+                               socket.path,
+                               SyslogSocketAppender::Format::Rfc5424);
+        SyslogSocketAppender b("second", LOG_LOCAL0, socket.path);
+        a.log(t, Priority::Error, "from a");
+        b.log(t, Priority::Debug, "from b");
+        auto const frameA = socket.receive();
+        SHAREMIND_TESTASSERT(
+                frameA.compare(0u, 34u, "<27>1 2017-07-14T02:40:00.123456Z ")
+                == 0);
+        SHAREMIND_TESTASSERT(
+                endsWith(frameA, concat(" first ", pid, " - - from a")));
+        auto const frameB = socket.receive();
+        SHAREMIND_TESTASSERT(frameB.compare(0u, 5u, "<135>") == 0);
+        SHAREMIND_TESTASSERT(
+                endsWith(frameB, concat(" second[", pid, "]: from b")));
+
+        // Within the same second and in another second:
+        a.log(::timeval{t.tv_sec, 42}, Priority::Error, "again");
+        SHAREMIND_TESTASSERT(
+                socket.receive().compare(
+                    0u, 34u, "<27>1 2017-07-14T02:40:00.000042Z ") == 0);
+        a.log(::timeval{t.tv_sec + 61, 7}, Priority::Error, "later");
+        SHAREMIND_TESTASSERT(
+                socket.receive().compare(
+                    0u, 34u, "<27>1 2017-07-14T02:41:01.000007Z ") == 0);
+    }
+
+    { // Batching:
+        SyslogSocketAppender a("batched",
+                               LOG_USER,
+                               socket.path,
+                               SyslogSocketAppender::Format::Rfc3164,
+                               3u);
+        a.log(t, Priority::Normal, "1");
+        a.log(t, Priority::Debug, "2");
+        SHAREMIND_TESTASSERT(!socket.hasPending());
+        a.log(t, Priority::Normal, "3");
+        SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 1"));
+        SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 2"));
+        SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 3"));
+        a.log(t, Priority::Normal, "4");
+        SHAREMIND_TESTASSERT(!socket.hasPending());
+        a.log(t, Priority::Warning, "5"); // Flushes immediately
+        SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 4"));
+        SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 5"));
+        a.log(t, Priority::Normal, "6");
+    } // Flushes on destruction
+    SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 6"));
+    SHAREMIND_TESTASSERT(!socket.hasPending());
+
+    { // Queued records are sent once the oldest one is old enough:
+        SyslogSocketAppender a("delayed",
+                               LOG_USER,
+                               socket.path,
+                               SyslogSocketAppender::Format::Rfc3164,
+                               10u,
+                               8192u,
+                               std::chrono::milliseconds(500));
+        a.log(t, Priority::Normal, "1");
+        a.log(::timeval{t.tv_sec, t.tv_usec + 1000}, Priority::Normal, "2");
+        SHAREMIND_TESTASSERT(!socket.hasPending());
+        a.log(::timeval{t.tv_sec + 1, 0}, Priority::Normal, "3");
+        SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 1"));
+        SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 2"));
+        SHAREMIND_TESTASSERT(endsWith(socket.receive(), "]: 3"));
+        SHAREMIND_TESTASSERT(!socket.hasPending());
+    }
+
+    { // A forked child sends its own process ID, but not the parent's queue:
+        SyslogSocketAppender a("forked",
+                               LOG_USER,
+                               socket.path,
+                               SyslogSocketAppender::Format::Rfc3164,
+                               10u);
+        a.log(t, Priority::Normal, "queued");
+        auto const child = ::fork();
+        SHAREMIND_TESTASSERT(child != -1);
+        if (!child) {
+            a.log(t, Priority::Warning, "child");
+            a.flush();
+            ::_exit(0);
+        }
+        int status;
+        SHAREMIND_TESTASSERT(::waitpid(child, &status, 0) == child);
+        SHAREMIND_TESTASSERT(WIFEXITED(status) && !WEXITSTATUS(status));
+        SHAREMIND_TESTASSERT(
+                endsWith(socket.receive(),
+                         concat(" forked[", static_cast<long>(child),
+                                "]: child")));
+        SHAREMIND_TESTASSERT(!socket.hasPending());
+        a.log(t, Priority::Warning, "parent");
+        SHAREMIND_TESTASSERT(
+                endsWith(socket.receive(),
+                         concat(" forked[", pid, "]: queued")));
+        SHAREMIND_TESTASSERT(
+                endsWith(socket.receive(),
+                         concat(" forked[", pid, "]: parent")));
+    }
+
+    try {
+        SyslogSocketAppender a("x", LOG_USER, socket.path + ".nonexistent");
+        SHAREMIND_TEST_UNREACHABLE;
+    } catch (SyslogSocketAppender::ConnectException const &) {}
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/TrafficCaptureAppender.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unistd.h>
+#include <vector>
+#include "../src/Backend.h"
+#include "../src/Logger.h"
+#include "../src/TrafficReplay.h"
+
+
+using LogHard::Priority;
+using LogHard::TrafficReplay;
+
+namespace {
+
+/** \returns the records of each thread as (priority, prefix size, size). */
+std::vector<std::vector<std::tuple<Priority, std::size_t, std::size_t> > >
+shape(TrafficReplay const & replay) {
+    std::vector<std::vector<std::tuple<Priority, std::size_t, std::size_t> > >
+            r(replay.threads());
+    for (auto const & record : replay.records())
+        r[record.thread].emplace_back(
+                    record.priority,
+                    replay.prefixSizes()[record.prefixId],
+                    record.size);
+    return r;
+}
+
+} // anonymous namespace
+
+int main() {
+    using LogHard::TrafficCaptureAppender;
+    auto const path(sharemind::concat("/tmp/TestTrafficCapture.",
+                                      ::getpid()));
+    auto const replayPath(path + ".replay");
+
+    {
+        auto const backend(
+                std::make_shared<LogHard::Backend>(Priority::FullDebug));
+        backend->addAppender(std::make_shared<TrafficCaptureAppender>(path));
+        LogHard::Logger const root(backend);
+        LogHard::Logger const network(backend, "[Network]");
+        LogHard::Logger const tls(network, "[Tls]");
+        root.warning() << "No prefix";
+        network.info() << "Connected to " << 42 << '.';
+        std::thread([&tls, &root]{
+            tls.debug() << "Handshake";
+            root.error() << "";
+        }).join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(40));
+        network.fullDebug() << "Closed.";
+    }
+
+    TrafficReplay const capture(path);
+    SHAREMIND_TESTASSERT(capture.threads() == 2u);
+    SHAREMIND_TESTASSERT(capture.prefixSizes().size() == 3u);
+    auto const & records = capture.records();
+    SHAREMIND_TESTASSERT(records.size() == 5u);
+    SHAREMIND_TESTASSERT(records[0u].priority == Priority::Warning);
+    SHAREMIND_TESTASSERT(records[0u].prefixId == 0u);
+    SHAREMIND_TESTASSERT(records[0u].size == 9u);
+    SHAREMIND_TESTASSERT(records[1u].prefixId == 1u);
+    SHAREMIND_TESTASSERT(capture.prefixSizes()[1u] == 10u);
+    SHAREMIND_TESTASSERT(records[1u].size == 26u);
+    SHAREMIND_TESTASSERT(records[2u].thread == 1u);
+    SHAREMIND_TESTASSERT(capture.prefixSizes()[2u] == 15u);
+    SHAREMIND_TESTASSERT(records[3u].size == 0u);
+    SHAREMIND_TESTASSERT(records[4u].thread == 0u);
+    SHAREMIND_TESTASSERT(records[4u].time - records[3u].time >= 40000u);
+
+    // The replay reproduces the shape:
+    {
+        auto const backend(
+                std::make_shared<LogHard::Backend>(Priority::FullDebug));
+        backend->addAppender(
+                    std::make_shared<TrafficCaptureAppender>(replayPath));
+        auto const result = capture.replay(backend, 2.0);
+        SHAREMIND_TESTASSERT(result.records == 5u);
+        SHAREMIND_TESTASSERT(result.latency.count == 5u);
+        SHAREMIND_TESTASSERT(result.lag.count == 5u);
+        SHAREMIND_TESTASSERT(result.elapsed >= std::chrono::milliseconds(20));
+    }
+    TrafficReplay const replayed(replayPath);
+    SHAREMIND_TESTASSERT(shape(replayed) == shape(capture));
+    SHAREMIND_TESTASSERT(replayed.records().back().time >= 20000u);
+
+    // As fast as possible, and filtered by the Backend:
+    {
+        auto const backend(
+                std::make_shared<LogHard::Backend>(Priority::Warning));
+        backend->addAppender(
+                    std::make_shared<TrafficCaptureAppender>(replayPath));
+        auto const result = capture.replay(backend, 0.0);
+        SHAREMIND_TESTASSERT(result.lag.count == 0u);
+        SHAREMIND_TESTASSERT(result.elapsed < std::chrono::milliseconds(20));
+    }
+    SHAREMIND_TESTASSERT(TrafficReplay(replayPath).records().size() == 2u);
+
+    {
+        std::ofstream(replayPath) << "Something else\n";
+        bool thrown = false;
+        try {
+            TrafficReplay const invalid(replayPath);
+        } catch (TrafficReplay::ParseException const &) {
+            thrown = true;
+        }
+        SHAREMIND_TESTASSERT(thrown);
+    }
+
+    std::remove(path.c_str());
+    std::remove(replayPath.c_str());
+}
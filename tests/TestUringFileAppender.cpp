@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#include "../src/UringFileAppender.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <sharemind/Concat.h>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../src/CFileAppender.h"
+#include "TestUtils.h"
+
+#ifdef __linux__
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#endif
+
+
+using LogHard::CFileAppender;
+using LogHard::FileAppender;
+using LogHard::Priority;
+using LogHard::UringFileAppender;
+using LogHardTest::readFile;
+using sharemind::concat;
+
+namespace {
+
+::timeval const t{1500000000, 123456};
+
+std::string formatted(char const * const message) {
+    CFileAppender::FormattedLine const line(t, Priority::Normal, message);
+    std::string r(line.size(), '\0');
+    line.copyTo(&r[0u]);
+    return r;
+}
+
+/** Logs records, some larger than a batch, and checks the file contents. */
+void testAppender(std::string const & path,
+                  UringFileAppender::SyncMode const syncMode,
+                  bool const expectUring)
+{
+    std::string expected;
+    {
+        UringFileAppender a(path, FileAppender::OVERWRITE, syncMode, 256u);
+        if (expectUring)
+            SHAREMIND_TESTASSERT(a.usesUring());
+        for (unsigned i = 0u; i < 1000u; ++i) {
+            auto const message((i % 100u == 50u)
+                               ? concat("Large ", i, std::string(500u, 'x'))
+                               : concat("Record ", i));
+            a.log(t, Priority::Normal, message.c_str());
+            expected += formatted(message.c_str());
+            if (i == 500u) {
+                // Everything logged is written by flush():
+                a.flush();
+                SHAREMIND_TESTASSERT(readFile(path) == expected);
+            }
+        }
+    }
+    SHAREMIND_TESTASSERT(readFile(path) == expected);
+}
+
+} // anonymous namespace
+
+int main() {
+    auto const path(concat("/tmp/TestUringFileAppender.", ::getpid()));
+
+    bool const haveUring =
+            UringFileAppender(path, FileAppender::OVERWRITE).usesUring();
+    testAppender(path, UringFileAppender::NO_SYNC, haveUring);
+    testAppender(path, UringFileAppender::FDATASYNC, haveUring);
+
+    #if defined(__linux__) && defined(__NR_io_uring_setup)
+    { // Falls back to synchronous writes if io_uring_setup() fails:
+        auto const pid = ::fork();
+        SHAREMIND_TESTASSERT(pid != -1);
+        if (!pid) {
+            ::sock_filter filter[] = {
+                BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                         offsetof(::seccomp_data, nr)),
+                BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, __NR_io_uring_setup, 0, 1),
+                BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | ENOSYS),
+                BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW)
+            };
+            ::sock_fprog const program{
+                static_cast<unsigned short>(sizeof(filter) / sizeof(filter[0])),
+                filter};
+            SHAREMIND_TESTASSERT(::prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == 0);
+            SHAREMIND_TESTASSERT(
+                    ::prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program)
+                    == 0);
+            SHAREMIND_TESTASSERT(
+                    !UringFileAppender(path,
+                                       FileAppender::OVERWRITE).usesUring());
+            testAppender(path, UringFileAppender::FDATASYNC, false);
+            ::_exit(0);
+        }
+        int status;
+        SHAREMIND_TESTASSERT(::waitpid(pid, &status, 0) == pid);
+        SHAREMIND_TESTASSERT(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+    }
+    #endif
+    ::unlink(path.c_str());
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) Cybernetica
+ *
+ * Research/Commercial License Usage
+ * Licensees holding a valid Research License or Commercial License
+ * for the Software may use this file according to the written
+ * agreement between you and Cybernetica.
+ *
+ * GNU General Public License Usage
+ * Alternatively, this file may be used under the terms of the GNU
+ * General Public License version 3.0 as published by the Free Software
+ * Foundation and appearing in the file LICENSE.GPL included in the
+ * packaging of this file.  Please review the following information to
+ * ensure the GNU General Public License version 3.0 requirements will be
+ * met: http://www.gnu.org/copyleft/gpl-3.0.html.
+ *
+ * For further information, please contact us at sharemind@cyber.ee.
+ */
+
+#ifndef LOGHARD_TESTS_TESTUTILS_H
+#define LOGHARD_TESTS_TESTUTILS_H
+
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sharemind/TestAssert.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "../src/Appender.h"
+
+
+namespace LogHardTest {
+
+/** An appender which discards all records. */
+struct NullAppender: LogHard::Appender {
+    void doLog(::timeval, LogHard::Priority, char const *) noexcept override
+    {}
+};
+
+/** An appender which keeps the records it receives. */
+struct CollectingAppender: LogHard::Appender {
+
+    void doLog(::timeval,
+               LogHard::Priority const priority,
+               char const * message) noexcept override
+    {
+        priorities.emplace_back(priority);
+        messages.emplace_back(message);
+    }
+
+    void doLogBatch(LogRecord const * records, std::size_t size)
+            noexcept override
+    {
+        ++batches;
+        for (; size; ++records, --size)
+            doLog(records->time, records->priority, records->message);
+    }
+
+    std::size_t batches = 0u;
+    std::vector<LogHard::Priority> priorities;
+    std::vector<std::string> messages;
+
+};
+
+/** A bound local datagram socket standing in for syslog or journald. */
+struct SocketStandIn {
+
+    SocketStandIn(std::string path_)
+        : path(std::move(path_))
+        , fd(::socket(AF_UNIX, SOCK_DGRAM, 0))
+    {
+        SHAREMIND_TESTASSERT(fd != -1);
+        ::unlink(path.c_str());
+        ::sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strcpy(addr.sun_path, path.c_str());
+        SHAREMIND_TESTASSERT(
+                ::bind(fd, reinterpret_cast<::sockaddr *>(&addr), sizeof(addr))
+                == 0);
+    }
+
+    ~SocketStandIn() noexcept {
+        ::close(fd);
+        ::unlink(path.c_str());
+    }
+
+    bool hasPending() const noexcept {
+        char c;
+        return ::recv(fd, &c, 1u, MSG_PEEK | MSG_DONTWAIT) >= 0;
+    }
+
+    /// \returns the datagram, or the contents of a passed file descriptor.
+    std::string receive() const {
+        std::vector<char> buf(1024u * 1024u);
+        ::iovec iov{buf.data(), buf.size()};
+        union {
+            ::cmsghdr header;
+            char buffer[CMSG_SPACE(sizeof(int))];
+        } control;
+        ::msghdr header;
+        std::memset(&header, 0, sizeof(header));
+        header.msg_iov = &iov;
+        header.msg_iovlen = 1u;
+        header.msg_control = &control;
+        header.msg_controllen = sizeof(control);
+        auto const r = ::recvmsg(fd, &header, 0);
+        SHAREMIND_TESTASSERT(r >= 0);
+        ::cmsghdr * const cmsg = CMSG_FIRSTHDR(&header);
+        if (!cmsg)
+            return std::string(buf.data(), static_cast<std::size_t>(r));
+        SHAREMIND_TESTASSERT(r == 0);
+        SHAREMIND_TESTASSERT(cmsg->cmsg_type == SCM_RIGHTS);
+        int passedFd;
+        std::memcpy(&passedFd, CMSG_DATA(cmsg), sizeof(int));
+        std::string result;
+        for (;;) {
+            auto const n = ::pread(passedFd,
+                                   buf.data(),
+                                   buf.size(),
+                                   static_cast<::off_t>(result.size()));
+            SHAREMIND_TESTASSERT(n >= 0);
+            if (n == 0)
+                break;
+            result.append(buf.data(), static_cast<std::size_t>(n));
+        }
+        ::close(passedFd);
+        return result;
+    }
+
+    /** \brief Discards all pending datagrams without allocating memory. */
+    void drain() const noexcept {
+        char buffer[16384u];
+        while (::recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) >= 0) {}
+    }
+
+    std::string const path;
+    int const fd;
+
+};
+
+inline std::string readFile(std::string const & path) {
+    std::string r;
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    SHAREMIND_TESTASSERT(fd != -1);
+    char buf[4096u];
+    for (;;) {
+        auto const n = ::read(fd, buf, sizeof(buf));
+        SHAREMIND_TESTASSERT(n >= 0);
+        if (!n)
+            break;
+        r.append(buf, static_cast<std::size_t>(n));
+    }
+    ::close(fd);
+    return r;
+}
+
+} /* namespace LogHardTest { */
+
+#endif /* LOGHARD_TESTS_TESTUTILS_H */